@@ -90,6 +90,7 @@ static const std::vector<std::string> execNames =
 static std::mutex		transcoderMutex;
 static boost::filesystem::path	avConvPath = boost::filesystem::path();
 static std::atomic<size_t>	globalId = {0};
+static std::atomic<size_t>	nbActiveTranscoders = {0};
 
 static std::string searchPath(std::string filename)
 {
@@ -297,6 +298,9 @@ Transcoder::start()
 	}
 	LMS_LOG_TRANSCODE(DEBUG) << "Stream opened!";
 
+	_isActive = true;
+	nbActiveTranscoders++;
+
 	return true;
 }
 
@@ -338,6 +342,12 @@ Transcoder::process(std::vector<unsigned char>& output, std::size_t maxSize)
 
 		_isComplete = true;
 		_child.reset();
+
+		if (_isActive)
+		{
+			_isActive = false;
+			nbActiveTranscoders--;
+		}
 	}
 
 	_total += output.size();
@@ -357,6 +367,15 @@ Transcoder::~Transcoder()
 		_child->rdbuf()->close();
 		LMS_LOG_TRANSCODE(DEBUG) << "Closing DONE";
 	}
+
+	if (_isActive)
+		nbActiveTranscoders--;
+}
+
+std::size_t
+Transcoder::getNbActiveTranscoders()
+{
+	return nbActiveTranscoders;
 }
 
 } // namespace Transcode
@@ -93,6 +93,9 @@ class Transcoder
 
 		const TranscodeParameters& getParameters() const { return _parameters; }
 
+		// Number of transcoders started and not complete yet, thread safe
+		static std::size_t getNbActiveTranscoders();
+
 	private:
 		Transcoder();
 
@@ -102,6 +105,7 @@ class Transcoder
 		std::shared_ptr<redi::ipstream>	_child;
 
 		bool			_isComplete = false;
+		bool			_isActive = false;
 		std::size_t		_total = 0;
 		std::size_t		_id;
 };
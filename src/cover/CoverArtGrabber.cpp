@@ -18,9 +18,9 @@
  */
 
 #include "logger/Logger.hpp"
-#include "av/AvInfo.hpp"
 
 #include "CoverArtGrabber.hpp"
+#include "CoverStore.hpp"
 
 namespace {
 
@@ -52,24 +52,6 @@ Grabber::instance()
 	return instance;
 }
 
-static std::vector<Image::Image>
-getFromAvMediaFile(const Av::MediaFile& input, std::size_t nbMaxCovers)
-{
-	std::vector<Image::Image> res;
-
-	for (Av::Picture& picture : input.getAttachedPictures(nbMaxCovers))
-	{
-		Image::Image image;
-
-		if (image.load(picture.data))
-			res.push_back( image );
-		else
-			LMS_LOG(COVER, ERROR) << "Cannot load embedded cover file in '" << input.getPath() << "'";
-	}
-
-	return res;
-}
-
 std::vector<Image::Image>
 Grabber::getFromDirectory(const boost::filesystem::path& p, std::size_t nbMaxCovers) const
 {
@@ -127,14 +109,21 @@ Grabber::getCoverPaths(const boost::filesystem::path& directoryPath, std::size_t
 }
 
 std::vector<Image::Image>
-Grabber::getFromTrack(const boost::filesystem::path& p, std::size_t nbMaxCovers) const
+Grabber::getFromStore(const std::string& coverHash) const
 {
-	Av::MediaFile input(p);
+	std::vector<Image::Image> res;
 
-	if (input.open())
-		return getFromAvMediaFile(input, nbMaxCovers);
+	const boost::filesystem::path coverPath = Store::instance().getPath(coverHash);
+	if (coverPath.empty())
+		return res;
+
+	Image::Image image;
+	if (image.load(coverPath))
+		res.push_back(image);
 	else
-		return std::vector<Image::Image>();
+		LMS_LOG(COVER, ERROR) << "Cannot load image in file '" << coverPath << "'";
+
+	return res;
 }
 
 std::vector<Image::Image>
@@ -148,20 +137,17 @@ Grabber::getFromTrack(Wt::Dbo::Session& session, Database::Track::id_type trackI
 	if (!track)
 		return std::vector<Image::Image>();
 
-	Track::CoverType coverType = track->getCoverType();
+	const std::string coverHash = track->getCoverHash();
 	boost::filesystem::path trackPath = track->getPath();
 
 	transaction.commit();
 
-	switch (coverType)
-	{
-		case Track::CoverType::Embedded:
-			return Grabber::getFromTrack(trackPath, nbMaxCovers);
-		case Track::CoverType::None:
-			return Grabber::getFromDirectory(trackPath.parent_path(), nbMaxCovers);
-	}
+	// Tracks scanned before the cover store have no hash yet
+	std::vector<Image::Image> res = getFromStore(coverHash);
+	if (res.empty())
+		res = getFromDirectory(trackPath.parent_path(), nbMaxCovers);
 
-	return std::vector<Image::Image>();
+	return res;
 }
 
 
@@ -186,16 +172,16 @@ Grabber::getFromRelease(Wt::Dbo::Session& session, Database::Release::id_type re
 		return std::vector<Image::Image>();
 
 	boost::filesystem::path firstTrackPath = tracks.front()->getPath();
-	bool embeddedCover = (tracks.front()->getCoverType() == Track::CoverType::Embedded);
+	const std::string coverHash = release->getCoverHash();
 
 	transaction.commit();
 
 	// First, try to get covers from the directory of the release
 	std::vector<Image::Image> res = getFromDirectory( firstTrackPath.parent_path(), nbMaxCovers);
 
-	// Fallback on the embedded cover of the first track
-	if (res.empty() && embeddedCover)
-		res = getFromTrack( firstTrackPath, nbMaxCovers);
+	// Fallback on the embedded cover of the release tracks
+	if (res.empty())
+		res = getFromStore(coverHash);
 
 	return res;
 }
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+#include <openssl/sha.h>
+
+#include "logger/Logger.hpp"
+
+#include "CoverStore.hpp"
+
+namespace CoverArt {
+
+static const std::string markerFileName = ".lms-cover-store";
+
+// Cover, or temporary file left by an interrupted write
+static bool
+isStoreFile(const std::string& name)
+{
+	const std::size_t hashSize = 2 * SHA_DIGEST_LENGTH;
+
+	if (name.size() < hashSize || name.find_first_not_of("0123456789abcdef") < hashSize)
+		return false;
+
+	return name.size() == hashSize || boost::filesystem::path(name).extension() == ".tmp";
+}
+
+Store::Store()
+{
+}
+
+Store&
+Store::instance()
+{
+	static Store instance;
+	return instance;
+}
+
+void
+Store::setDirectory(const boost::filesystem::path& directory)
+{
+	_directory = directory;
+}
+
+std::string
+Store::computeHash(const std::vector<unsigned char>& data)
+{
+	unsigned char digest[SHA_DIGEST_LENGTH];
+	SHA1(data.data(), data.size(), digest);
+
+	std::ostringstream oss;
+	for (unsigned char byte : digest)
+		oss << std::hex << std::setw(2) << std::setfill('0') << static_cast<unsigned int>(byte);
+
+	return oss.str();
+}
+
+boost::filesystem::path
+Store::getStorePath(const std::string& hash) const
+{
+	// Spread the covers over sub directories
+	return _directory / hash.substr(0, 2) / hash;
+}
+
+bool
+Store::createDirectory() const
+{
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(_directory, ec);
+	if (ec)
+	{
+		LMS_LOG(COVER, ERROR) << "Cannot create cover store directory '" << _directory << "': " << ec.message();
+		return false;
+	}
+
+	std::ofstream marker((_directory / markerFileName).string());
+	if (!marker)
+	{
+		LMS_LOG(COVER, ERROR) << "Cannot create cover store marker in '" << _directory << "'";
+		return false;
+	}
+
+	return true;
+}
+
+std::string
+Store::add(const std::vector<unsigned char>& data)
+{
+	const std::string hash = computeHash(data);
+	const boost::filesystem::path path = getStorePath(hash);
+
+	boost::system::error_code ec;
+	if (boost::filesystem::exists(path, ec))
+		return hash;
+
+	// Only a new or empty directory is taken as a store
+	if ((!boost::filesystem::exists(_directory, ec) || boost::filesystem::is_empty(_directory, ec))
+			&& !createDirectory())
+		return "";
+
+	boost::filesystem::create_directories(path.parent_path(), ec);
+	if (ec)
+	{
+		LMS_LOG(COVER, ERROR) << "Cannot create cover store directory '" << path.parent_path() << "': " << ec.message();
+		return "";
+	}
+
+	// Several workers may add the same cover at the same time
+	boost::filesystem::path tmpPath = path;
+	tmpPath += boost::filesystem::unique_path(".%%%%%%%%.tmp");
+	{
+		std::ofstream ofs(tmpPath.string(), std::ios::binary);
+		ofs.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+		if (!ofs)
+		{
+			LMS_LOG(COVER, ERROR) << "Cannot write cover file '" << tmpPath << "'";
+			boost::filesystem::remove(tmpPath, ec);
+			return "";
+		}
+	}
+
+	boost::filesystem::rename(tmpPath, path, ec);
+	if (ec)
+	{
+		LMS_LOG(COVER, ERROR) << "Cannot rename cover file '" << tmpPath << "': " << ec.message();
+		boost::filesystem::remove(tmpPath, ec);
+		return "";
+	}
+
+	return hash;
+}
+
+boost::filesystem::path
+Store::getPath(const std::string& hash) const
+{
+	if (hash.empty())
+		return boost::filesystem::path();
+
+	const boost::filesystem::path path = getStorePath(hash);
+
+	boost::system::error_code ec;
+	if (!boost::filesystem::is_regular_file(path, ec))
+		return boost::filesystem::path();
+
+	return path;
+}
+
+std::size_t
+Store::removeUnused(const std::unordered_set<std::string>& usedHashes)
+{
+	std::size_t nbRemoved = 0;
+
+	boost::system::error_code ec;
+	if (!boost::filesystem::exists(_directory, ec))
+		return nbRemoved;
+
+	if (!boost::filesystem::is_regular_file(_directory / markerFileName, ec))
+	{
+		LMS_LOG(COVER, WARNING) << "No cover store marker in '" << _directory << "', unused covers not removed";
+		return nbRemoved;
+	}
+
+	boost::filesystem::recursive_directory_iterator itPath(_directory, ec);
+	boost::filesystem::recursive_directory_iterator itEnd;
+	while (!ec && itPath != itEnd)
+	{
+		const boost::filesystem::path path = itPath->path();
+		itPath.increment(ec);
+
+		boost::system::error_code statusEc;
+		if (!boost::filesystem::is_regular_file(path, statusEc))
+			continue;
+
+		const std::string name = path.filename().string();
+		if (!isStoreFile(name) || usedHashes.find(name) != usedHashes.end())
+			continue;
+
+		boost::filesystem::remove(path, statusEc);
+		if (!statusEc)
+			nbRemoved++;
+	}
+
+	return nbRemoved;
+}
+
+} // namespace CoverArt
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+namespace CoverArt {
+
+// On disk store of the embedded covers, keyed by content hash
+// Identical covers (typically the tracks of a release) are stored once
+// Thread safe: covers are written under a temporary name and atomically renamed
+// The store directory is created with a marker file: unused covers are only removed
+// from a directory that has it, so that a misconfigured path is never cleaned up
+class Store
+{
+	public:
+		Store(const Store&) = delete;
+		Store& operator=(const Store&) = delete;
+
+		static Store& instance();
+
+		void setDirectory(const boost::filesystem::path& directory);
+
+		static std::string computeHash(const std::vector<unsigned char>& data);
+
+		// Returns the hash of the cover, empty on error
+		std::string add(const std::vector<unsigned char>& data);
+
+		// Returns an empty path if the cover is not in the store
+		boost::filesystem::path getPath(const std::string& hash) const;
+
+		// Returns the number of removed covers
+		std::size_t removeUnused(const std::unordered_set<std::string>& usedHashes);
+
+	private:
+		Store();
+
+		boost::filesystem::path getStorePath(const std::string& hash) const;
+		bool createDirectory() const;
+
+		boost::filesystem::path _directory = "/var/lms/covers";
+};
+
+} // namespace CoverArt
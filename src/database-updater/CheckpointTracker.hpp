@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DB_UPDATER_CHECKPOINT_TRACKER_HPP
+#define DB_UPDATER_CHECKPOINT_TRACKER_HPP
+
+#include <deque>
+#include <mutex>
+
+#include <boost/filesystem/path.hpp>
+
+namespace DatabaseUpdater {
+
+// Keeps track of the files handed to the scan pipeline, in walk order
+// Files are completed out of order by the workers and the writer: the checkpoint
+// is the last file before which every file has been completed
+class CheckpointTracker
+{
+	public:
+
+		void clear()
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+
+			_firstId = 0;
+			_items.clear();
+			_lastRootDirectory.clear();
+			_lastFile.clear();
+		}
+
+		// Returns the id to be completed later
+		std::size_t add(const boost::filesystem::path& rootDirectory, const boost::filesystem::path& file)
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+
+			_items.push_back(Item {rootDirectory, file, false});
+			return _firstId + _items.size() - 1;
+		}
+
+		// Processed, successfully or not
+		void complete(std::size_t id)
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+
+			_items[id - _firstId].completed = true;
+
+			while (!_items.empty() && _items.front().completed)
+			{
+				_lastRootDirectory = std::move(_items.front().rootDirectory);
+				_lastFile = std::move(_items.front().file);
+
+				_items.pop_front();
+				++_firstId;
+			}
+		}
+
+		// True if all the files handed so far have been completed
+		bool isDrained() const
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+
+			return _items.empty();
+		}
+
+		// Returns false if no file has been completed yet
+		bool getCheckpoint(boost::filesystem::path& rootDirectory, boost::filesystem::path& file) const
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+
+			if (_lastFile.empty())
+				return false;
+
+			rootDirectory = _lastRootDirectory;
+			file = _lastFile;
+			return true;
+		}
+
+	private:
+
+		struct Item
+		{
+			boost::filesystem::path	rootDirectory;
+			boost::filesystem::path	file;
+			bool			completed;
+		};
+
+		mutable std::mutex		_mutex;
+		std::size_t			_firstId = 0;
+		std::deque<Item>		_items;
+		boost::filesystem::path		_lastRootDirectory;
+		boost::filesystem::path		_lastFile;
+};
+
+} // namespace DatabaseUpdater
+
+#endif
+
@@ -17,49 +17,163 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <fstream>
+#include <array>
+#include <cerrno>
+#include <cstring>
 #include <stdexcept>
 
-#include <boost/crc.hpp>  // for boost::crc_32_type
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
 
 #include "logger/Logger.hpp"
 
 #include "Checksum.hpp"
 
-typedef boost::crc_32_type crc_type;
+// Files are read rather than mapped: a file truncated during the scan would raise SIGBUS
+// on access to a mapping, whereas read() just returns less data
+static const std::size_t readBufferSize = 1024 * 1024;
+
+// The pages are dropped from the cache by chunks once hashed
+static const std::size_t dropSize = 8 * 1024 * 1024;
+
+// Reflected Castagnoli polynomial
+static const uint32_t crc32cPolynomial = 0x82F63B78;
+
+static uint32_t
+computeCrc32cSoftware(uint32_t crc, const unsigned char* data, std::size_t size)
+{
+	static const std::array<uint32_t, 256> table = []
+	{
+		std::array<uint32_t, 256> res;
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t value = i;
+			for (int bit = 0; bit < 8; ++bit)
+				value = (value & 1) ? (value >> 1) ^ crc32cPolynomial : (value >> 1);
+
+			res[i] = value;
+		}
+		return res;
+	}();
+
+	crc = ~crc;
+	for (; size > 0; --size)
+		crc = table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t
+computeCrc32cHardware(uint32_t crc, const unsigned char* data, std::size_t size)
+{
+	uint64_t crc64 = ~crc;
+
+	for (; size > 0 && (reinterpret_cast<uintptr_t>(data) & 7); --size)
+		crc64 = _mm_crc32_u8(static_cast<uint32_t>(crc64), *data++);
+
+	for (; size >= 8; size -= 8, data += 8)
+	{
+		uint64_t value;
+		std::memcpy(&value, data, sizeof(value));
+		crc64 = _mm_crc32_u64(crc64, value);
+	}
+
+	for (; size > 0; --size)
+		crc64 = _mm_crc32_u8(static_cast<uint32_t>(crc64), *data++);
 
-void computeCrc(const boost::filesystem::path& p, std::vector<unsigned char>& crc)
+	return ~static_cast<uint32_t>(crc64);
+}
+#endif
+
+bool
+isCrc32cHardwareAccelerated()
+{
+#if defined(__x86_64__)
+	static const bool accelerated = __builtin_cpu_supports("sse4.2");
+	return accelerated;
+#else
+	return false;
+#endif
+}
+
+uint32_t
+computeCrc32c(uint32_t crc, const unsigned char* data, std::size_t size)
 {
-	crc_type	result;
+#if defined(__x86_64__)
+	if (isCrc32cHardwareAccelerated())
+		return computeCrc32cHardware(crc, data, size);
+#endif
 
-	std::ifstream  ifs( p.string().c_str(), std::ios_base::binary );
+	return computeCrc32cSoftware(crc, data, size);
+}
+
+static bool
+computeCrc32cRead(int fd, uint32_t& crc)
+{
+	std::vector<unsigned char> buffer(readBufferSize);
+	off_t offset = 0;
+	off_t droppedOffset = 0;
 
-	if (ifs)
+	while (true)
 	{
-		do
+		ssize_t res = ::read(fd, buffer.data(), buffer.size());
+		if (res < 0)
 		{
-			std::array<char,1024>	buffer;
+			if (errno == EINTR)
+				continue;
 
-			ifs.read( buffer.data(), buffer.size() );
-			result.process_bytes( buffer.data(), ifs.gcount() );
+			return false;
+		}
+
+		if (res == 0)
+			return true;
+
+		crc = computeCrc32c(crc, buffer.data(), res);
+		offset += res;
+
+		// Hashed once, no need to keep these pages in the cache
+		if (offset - droppedOffset >= static_cast<off_t>(dropSize))
+		{
+			::posix_fadvise(fd, droppedOffset, offset - droppedOffset, POSIX_FADV_DONTNEED);
+			droppedOffset = offset;
 		}
-		while ( ifs );
 	}
-	else
+}
+
+ChecksumType
+computeChecksum(const boost::filesystem::path& p, std::vector<unsigned char>& checksum)
+{
+	int fd = ::open(p.string().c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
 	{
 		LMS_LOG(DBUPDATER, ERROR) << "Failed to open file '" << p << "'";
 		throw std::runtime_error("Failed to open file '" + p.string() + "'" );
 	}
 
-	// Copy back result into the vector
+	::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	uint32_t crc = 0;
+	const bool res = computeCrc32cRead(fd, crc);
 
-	// Copy the result into a vector of unsigned char
-	const crc_type::value_type checksum = result.checksum();
-	for (std::size_t i = 0; (i+1)*8 <= crc_type::bit_count; i++)
+	::close(fd);
+
+	if (!res)
 	{
-		const unsigned char* data = reinterpret_cast<const unsigned char*>( &checksum );
-		crc.push_back(data[i]);
+		LMS_LOG(DBUPDATER, ERROR) << "Failed to read file '" << p << "'";
+		throw std::runtime_error("Failed to read file '" + p.string() + "'" );
 	}
 
+	// Little endian, so that the stored checksums do not depend on the host
+	checksum.resize(sizeof(crc));
+	for (std::size_t i = 0; i < sizeof(crc); ++i)
+		checksum[i] = static_cast<unsigned char>(crc >> (8 * i));
+
+	return ChecksumType::Crc32c;
 }
 
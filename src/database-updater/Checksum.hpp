@@ -17,9 +17,28 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifndef DB_UPDATER_CHECKSUM_HPP
+#define DB_UPDATER_CHECKSUM_HPP
+
+#include <cstdint>
 #include <vector>
 #include <boost/filesystem.hpp>
 
+// Stored along with the checksums, do not change the values
+enum class ChecksumType
+{
+	Crc32	= 0,	// Legacy
+	Crc32c	= 1,	// Castagnoli, hardware accelerated if available
+};
+
+// Computes the checksum of the whole file
+// Throws on error
+ChecksumType computeChecksum(const boost::filesystem::path& p, std::vector<unsigned char>& checksum);
+
+bool isCrc32cHardwareAccelerated();
+
+// Incremental CRC32C: pass the previous result (0 to start)
+uint32_t computeCrc32c(uint32_t crc, const unsigned char* data, std::size_t size);
 
-void computeCrc(const boost::filesystem::path& p, std::vector<unsigned char>& checksum);
+#endif
 
@@ -18,10 +18,19 @@
  */
 
 
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unordered_set>
+
 #include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
 #include <boost/asio/placeholders.hpp>
 
+#include "av/AvTranscoder.hpp"
+#include "cover/CoverStore.hpp"
 #include "logger/Logger.hpp"
 #include "utils/Utils.hpp"
 
@@ -29,7 +38,6 @@
 
 #include "Checksum.hpp"
 #include "DatabaseUpdater.hpp"
-#include "cover/CoverArtGrabber.hpp"
 
 namespace {
 
@@ -82,36 +90,6 @@ isFileSupported(const boost::filesystem::path& file, const std::vector<boost::fi
 	return false;
 }
 
-std::vector<boost::filesystem::path>
-getRootDirectoriesByType(Wt::Dbo::Session& session, Database::MediaDirectory::Type type)
-{
-	Wt::Dbo::Transaction transaction(session);
-
-	std::vector<boost::filesystem::path> res;
-	std::vector<Database::MediaDirectory::pointer> rootDirs = Database::MediaDirectory::getByType(session, type);
-
-	for (auto rootDir : rootDirs)
-		res.push_back(rootDir->getPath());
-
-	return res;
-}
-
-bool
-isPathInParentPath(const boost::filesystem::path& path, const boost::filesystem::path& parentPath)
-{
-	boost::filesystem::path curPath = path;
-
-	while (curPath.has_parent_path())
-	{
-		curPath = curPath.parent_path();
-
-		if (curPath == parentPath)
-			return true;
-	}
-
-	return false;
-}
-
 } // namespace
 
 
@@ -119,12 +97,27 @@ namespace DatabaseUpdater {
 
 using namespace Database;
 
+// Max number of pending items between two scan stages, per worker
+static const std::size_t scanQueueSizePerWorker = 16;
 
-Updater::Updater(Wt::Dbo::SqlConnectionPool &connectionPool, MetaData::Parser& parser)
+Updater::Updater(Wt::Dbo::SqlConnectionPool &connectionPool, ParserFactory parserFactory)
  : _running(false),
+_connectionPool(connectionPool),
 _scheduleTimer(_ioService),
 _db(connectionPool),
-_metadataParser(parser)
+_nbScanWorkers(1),
+_nbScanWorkersPerDevice(0),
+_scanBatchSize(1),
+_scanBatchDuration(boost::posix_time::seconds(1)),
+_scanThrottling(false),
+_skipUnchangedDirectories(false),
+_updateDirectoryIndex(false),
+_saveCheckpoints(false),
+_dryRunReport(nullptr),
+_progressStats(nullptr),
+_progressResults(nullptr),
+_nextProgressListenerId(0),
+_parserFactory(parserFactory)
 {
 	_ioService.setThreadCount(1);
 }
@@ -134,6 +127,9 @@ Updater::start(void)
 {
 	_running = true;
 
+	if (!_progressReporter.joinable())
+		_progressReporter = boost::thread(boost::bind(&Updater::reportProgress, this));
+
 	// post some jobs in the io_service
 	processNextJob();
 
@@ -149,16 +145,188 @@ Updater::stop(void)
 	_scheduleTimer.cancel();
 
 	_ioService.stop();
+
+	if (_progressReporter.joinable())
+	{
+		_progressReporter.interrupt();
+		_progressReporter.join();
+	}
+}
+
+ScanProgress
+Updater::getProgress() const
+{
+	std::unique_lock<std::mutex> lock(_progressMutex);
+
+	ScanProgress progress = _progress;
+	if (progress.phase == ScanProgress::Phase::Idle)
+		return progress;
+
+	const boost::posix_time::ptime now = boost::posix_time::microsec_clock::local_time();
+	progress.phaseDurations[static_cast<std::size_t>(progress.phase)] += now - _progressPhaseStartTime;
+
+	if (_progressStats)
+	{
+		progress.nbWalked = _progressStats->nbWalked;
+		progress.nbSkipped = _progressStats->nbSkipped;
+		progress.nbScanned = _progressStats->nbScanned;
+		progress.nbScanErrors = _progressStats->nbScanErrors;
+		progress.nbNotImported = _progressStats->nbNotImported;
+		progress.nbAdded = _progressStats->nbAdded;
+		progress.nbRemoved = _progressStats->nbRemoved;
+		progress.nbModified = _progressStats->nbModified;
+		progress.nbBytesScanned = _progressStats->nbBytesScanned;
+	}
+
+	for (const ScanJobQueue* jobs : _progressJobs)
+		progress.jobQueueSize += jobs->size();
+	if (_progressResults)
+		progress.resultQueueSize = _progressResults->size();
+
+	const double walkSeconds = progress.phaseDurations[static_cast<std::size_t>(ScanProgress::Phase::Walk)].total_milliseconds() / 1000.;
+	if (walkSeconds > 0)
+	{
+		progress.filesPerSecond = progress.nbScanned / walkSeconds;
+		progress.bytesPerSecond = progress.nbBytesScanned / walkSeconds;
+	}
+
+	// Assume the library size has not changed much since the last scan
+	if (progress.phase == ScanProgress::Phase::Walk
+			&& walkSeconds > 0
+			&& progress.nbWalked > 0
+			&& progress.nbWalked < progress.nbExpectedFiles)
+	{
+		const double remainingSeconds = (progress.nbExpectedFiles - progress.nbWalked) * walkSeconds / progress.nbWalked;
+		progress.eta = boost::posix_time::seconds(static_cast<long>(remainingSeconds));
+	}
+
+	return progress;
+}
+
+std::size_t
+Updater::addProgressListener(ProgressListener listener)
+{
+	std::unique_lock<std::mutex> lock(_progressListenersMutex);
+
+	std::size_t id = _nextProgressListenerId++;
+	_progressListeners[id] = listener;
+
+	return id;
+}
+
+void
+Updater::removeProgressListener(std::size_t id)
+{
+	std::unique_lock<std::mutex> lock(_progressListenersMutex);
+
+	_progressListeners.erase(id);
+}
+
+void
+Updater::startProgress(const Stats& stats)
+{
+	std::unique_lock<std::mutex> lock(_progressMutex);
+
+	_progress = ScanProgress();
+	_progress.phase = ScanProgress::Phase::Walk;
+	_progress.startTime = boost::posix_time::microsec_clock::local_time();
+	_progress.nbExpectedFiles = _audioIndex.size() + _videoIndex.size();
+
+	_progressPhaseStartTime = _progress.startTime;
+	_progressStats = &stats;
+}
+
+void
+Updater::setProgressPhase(ScanProgress::Phase phase)
+{
+	std::unique_lock<std::mutex> lock(_progressMutex);
+
+	const boost::posix_time::ptime now = boost::posix_time::microsec_clock::local_time();
+
+	if (_progress.phase != ScanProgress::Phase::Idle)
+		_progress.phaseDurations[static_cast<std::size_t>(_progress.phase)] += now - _progressPhaseStartTime;
+
+	_progress.phase = phase;
+	_progressPhaseStartTime = now;
+}
+
+void
+Updater::setProgressQueues(std::vector<const ScanJobQueue*> jobs, const ScanResultQueue* results)
+{
+	std::unique_lock<std::mutex> lock(_progressMutex);
+
+	_progressJobs = std::move(jobs);
+	_progressResults = results;
+}
+
+void
+Updater::stopProgress()
+{
+	// Keep the figures of the last scan
+	ScanProgress progress = getProgress();
+	progress.phase = ScanProgress::Phase::Idle;
+	progress.jobQueueSize = 0;
+	progress.resultQueueSize = 0;
+	progress.eta = boost::posix_time::not_a_date_time;
+
+	std::unique_lock<std::mutex> lock(_progressMutex);
+
+	_progress = progress;
+	_progressStats = nullptr;
+}
+
+void
+Updater::reportProgress()
+{
+	ScanProgress::Phase lastPhase = ScanProgress::Phase::Idle;
+
+	try
+	{
+		while (true)
+		{
+			boost::this_thread::sleep_for(boost::chrono::seconds(1));
+
+			ScanProgress progress = getProgress();
+
+			// Also report the end of the scan, once
+			if (progress.phase == ScanProgress::Phase::Idle && lastPhase == ScanProgress::Phase::Idle)
+				continue;
+
+			lastPhase = progress.phase;
+
+			std::map<std::size_t, ProgressListener> listeners;
+			{
+				std::unique_lock<std::mutex> lock(_progressListenersMutex);
+				listeners = _progressListeners;
+			}
+
+			for (auto& listener : listeners)
+				listener.second(progress);
+		}
+	}
+	catch (boost::thread_interrupted&)
+	{
+	}
 }
 
 void
 Updater::processNextJob(void)
 {
+	bool scanInProgress;
+	{
+		Wt::Dbo::Transaction transaction(_db.getSession());
+		scanInProgress = ScanCheckpoint::get(_db.getSession())->getInProgress();
+	}
+
 	Wt::Dbo::Transaction transaction(_db.getSession());
 
 	MediaDirectorySettings::pointer settings = MediaDirectorySettings::get(_db.getSession());
 
-	if (settings->getManualScanRequested()) {
+	if (scanInProgress) {
+		LMS_LOG(DBUPDATER, INFO) << "Resuming interrupted scan";
+		scheduleScan( boost::posix_time::seconds(0) );
+	}
+	else if (settings->getManualScanRequested()) {
 		LMS_LOG(DBUPDATER, INFO) << "Manual scan requested!";
 		scheduleScan( boost::posix_time::seconds(0) );
 	}
@@ -220,56 +388,23 @@ Updater::process(boost::system::error_code err)
 {
 	if (!err)
 	{
-		updateFileExtensions();
-
-		Stats stats;
-
-		checkAudioFiles(stats);
-		checkVideoFiles(stats);
-
-		std::vector<RootDirectory> rootDirectories;
+		// Unchanged directories are only checked in depth periodically, or on user request
+		bool checkAllFiles;
 		{
 			Wt::Dbo::Transaction transaction(_db.getSession());
 
-			for (MediaDirectory::pointer directory : MediaDirectory::getAll(_db.getSession()))
-				rootDirectories.push_back( RootDirectory( directory->getType(), directory->getPath() ));
-		}
+			MediaDirectorySettings::pointer settings = MediaDirectorySettings::get(_db.getSession());
 
-		for (RootDirectory rootDirectory : rootDirectories)
-		{
-			if (!_running)
-				break;
+			const boost::posix_time::ptime lastFullScan = settings->getLastFullScan();
+			const boost::posix_time::time_duration fullScanPeriod = settings->getFullScanPeriod();
 
-			LMS_LOG(DBUPDATER, INFO) << "Processing root directory '" << rootDirectory.path << "'...";
-			processRootDirectory(rootDirectory, stats);
-			LMS_LOG(DBUPDATER, INFO) << "Processing root directory '" << rootDirectory.path << "' DONE";
+			checkAllFiles = settings->getManualScanRequested()
+				|| lastFullScan.is_special()
+				|| fullScanPeriod <= boost::posix_time::time_duration()
+				|| boost::posix_time::second_clock::local_time() - lastFullScan >= fullScanPeriod;
 		}
 
-		if (_running)
-			checkDuplicatedAudioFiles(stats);
-
-		LMS_LOG(DBUPDATER, INFO) << "Scan complete. Scanned = " << stats.nbScanned << ", Skipped = " << stats.nbSkipped << ", Changes = " << stats.nbChanges() << " (added = " << stats.nbAdded << ", nbRemoved = " << stats.nbRemoved << ", nbModified = " << stats.nbModified << "), Scan errors = " << stats.nbScanErrors << ", Not imported = " << stats.nbNotImported;
-
-		// Update database stats
-		boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
-		{
-			Wt::Dbo::Transaction transaction(_db.getSession());
-
-			Database::MediaDirectorySettings::pointer settings = Database::MediaDirectorySettings::get(_db.getSession());
-
-			if (stats.nbChanges() > 0)
-				settings.modify()->setLastUpdate(now);
-
-			// Save the last scan only if it has been completed
-			if (_running)
-				settings.modify()->setLastScan(now);
-
-			// If the manual scan was required we can now set it to done
-			// Update only if the scan is complete!
-			if (settings->getManualScanRequested() && _running)
-				settings.modify()->setManualScanRequested(false);
-
-		}
+		scan(checkAllFiles);
 
 		if (_running)
 			processNextJob();
@@ -277,348 +412,1478 @@ Updater::process(boost::system::error_code err)
 }
 
 void
-Updater::updateFileExtensions()
+Updater::scanNow(bool checkAllFiles)
 {
-	Wt::Dbo::Transaction transaction(_db.getSession());
-
-	_audioFileExtensions = MediaDirectorySettings::get(_db.getSession())->getAudioFileExtensions();
-	_videoFileExtensions = MediaDirectorySettings::get(_db.getSession())->getVideoFileExtensions();
+	_running = true;
+	scan(checkAllFiles);
+	_running = false;
 }
 
-Artist::pointer
-Updater::getArtist( const boost::filesystem::path& file, const std::string& name, const std::string& mbid)
+void
+Updater::dryRun(bool checkAllFiles, std::ostream& report)
 {
-	Artist::pointer artist;
-
-	// First try to get by MBID
-	if (!mbid.empty())
-	{
-		artist = Artist::getByMBID( _db.getSession(), mbid );
-		if (!artist)
-			artist = Artist::create( _db.getSession(), name, mbid);
-
-		return artist;
-	}
+	_running = true;
+	_dryRunReport = &report;
 
-	// Fall back on artist name (collisions may occur)
-	if (!name.empty())
-	{
-		for (Artist::pointer sameNamedArtist : Artist::getByName( _db.getSession(), name ))
-		{
-			if (sameNamedArtist->getMBID().empty())
-			{
-				artist = sameNamedArtist;
-				break;
-			}
-		}
+	updateSettings();
 
-		// No Artist found with the same name and without MBID -> creating
-		if (!artist)
-			artist = Artist::create( _db.getSession(), name);
+	Stats stats;
 
-		return artist;
-	}
+	std::vector<RootDirectory> rootDirectories = getRootDirectories();
 
-	return Artist::getNone( _db.getSession() );
-}
+	// Same walk as a real scan, without checkpoints nor directory states updates
+	loadPathIndexes();
+	loadDirectoryIndex();
 
-Release::pointer
-Updater::getRelease( const boost::filesystem::path& file, const std::string& name, const std::string& mbid)
-{
-	Release::pointer release;
+	startProgress(stats);
 
-	// First try to get by MBID
-	if (!mbid.empty())
-	{
-		release = Release::getByMBID( _db.getSession(), mbid );
-		if (!release)
-			release = Release::create( _db.getSession(), name, mbid);
+	_skipUnchangedDirectories = !checkAllFiles;
+	scanRootDirectories(rootDirectories, stats);
+	_skipUnchangedDirectories = false;
 
-		return release;
-	}
+	setProgressPhase(ScanProgress::Phase::RemoveMissing);
+	removeUnvisitedFiles(rootDirectories, stats);
 
-	// Fall back on release name (collisions may occur)
-	if (!name.empty())
-	{
-		for (Release::pointer sameNamedRelease : Release::getByName( _db.getSession(), name ))
-		{
-			if (sameNamedRelease->getMBID().empty())
-			{
-				release = sameNamedRelease;
-				break;
-			}
-		}
+	stopProgress();
 
-		// No release found with the same name and without MBID -> creating
-		if (!release)
-			release = Release::create( _db.getSession(), name);
+	_audioIndex.clear();
+	_videoIndex.clear();
+	_directoryIndex.clear();
 
-		return release;
-	}
+	reportSummary(stats);
 
-	return Release::getNone( _db.getSession() );
+	_dryRunReport = nullptr;
+	_running = false;
 }
 
-std::vector<Genre::pointer>
-Updater::getGenres( const std::list<std::string>& names)
+void
+Updater::scan(bool checkAllFiles)
 {
-	std::vector< Genre::pointer > genres;
-
-	for (const std::string& name : names)
-	{
-		Genre::pointer genre ( Genre::getByName(_db.getSession(), name) );
-		if (!genre)
-			genre = Genre::create(_db.getSession(), name);
-
-		genres.push_back( genre );
-	}
+	updateSettings();
 
-	if (genres.empty())
-		genres.push_back( Genre::getNone( _db.getSession() ));
+	Stats stats;
 
-	return genres;
-}
+	BulkImportMode bulkImportMode(_connectionPool);
 
-void
-Updater::processAudioFile( const boost::filesystem::path& file, Stats& stats)
-{
-	boost::posix_time::ptime lastWriteTime (boost::posix_time::from_time_t( boost::filesystem::last_write_time( file ) ) );
+	std::vector<RootDirectory> rootDirectories = getRootDirectories();
 
-	// Skip file if last write is the same
+	// Resume the previous scan if it has been interrupted
+	boost::filesystem::path resumeRootDirectory;
+	boost::filesystem::path resumeAfter;
 	{
 		Wt::Dbo::Transaction transaction(_db.getSession());
 
-		Wt::Dbo::ptr<Track> track = Track::getByPath(_db.getSession(), file);
-
-		if (track && track->getLastWriteTime() == lastWriteTime)
+		ScanCheckpoint::pointer checkpoint = ScanCheckpoint::get(_db.getSession());
+		if (checkpoint->getInProgress())
 		{
-			stats.nbSkipped++;
-			transaction.rollback();
-			return;
-		}
+			resumeRootDirectory = checkpoint->getRootDirectory();
+			resumeAfter = checkpoint->getLastPath();
+			stats.deserialize(checkpoint->getStats());
 
-		transaction.rollback();
+			LMS_LOG(DBUPDATER, INFO) << "Resuming scan of '" << resumeRootDirectory << "' after '" << resumeAfter << "'";
+		}
+		else
+			checkpoint.modify()->setInProgress(true);
 	}
 
-	MetaData::Items items;
-	if (!_metadataParser.parse(file, items))
-	{
-		stats.nbScanErrors++;
-		return;
-	}
+	// The changed tracks of an interrupted scan are lost, all the duplicates and counters have to be checked again
+	const bool duplicateCheckPending = setDuplicateCheckPending(true);
+	const bool countersUpdatePending = setCountersUpdatePending(true);
 
-	stats.nbScanned++;
+	// Single pass: the files that have not been walked are the removed ones
+	loadPathIndexes();
+	loadDirectoryIndex();
 
-	std::vector<unsigned char> checksum ;
-	computeCrc(file, checksum);
+	if (!checkAllFiles)
+		LMS_LOG(DBUPDATER, INFO) << "Skipping the files of unchanged directories";
 
-	Wt::Dbo::Transaction transaction(_db.getSession());
+	startProgress(stats);
 
-	Wt::Dbo::ptr<Track> track = Track::getByPath(_db.getSession(), file);
+	_saveCheckpoints = true;
+	_updateDirectoryIndex = true;
+	_skipUnchangedDirectories = !checkAllFiles;
+	scanRootDirectories(rootDirectories, stats, resumeRootDirectory, resumeAfter);
+	_saveCheckpoints = false;
+	_updateDirectoryIndex = false;
+	_skipUnchangedDirectories = false;
 
-	// We estimate this is a audio file if:
-	// - we found a least one audio stream
-	// - the duration is not null
-	if (items.find(MetaData::Type::AudioStreams) == items.end()
-			|| boost::any_cast<std::vector<MetaData::AudioStream> >(items[MetaData::Type::AudioStreams]).empty())
-	{
-		LMS_LOG(DBUPDATER, INFO) << "Skipped '" << file << "' (no audio stream found)";
+	setProgressPhase(ScanProgress::Phase::RemoveMissing);
+	if (_running)
+		removeUnvisitedFiles(rootDirectories, stats);
 
-		// If Track exists here, delete it!
-		if (track)
-		{
-			track.remove();
-			stats.nbRemoved++;
-		}
-		stats.nbNotImported++;
-		return;
-	}
-	if (items.find(MetaData::Type::Duration) == items.end()
-			|| boost::any_cast<boost::posix_time::time_duration>(items[MetaData::Type::Duration]).total_seconds() <= 0)
-	{
-		LMS_LOG(DBUPDATER, INFO) << "Skipped '" << file << "' (no duration or duration <= 0)";
+	// Free some memory
+	_audioIndex.clear();
+	_videoIndex.clear();
 
-		// If Track exists here, delete it!
-		if (track)
-		{
-			track.remove();
-			stats.nbRemoved++;
-		}
-		stats.nbNotImported++;
-		return;
-	}
+	// Removed or modified files may have left some entities without tracks
+	setProgressPhase(ScanProgress::Phase::RemoveOrphans);
+	if (_running)
+		removeOrphans();
 
-	// ***** Title
-	std::string title;
-	if (items.find(MetaData::Type::Title) != items.end())
+	// Full scans rebuild the whole duplicate list, the other ones only check the changed tracks
+	setProgressPhase(ScanProgress::Phase::Duplicates);
+	if (_running)
 	{
-		title = boost::any_cast<std::string>(items[MetaData::Type::Title]);
+		checkDuplicatedAudioFiles(checkAllFiles || duplicateCheckPending);
+		setDuplicateCheckPending(false);
 	}
-	else
+
+	// Same for the counters
+	setProgressPhase(ScanProgress::Phase::Counters);
+	if (_running)
 	{
-		// TODO parse file name guess track etc.
-		// For now juste use file name as title
-		title = file.filename().string();
+		updateCounters(checkAllFiles || countersUpdatePending);
+		setCountersUpdatePending(false);
 	}
 
-	// ***** Genres
-	std::vector< Genre::pointer > genres;
+	stopProgress();
+
+	LMS_LOG(DBUPDATER, INFO) << "Scan complete. Scanned = " << stats.nbScanned << ", Skipped = " << stats.nbSkipped << ", Changes = " << stats.nbChanges() << " (added = " << stats.nbAdded << ", nbRemoved = " << stats.nbRemoved << ", nbModified = " << stats.nbModified << "), Scan errors = " << stats.nbScanErrors << ", Not imported = " << stats.nbNotImported;
+
+	// Update database stats
+	boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
 	{
-		std::list<std::string> genreList;
+		Wt::Dbo::Transaction transaction(_db.getSession());
 
-		if (items.find(MetaData::Type::Genres) != items.end())
-			genreList = boost::any_cast< std::list<std::string> > (items[MetaData::Type::Genres]);
+		Database::MediaDirectorySettings::pointer settings = Database::MediaDirectorySettings::get(_db.getSession());
 
-		genres = getGenres( genreList );
-	}
-	assert( !genres.empty() );
+		if (stats.nbChanges() > 0)
+			settings.modify()->setLastUpdate(now);
 
-	//  ***** Artist
-	Artist::pointer artist;
-	{
-		std::string artistName;
-		std::string artistMusicBrainzID;
+		// Save the last scan only if it has been completed
+		if (_running)
+			settings.modify()->setLastScan(now);
 
-		if (items.find(MetaData::Type::MusicBrainzArtistID) != items.end())
-			artistMusicBrainzID = boost::any_cast<std::string>(items[MetaData::Type::MusicBrainzArtistID] );
+		if (_running && checkAllFiles)
+			settings.modify()->setLastFullScan(now);
 
-		if (items.find(MetaData::Type::Artist) != items.end())
-			artistName = boost::any_cast<std::string>(items[MetaData::Type::Artist]);
+		// If the manual scan was required we can now set it to done
+		// Update only if the scan is complete!
+		if (settings->getManualScanRequested() && _running)
+			settings.modify()->setManualScanRequested(false);
 
-		artist = getArtist(file, artistName, artistMusicBrainzID);
 	}
-	assert(artist);
 
-	//  ***** Release
-	Release::pointer release;
+	// Directory states are only trusted once all their files have been written
+	if (_running)
+		saveDirectoryIndex(!resumeRootDirectory.empty());
+	_directoryIndex.clear();
+
+	if (_running)
 	{
-		std::string releaseName;
-		std::string releaseMusicBrainzID;
+		Wt::Dbo::Transaction transaction(_db.getSession());
 
-		if (items.find(MetaData::Type::MusicBrainzAlbumID) != items.end())
-			releaseMusicBrainzID = boost::any_cast<std::string>(items[MetaData::Type::MusicBrainzAlbumID] );
+		ScanCheckpoint::get(_db.getSession()).modify()->reset();
+	}
+}
 
-		if (items.find(MetaData::Type::Album) != items.end())
-			releaseName = boost::any_cast<std::string>(items[MetaData::Type::Album]);
+std::vector<Updater::RootDirectory>
+Updater::getRootDirectories()
+{
+	std::vector<RootDirectory> rootDirectories;
 
-		release = getRelease(file, releaseName, releaseMusicBrainzID);
-	}
-	assert(release);
+	Wt::Dbo::Transaction transaction(_db.getSession());
 
-	// If file already exist, update data
+	for (MediaDirectory::pointer directory : MediaDirectory::getAll(_db.getSession()))
+		rootDirectories.push_back( RootDirectory( directory->getType(), directory->getPath() ));
+
+	return rootDirectories;
+}
+
+void
+Updater::updatePaths(const std::vector<boost::filesystem::path>& paths)
+{
+	// Serialized with the full scans
+	_ioService.post(boost::bind(&Updater::processPaths, this, paths));
+}
+
+void
+Updater::processPaths(std::vector<boost::filesystem::path> paths)
+{
+	if (!_running)
+		return;
+
+	updateSettings();
+
+	Stats stats;
+
+	// Only consider the paths that belong to a root directory,
+	// and only load the database entries located under them
+	std::vector<RootDirectory> allRootDirectories = getRootDirectories();
+	std::vector<RootDirectory> rootDirectories;
+
+	_audioIndex.clear();
+	_videoIndex.clear();
+	{
+		Wt::Dbo::Transaction transaction(_db.getSession());
+
+		for (const boost::filesystem::path& path : paths)
+		{
+			auto itRootDirectory = std::find_if(allRootDirectories.begin(), allRootDirectories.end(),
+					[&](const RootDirectory& rootDirectory)
+					{
+						return path == rootDirectory.path || isPathInParentPath(path, rootDirectory.path);
+					});
+
+			if (itRootDirectory == allRootDirectories.end())
+			{
+				LMS_LOG(DBUPDATER, DEBUG) << "Ignoring '" << path << "': not in a root directory";
+				continue;
+			}
+
+			rootDirectories.push_back(RootDirectory(itRootDirectory->type, path));
+
+			switch (itRootDirectory->type)
+			{
+				case MediaDirectory::Audio:
+					for (const Track::FileInfoQueryResult& fileInfo : Track::getFileInfosUnder(_db.getSession(), path))
+						_audioIndex.set(fileInfo.get<1>(), PathIndex::Entry {fileInfo.get<0>(), fileInfo.get<2>(), fileInfo.get<3>(), false});
+					break;
+
+				case MediaDirectory::Video:
+					for (const Video::FileInfoQueryResult& fileInfo : Video::getFileInfosUnder(_db.getSession(), path))
+						_videoIndex.set(fileInfo.get<1>(), PathIndex::Entry {fileInfo.get<0>(), fileInfo.get<2>(), fileInfo.get<3>(), false});
+					break;
+			}
+		}
+	}
+
+	if (rootDirectories.empty())
+		return;
+
+	LMS_LOG(DBUPDATER, INFO) << "Updating " << rootDirectories.size() << " changed path(s)...";
+
+	const bool duplicateCheckPending = setDuplicateCheckPending(true);
+	const bool countersUpdatePending = setCountersUpdatePending(true);
+
+	scanRootDirectories(rootDirectories, stats);
+
+	if (_running)
+		removeUnvisitedFiles(allRootDirectories, stats);
+
+	_audioIndex.clear();
+	_videoIndex.clear();
+
+	if (stats.nbRemoved > 0 || stats.nbModified > 0)
+		removeOrphans();
+
+	if (_running)
+	{
+		if (duplicateCheckPending || !_changedDuplicateKeys.empty())
+			checkDuplicatedAudioFiles(duplicateCheckPending);
+		setDuplicateCheckPending(false);
+	}
+
+	if (_running)
+	{
+		if (countersUpdatePending || !_changedCounterEntities.empty())
+			updateCounters(countersUpdatePending);
+		setCountersUpdatePending(false);
+	}
+
+	LMS_LOG(DBUPDATER, INFO) << "Update complete. Changes = " << stats.nbChanges() << " (added = " << stats.nbAdded << ", nbRemoved = " << stats.nbRemoved << ", nbModified = " << stats.nbModified << "), Scan errors = " << stats.nbScanErrors << ", Not imported = " << stats.nbNotImported;
+
+	if (stats.nbChanges() > 0)
+	{
+		Wt::Dbo::Transaction transaction(_db.getSession());
+
+		MediaDirectorySettings::get(_db.getSession()).modify()->setLastUpdate(boost::posix_time::second_clock::local_time());
+	}
+}
+
+void
+Updater::removeUnvisitedFiles(const std::vector<RootDirectory>& rootDirectories, Stats& stats)
+{
+	LMS_LOG(DBUPDATER, DEBUG) << "Removing missing files...";
+
+	std::vector<boost::filesystem::path> audioRootDirs;
+	std::vector<boost::filesystem::path> videoRootDirs;
+	for (const RootDirectory& rootDirectory : rootDirectories)
+	{
+		switch (rootDirectory.type)
+		{
+			case MediaDirectory::Audio: audioRootDirs.push_back(rootDirectory.path); break;
+			case MediaDirectory::Video: videoRootDirs.push_back(rootDirectory.path); break;
+		}
+	}
+
+	// Group the removals, as for the writes
+	std::unique_ptr<Wt::Dbo::Transaction> transaction;
+	std::size_t nbPendingRemovals = 0;
+
+	auto removeFile = [&](const std::string& path, const PathIndex::Entry& entry, MediaDirectory::Type type)
+	{
+		// Not walked: either removed, moved out of the roots or no longer supported
+		// Files located where the walk failed or did not go may just not have been reached, hence the final check
+		if (entry.visited || entry.id == -1)
+			return;
+
+		if (isUnwalkedPath(path))
+		{
+			if (type == MediaDirectory::Audio && checkFile(path, audioRootDirs, _audioFileExtensions))
+				return;
+			if (type == MediaDirectory::Video && checkFile(path, videoRootDirs, _videoFileExtensions))
+				return;
+		}
+
+		if (_dryRunReport)
+		{
+			reportChange("removed", path, "not found in the media directories");
+			stats.nbRemoved++;
+			return;
+		}
+
+		if (!transaction)
+			transaction.reset(new Wt::Dbo::Transaction(_db.getSession()));
+
+		if (type == MediaDirectory::Audio)
+		{
+			Track::pointer track = Track::getById(_db.getSession(), entry.id);
+			if (track)
+			{
+				_changedDuplicateKeys.add(*track);
+				_changedCounterEntities.add(*track);
+				track.remove();
+				stats.nbRemoved++;
+			}
+		}
+		else
+		{
+			Video::pointer video = Video::getById(_db.getSession(), entry.id);
+			if (video)
+			{
+				video.remove();
+				stats.nbRemoved++;
+			}
+		}
+
+		if (++nbPendingRemovals >= _scanBatchSize)
+		{
+			transaction->commit();
+			transaction.reset();
+			nbPendingRemovals = 0;
+		}
+	};
+
+	for (const auto& entry : _audioIndex)
+		removeFile(entry.first, entry.second, MediaDirectory::Audio);
+
+	for (const auto& entry : _videoIndex)
+		removeFile(entry.first, entry.second, MediaDirectory::Video);
+
+	if (transaction)
+		transaction->commit();
+}
+
+void
+Updater::updateSettings()
+{
+	Wt::Dbo::Transaction transaction(_db.getSession());
+
+	MediaDirectorySettings::pointer settings = MediaDirectorySettings::get(_db.getSession());
+
+	_audioFileExtensions = settings->getAudioFileExtensions();
+	_videoFileExtensions = settings->getVideoFileExtensions();
+
+	if (settings->getScanWorkerCount() > 0)
+		_nbScanWorkers = settings->getScanWorkerCount();
+	else
+		_nbScanWorkers = std::max(1U, boost::thread::hardware_concurrency());
+
+	_nbScanWorkersPerDevice = std::max(0, settings->getScanWorkersPerDevice());
+
+	_scanBatchSize = std::max(1, settings->getScanBatchSize());
+	_scanBatchDuration = settings->getScanBatchDuration();
+	if (_scanBatchDuration <= boost::posix_time::time_duration())
+		_scanBatchDuration = boost::posix_time::seconds(1);
+
+	_scanThrottling = settings->getScanThrottling();
+	_scanThrottler.setLimits(std::max(0, settings->getScanMaxFilesPerSecond()),
+			static_cast<unsigned long long>(std::max(0, settings->getScanMaxMBytesPerSecond())) * 1024 * 1024);
+}
+
+Artist::pointer
+Updater::getArtist( const boost::filesystem::path& file, const std::string& name, const std::string& mbid)
+{
+	Artist::pointer artist;
+
+	// First try to get by MBID
+	if (!mbid.empty())
+	{
+		auto itArtist = _entityCache.artistsByMBID.find(mbid);
+		if (itArtist != _entityCache.artistsByMBID.end())
+			return itArtist->second;
+
+		artist = Artist::getByMBID( _db.getSession(), mbid );
+		if (!artist)
+			artist = Artist::create( _db.getSession(), name, mbid);
+
+		_entityCache.artistsByMBID[mbid] = artist;
+
+		return artist;
+	}
+
+	// Fall back on artist name (collisions may occur)
+	if (!name.empty())
+	{
+		auto itArtist = _entityCache.artistsByName.find(name);
+		if (itArtist != _entityCache.artistsByName.end())
+			return itArtist->second;
+
+		for (Artist::pointer sameNamedArtist : Artist::getByName( _db.getSession(), name ))
+		{
+			if (sameNamedArtist->getMBID().empty())
+			{
+				artist = sameNamedArtist;
+				break;
+			}
+		}
+
+		// No Artist found with the same name and without MBID -> creating
+		if (!artist)
+			artist = Artist::create( _db.getSession(), name);
+
+		_entityCache.artistsByName[name] = artist;
+
+		return artist;
+	}
+
+	if (!_entityCache.noneArtist)
+		_entityCache.noneArtist = Artist::getNone( _db.getSession() );
+
+	return _entityCache.noneArtist;
+}
+
+Release::pointer
+Updater::getRelease( const boost::filesystem::path& file, const std::string& name, const std::string& mbid)
+{
+	Release::pointer release;
+
+	// First try to get by MBID
+	if (!mbid.empty())
+	{
+		auto itRelease = _entityCache.releasesByMBID.find(mbid);
+		if (itRelease != _entityCache.releasesByMBID.end())
+			return itRelease->second;
+
+		release = Release::getByMBID( _db.getSession(), mbid );
+		if (!release)
+			release = Release::create( _db.getSession(), name, mbid);
+
+		_entityCache.releasesByMBID[mbid] = release;
+
+		return release;
+	}
+
+	// Fall back on release name (collisions may occur)
+	if (!name.empty())
+	{
+		auto itRelease = _entityCache.releasesByName.find(name);
+		if (itRelease != _entityCache.releasesByName.end())
+			return itRelease->second;
+
+		for (Release::pointer sameNamedRelease : Release::getByName( _db.getSession(), name ))
+		{
+			if (sameNamedRelease->getMBID().empty())
+			{
+				release = sameNamedRelease;
+				break;
+			}
+		}
+
+		// No release found with the same name and without MBID -> creating
+		if (!release)
+			release = Release::create( _db.getSession(), name);
+
+		_entityCache.releasesByName[name] = release;
+
+		return release;
+	}
+
+	if (!_entityCache.noneRelease)
+		_entityCache.noneRelease = Release::getNone( _db.getSession() );
+
+	return _entityCache.noneRelease;
+}
+
+std::vector<Genre::pointer>
+Updater::getGenres( const MetaData::Genres& names)
+{
+	std::vector< Genre::pointer > genres;
+
+	for (const std::string& name : names)
+	{
+		Genre::pointer& genre = _entityCache.genresByName[name];
+		if (!genre)
+			genre = Genre::getByName(_db.getSession(), name);
+		if (!genre)
+			genre = Genre::create(_db.getSession(), name);
+
+		genres.push_back( genre );
+	}
+
+	if (genres.empty())
+	{
+		if (!_entityCache.noneGenre)
+			_entityCache.noneGenre = Genre::getNone( _db.getSession() );
+
+		genres.push_back( _entityCache.noneGenre );
+	}
+
+	return genres;
+}
+
+void
+Updater::writeAudioFile( ScanResult& result, Stats& stats)
+{
+	const boost::filesystem::path& file = result.job.file;
+	MetaData::Items& items = result.items;
+
+	Wt::Dbo::ptr<Track> track;
+	if (result.job.dbId != -1)
+		track = Track::getById(_db.getSession(), result.job.dbId);
+
+	// The duplicates and the counters of the previous version of the track have to be checked again too
+	if (track)
+	{
+		_changedDuplicateKeys.add(*track);
+		_changedCounterEntities.add(*track);
+	}
+
+	std::string reason;
+	if (!checkAudioFile(items, reason))
+	{
+		LMS_LOG(DBUPDATER, INFO) << "Skipped '" << file << "' (" << reason << ")";
+
+		// If Track exists here, delete it!
+		if (track)
+		{
+			track.remove();
+			stats.nbRemoved++;
+		}
+		stats.nbNotImported++;
+		return;
+	}
+
+	// ***** Title
+	// TODO parse file name guess track etc.
+	// For now juste use file name as title
+	if (items.title.empty())
+		items.title = file.filename().string();
+
+	// ***** Genres
+	std::vector< Genre::pointer > genres = getGenres( items.genres );
+	assert( !genres.empty() );
+
+	//  ***** Artist
+	Artist::pointer artist = getArtist(file, items.artist, items.musicBrainzArtistID);
+	assert(artist);
+
+	//  ***** Release
+	Release::pointer release = getRelease(file, items.album, items.musicBrainzAlbumID);
+	assert(release);
+
+	// If file already exist, update data
 	// Otherwise, create it
 	if (!track)
 	{
-		// Create a new song
-		track = Track::create(_db.getSession(), file);
-		LMS_LOG(DBUPDATER, INFO) << "Adding '" << file << "'";
-		stats.nbAdded++;
+		// Create a new song
+		track = Track::create(_db.getSession(), file);
+		LMS_LOG(DBUPDATER, INFO) << "Adding '" << file << "'";
+		stats.nbAdded++;
+	}
+	else
+	{
+		LMS_LOG(DBUPDATER, INFO) << "Updating '" << file << "'";
+		stats.nbModified++;
+	}
+
+	assert(track);
+
+	track.modify()->setChecksum(result.checksum);
+	track.modify()->setChecksumType(static_cast<int>(result.checksumType));
+	track.modify()->setArtist(artist);
+	track.modify()->setRelease(release);
+	track.modify()->setLastWriteTime(result.job.lastWriteTime);
+	track.modify()->setFileSize(result.job.fileSize);
+	track.modify()->setName(items.title);
+	track.modify()->setDuration(items.duration);
+	track.modify()->setAddedTime( boost::posix_time::second_clock::local_time() );
+
+	{
+		std::string trackGenreList;
+		// Product genre list
+		for (Genre::pointer genre : genres)
+		{
+			if (!trackGenreList.empty())
+				trackGenreList += ", ";
+			trackGenreList += genre->getName();
+		}
+
+		track.modify()->setGenres( trackGenreList );
+	}
+	track.modify()->setGenres( genres );
+
+	if (items.trackNumber)
+		track.modify()->setTrackNumber( *items.trackNumber );
+
+	if (items.totalTrack)
+		track.modify()->setTotalTrackNumber( *items.totalTrack );
+
+	if (items.discNumber)
+		track.modify()->setDiscNumber( *items.discNumber );
+
+	if (items.totalDisc)
+		track.modify()->setTotalDiscNumber( *items.totalDisc );
+
+	if (items.date)
+		track.modify()->setDate( *items.date );
+
+	if (items.originalDate)
+	{
+		track.modify()->setOriginalDate( *items.originalDate );
+
+		// If a file has an OriginalDate but no date, set the date to ease filtering
+		if (!items.date)
+			track.modify()->setDate( *items.originalDate );
+	}
+
+	if (!items.musicBrainzTrackID.empty())
+		track.modify()->setMBID( items.musicBrainzTrackID );
+
+	track.modify()->setCoverType( items.hasCover ? Track::CoverType::Embedded : Track::CoverType::None );
+	track.modify()->setCoverHash( result.coverHash );
+
+	_changedDuplicateKeys.add(*track);
+	_changedCounterEntities.add(artist, release, genres);
+}
+
+
+bool
+Updater::checkAudioFile(const MetaData::Items& items, std::string& reason)
+{
+	// We estimate this is a audio file if:
+	// - we found a least one audio stream
+	// - the duration is not null
+	if (items.audioStreams.empty())
+	{
+		reason = "no audio stream found";
+		return false;
+	}
+	if (items.duration.total_seconds() <= 0)
+	{
+		reason = "no duration or duration <= 0";
+		return false;
+	}
+
+	return true;
+}
+
+void
+Updater::loadPathIndexes()
+{
+	Wt::Dbo::Transaction transaction(_db.getSession());
+
+	// Sized upfront (one COUNT query) to avoid rehashing large indexes while loading
+	Wt::Dbo::collection<Track::FileInfoQueryResult> trackFileInfos = Track::getAllFileInfos(_db.getSession());
+	_audioIndex.clear();
+	_audioIndex.reserve(trackFileInfos.size());
+	for (const Track::FileInfoQueryResult& fileInfo : trackFileInfos)
+		_audioIndex.set(fileInfo.get<1>(), PathIndex::Entry {fileInfo.get<0>(), fileInfo.get<2>(), fileInfo.get<3>(), false});
+
+	Wt::Dbo::collection<Video::FileInfoQueryResult> videoFileInfos = Video::getAllFileInfos(_db.getSession());
+	_videoIndex.clear();
+	_videoIndex.reserve(videoFileInfos.size());
+	for (const Video::FileInfoQueryResult& fileInfo : videoFileInfos)
+		_videoIndex.set(fileInfo.get<1>(), PathIndex::Entry {fileInfo.get<0>(), fileInfo.get<2>(), fileInfo.get<3>(), false});
+
+	LMS_LOG(DBUPDATER, DEBUG) << "Loaded " << _audioIndex.size() << " track(s) and " << _videoIndex.size() << " video(s) from database";
+}
+
+void
+Updater::loadDirectoryIndex()
+{
+	Wt::Dbo::Transaction transaction(_db.getSession());
+
+	_directoryIndex.clear();
+	for (const ScannedDirectory::pointer& directory : ScannedDirectory::getAll(_db.getSession()))
+		_directoryIndex.set(directory->getPath().string(), DirectoryIndex::Entry {directory->getLastWriteTime(), directory->getNbEntries(), directory.id(), false, false});
+
+	LMS_LOG(DBUPDATER, DEBUG) << "Loaded " << _directoryIndex.size() << " directories from database";
+}
+
+void
+Updater::saveDirectoryIndex(bool keepUnvisited)
+{
+	Wt::Dbo::Transaction transaction(_db.getSession());
+
+	// Only write the new, changed and removed directories
+	// When resuming a scan, the directories located before the checkpoint have not been walked again
+	std::size_t nbWrites = 0;
+	for (const auto& entry : _directoryIndex)
+	{
+		const DirectoryIndex::Entry& state = entry.second;
+
+		if (state.id == -1)
+		{
+			ScannedDirectory::create(_db.getSession(), entry.first, state.lastWriteTime, state.nbEntries);
+			nbWrites++;
+		}
+		else if (state.visited && state.changed)
+		{
+			ScannedDirectory::pointer directory = ScannedDirectory::getById(_db.getSession(), state.id);
+			if (directory)
+				directory.modify()->setState(state.lastWriteTime, state.nbEntries);
+			nbWrites++;
+		}
+		else if (!state.visited && !keepUnvisited)
+		{
+			ScannedDirectory::pointer directory = ScannedDirectory::getById(_db.getSession(), state.id);
+			if (directory)
+				directory.remove();
+			nbWrites++;
+		}
+	}
+
+	LMS_LOG(DBUPDATER, DEBUG) << "Saved " << nbWrites << " directory state changes";
+}
+
+void
+Updater::scanRootDirectories(const std::vector<RootDirectory>& rootDirectories, Stats& stats,
+		const boost::filesystem::path& resumeRootDirectory,
+		const boost::filesystem::path& resumeAfter)
+{
+	// Skip the root directories that have already been walked
+	std::size_t resumeIndex = 0;
+	boost::filesystem::path resumeAfterPath;
+	if (!resumeRootDirectory.empty())
+	{
+		auto itRootDirectory = std::find_if(rootDirectories.begin(), rootDirectories.end(),
+				[&](const RootDirectory& rootDirectory) { return rootDirectory.path == resumeRootDirectory; });
+
+		if (itRootDirectory == rootDirectories.end())
+			LMS_LOG(DBUPDATER, INFO) << "Root directories have changed, cannot resume the scan";
+		else
+		{
+			resumeIndex = std::distance(rootDirectories.begin(), itRootDirectory);
+			resumeAfterPath = resumeAfter;
+		}
+	}
+
+	_unwalkedPaths.clear();
+	for (std::size_t i = 0; i < resumeIndex; ++i)
+		_unwalkedPaths.insert(rootDirectories[i].path.string());
+	if (!resumeAfterPath.empty())
+		_unwalkedPaths.insert(rootDirectories[resumeIndex].path.string());
+
+	// Group the root directories by device, keeping the scan order
+	_deviceScans.clear();
+	for (std::size_t i = 0; i < rootDirectories.size(); ++i)
+	{
+		struct stat rootStat;
+		const dev_t device = (::stat(rootDirectories[i].path.string().c_str(), &rootStat) == 0) ? rootStat.st_dev : 0;
+
+		auto itDeviceScan = std::find_if(_deviceScans.begin(), _deviceScans.end(),
+				[&](const std::unique_ptr<DeviceScan>& deviceScan) { return deviceScan->device == device; });
+
+		if (itDeviceScan == _deviceScans.end())
+		{
+			_deviceScans.emplace_back(new DeviceScan);
+			_deviceScans.back()->device = device;
+			itDeviceScan = std::prev(_deviceScans.end());
+		}
+
+		(*itDeviceScan)->rootDirectories.push_back(rootDirectories[i]);
+		(*itDeviceScan)->rootDirectoryIndexes.push_back(i);
+	}
+
+	// Workers are shared among the devices, within the per device limit
+	std::size_t nbWorkersPerDevice = std::max<std::size_t>(1, _nbScanWorkers / std::max<std::size_t>(1, _deviceScans.size()));
+	if (_nbScanWorkersPerDevice > 0)
+		nbWorkersPerDevice = std::min(nbWorkersPerDevice, _nbScanWorkersPerDevice);
+
+	ScanResultQueue results(_nbScanWorkers * scanQueueSizePerWorker);
+
+	LMS_LOG(DBUPDATER, INFO) << "Starting scan of " << _deviceScans.size() << " device(s) using " << nbWorkersPerDevice << " worker(s) per device" << (_scanThrottling ? ", throttled" : "");
+
+	boost::thread_group workers;
+	std::vector<const ScanJobQueue*> jobQueues;
+	for (std::unique_ptr<DeviceScan>& deviceScan : _deviceScans)
+	{
+		deviceScan->jobs.reset(new ScanJobQueue(nbWorkersPerDevice * scanQueueSizePerWorker));
+		jobQueues.push_back(deviceScan->jobs.get());
+
+		for (std::size_t i = 0; i < nbWorkersPerDevice; ++i)
+			workers.create_thread(boost::bind(&Updater::parseFiles, this, boost::ref(*deviceScan->jobs), boost::ref(results), boost::ref(stats)));
+	}
+
+	boost::thread writer(boost::bind(&Updater::writeFiles, this, boost::ref(results), boost::ref(stats)));
+
+	setProgressQueues(jobQueues, &results);
+
+	// One walker per device, the first one in the calling thread
+	boost::thread_group walkers;
+	for (std::size_t i = 1; i < _deviceScans.size(); ++i)
+		walkers.create_thread(boost::bind(&Updater::walkDevice, this, boost::ref(*_deviceScans[i]), resumeIndex, boost::cref(resumeAfterPath), boost::ref(stats)));
+
+	if (!_deviceScans.empty())
+		walkDevice(*_deviceScans.front(), resumeIndex, resumeAfterPath, stats);
+
+	// Flush the pipeline, stage by stage
+	walkers.join_all();
+	workers.join_all();
+
+	results.close();
+	writer.join();
+
+	setProgressQueues(std::vector<const ScanJobQueue*>(), nullptr);
+
+	_deviceScans.clear();
+}
+
+void
+Updater::walkDevice(DeviceScan& deviceScan, std::size_t resumeIndex, const boost::filesystem::path& resumeAfter, Stats& stats)
+{
+	for (std::size_t i = 0; i < deviceScan.rootDirectories.size(); ++i)
+	{
+		if (!_running)
+			break;
+
+		const std::size_t rootDirectoryIndex = deviceScan.rootDirectoryIndexes[i];
+		if (rootDirectoryIndex < resumeIndex)
+			continue;
+
+		const RootDirectory& rootDirectory = deviceScan.rootDirectories[i];
+
+		LMS_LOG(DBUPDATER, INFO) << "Processing root directory '" << rootDirectory.path << "'...";
+		processRootDirectory(rootDirectory, rootDirectoryIndex == resumeIndex ? resumeAfter : boost::filesystem::path(), deviceScan, stats);
+		LMS_LOG(DBUPDATER, INFO) << "Processing root directory '" << rootDirectory.path << "' DONE";
+	}
+
+	deviceScan.walkDone = true;
+
+	// Let the workers of this device finish
+	deviceScan.jobs->close();
+}
+
+void
+Updater::processRootDirectory(const RootDirectory& rootDirectory, const boost::filesystem::path& resumeAfter, DeviceScan& deviceScan, Stats& stats)
+{
+	boost::system::error_code ec;
+
+	// Root may be a single file when updating changed paths
+	if (boost::filesystem::is_regular_file(rootDirectory.path, ec))
+	{
+		processFile(rootDirectory, rootDirectory.path, deviceScan, stats);
+		return;
+	}
+
+	processDirectory(rootDirectory, rootDirectory.path, resumeAfter, deviceScan, stats);
+}
+
+bool
+Updater::processDirectory(const RootDirectory& rootDirectory, const boost::filesystem::path& directory, const boost::filesystem::path& resumeAfter, DeviceScan& deviceScan, Stats& stats)
+{
+	// Taken before reading the entries, so that concurrent changes are seen by the next scan
+	struct stat directoryStat;
+	bool directoryStateValid = (::stat(directory.string().c_str(), &directoryStat) == 0);
+
+	// Sorted walk, so that the walk order does not change between runs
+	// Depth first on sorted entries means paths are walked in increasing order
+	std::vector<boost::filesystem::path> entries;
+	{
+		boost::system::error_code ec;
+		boost::filesystem::directory_iterator itPath(directory, ec);
+		boost::filesystem::directory_iterator itEnd;
+		while (!ec && itPath != itEnd)
+		{
+			entries.push_back(itPath->path());
+			itPath.increment(ec);
+		}
+
+		if (ec)
+		{
+			LMS_LOG(DBUPDATER, ERROR) << "Cannot read directory '" << directory << "': " << ec.message();
+			addUnwalkedPath(directory);
+			directoryStateValid = false;
+		}
+	}
+
+	std::sort(entries.begin(), entries.end());
+
+	// Adding, removing or renaming an entry changes the directory write time
+	// The number of entries catches the changes made within the same second as the last scan
+	// Files modified in place are not detected: they are handled by the periodic full scans
+	bool unchanged = false;
+	if (directoryStateValid)
+	{
+		const boost::posix_time::ptime lastWriteTime = boost::posix_time::from_time_t(directoryStat.st_mtime);
+
+		std::unique_lock<std::mutex> lock(_walkMutex);
+
+		if (_skipUnchangedDirectories)
+		{
+			const DirectoryIndex::Entry* previousState = _directoryIndex.find(directory.string());
+			unchanged = previousState
+				&& previousState->lastWriteTime == lastWriteTime
+				&& previousState->nbEntries == entries.size();
+		}
+
+		if (_updateDirectoryIndex)
+			_directoryIndex.update(directory.string(), lastWriteTime, entries.size());
+	}
+
+	bool complete = directoryStateValid;
+
+	for (const boost::filesystem::path& path : entries)
+	{
+		if (!_running)
+			return false;
+
+		boost::system::error_code ec;
+
+		// Do not follow the symlinks to directories
+		// In unchanged directories, the sub directories are the ones walked last time
+		bool isDirectory;
+		if (unchanged)
+		{
+			std::unique_lock<std::mutex> lock(_walkMutex);
+			isDirectory = (_directoryIndex.find(path.string()) != nullptr);
+		}
+		else
+			isDirectory = boost::filesystem::is_directory(boost::filesystem::symlink_status(path, ec));
+
+		if (isDirectory)
+		{
+			if (resumeAfter.empty())
+				complete &= processDirectory(rootDirectory, path, resumeAfter, deviceScan, stats);
+			else if (isPathInParentPath(resumeAfter, path))
+				complete &= processDirectory(rootDirectory, path, resumeAfter, deviceScan, stats);
+			else if (resumeAfter < path)
+				complete &= processDirectory(rootDirectory, path, boost::filesystem::path(), deviceScan, stats);
+		}
+		else if (resumeAfter.empty() || resumeAfter < path)
+		{
+			if (unchanged)
+				processUnchangedFile(rootDirectory, path, stats);
+			else
+				processFile(rootDirectory, path, deviceScan, stats);
+		}
+	}
+
+	// Walk this directory again next time, so that the failed sub directories are not skipped
+	if (!complete && _updateDirectoryIndex)
+	{
+		std::unique_lock<std::mutex> lock(_walkMutex);
+		_directoryIndex.invalidate(directory.string());
+	}
+
+	return complete;
+}
+
+void
+Updater::addUnwalkedPath(const boost::filesystem::path& path)
+{
+	std::unique_lock<std::mutex> lock(_walkMutex);
+	_unwalkedPaths.insert(path.string());
+}
+
+bool
+Updater::isUnwalkedPath(const boost::filesystem::path& path) const
+{
+	if (_unwalkedPaths.empty())
+		return false;
+
+	for (boost::filesystem::path curPath = path; !curPath.empty(); curPath = curPath.parent_path())
+	{
+		if (_unwalkedPaths.find(curPath.string()) != _unwalkedPaths.end())
+			return true;
+	}
+
+	return false;
+}
+
+void
+Updater::processUnchangedFile(const RootDirectory& rootDirectory, const boost::filesystem::path& path, Stats& stats)
+{
+	PathIndex* index = nullptr;
+	switch( rootDirectory.type )
+	{
+		case Database::MediaDirectory::Audio:
+			if (!isFileSupported(path, _audioFileExtensions))
+				return;
+			index = &_audioIndex;
+			break;
+
+		case Database::MediaDirectory::Video:
+			if (!isFileSupported(path, _videoFileExtensions))
+				return;
+			index = &_videoIndex;
+			break;
+	}
+
+	std::unique_lock<std::mutex> lock(_walkMutex);
+
+	// Files that could not be imported last time are not retried until the next full scan
+	PathIndex::Entry* entry = index->find(path.string());
+	if (!entry || entry->visited)
+		return;
+
+	entry->visited = true;
+
+	stats.nbWalked++;
+	stats.nbSkipped++;
+}
+
+void
+Updater::processFile(const RootDirectory& rootDirectory, const boost::filesystem::path& path, DeviceScan& deviceScan, Stats& stats)
+{
+	PathIndex* index = nullptr;
+	switch( rootDirectory.type )
+	{
+		case Database::MediaDirectory::Audio:
+			if (!isFileSupported(path, _audioFileExtensions))
+				return;
+			index = &_audioIndex;
+			break;
+
+		case Database::MediaDirectory::Video:
+			if (!isFileSupported(path, _videoFileExtensions))
+				return;
+			index = &_videoIndex;
+			break;
+	}
+
+	// A single stat call per file, the rest is done in memory
+	struct stat fileStat;
+	if (::stat(path.string().c_str(), &fileStat) != 0)
+	{
+		const int error = errno;
+		if (error != ENOENT)
+		{
+			LMS_LOG(DBUPDATER, ERROR) << "Cannot stat file '" << path << "': " << std::strerror(error);
+			addUnwalkedPath(path);
+		}
+		return;
+	}
+
+	if (!S_ISREG(fileStat.st_mode))
+		return;
+
+	stats.nbWalked++;
+
+	ScanJob job;
+	job.type = rootDirectory.type;
+	job.file = path;
+	job.lastWriteTime = boost::posix_time::from_time_t(fileStat.st_mtime);
+	job.fileSize = fileStat.st_size;
+
+	{
+		std::unique_lock<std::mutex> lock(_walkMutex);
+
+		PathIndex::Entry* entry = index->find(path.string());
+		if (entry)
+		{
+			// Already processed (reachable from several root directories)
+			if (entry->visited)
+				return;
+
+			entry->visited = true;
+		}
+
+		// Skip file if last write is the same
+		// Files written before sizes were stored have a null size
+		if (entry
+				&& entry->lastWriteTime == job.lastWriteTime
+				&& (entry->fileSize == 0 || entry->fileSize == job.fileSize))
+		{
+			stats.nbSkipped++;
+			return;
+		}
+
+		job.dbId = entry ? entry->id : -1;
+
+		if (!entry)
+			index->set(path.string(), PathIndex::Entry {job.dbId, job.lastWriteTime, job.fileSize, true});
+	}
+
+	job.checkpointTracker = &deviceScan.checkpointTracker;
+	job.checkpointId = deviceScan.checkpointTracker.add(rootDirectory.path, path);
+
+	deviceScan.jobs->push(std::move(job));
+}
+
+void
+Updater::parseFiles(ScanJobQueue& jobs, ScanResultQueue& results, Stats& stats)
+{
+	if (_scanThrottling)
+		setCurrentThreadLowPriority();
+
+	MetaData::Parser::pointer parser = _parserFactory();
+
+	ScanJob job;
+	while (jobs.pop(job))
+	{
+		// Keep on draining the queue so that the walker never gets stuck
+		if (!_running)
+			continue;
+
+		if (_scanThrottling)
+			waitForReadBudget(job);
+
+		try
+		{
+			ScanResult result;
+
+			if (!parser->parse(job.file, result.items))
+			{
+				if (_dryRunReport)
+					reportChange("not-imported", job.file, "cannot parse file");
+
+				stats.nbScanErrors++;
+				job.checkpointTracker->complete(job.checkpointId);
+				continue;
+			}
+
+			stats.nbScanned++;
+			stats.nbBytesScanned += job.fileSize;
+
+			// Dry runs neither use the checksums nor the covers
+			if (job.type == Database::MediaDirectory::Audio && !_dryRunReport)
+				result.checksumType = computeChecksum(job.file, result.checksum);
+
+			// Covers are stored by the workers, only their hash goes through the writer
+			if (!result.items.cover.empty())
+			{
+				if (!_dryRunReport)
+					result.coverHash = CoverArt::Store::instance().add(result.items.cover);
+
+				std::vector<unsigned char>().swap(result.items.cover);
+			}
+			else if (result.items.hasCover)
+				LMS_LOG(DBUPDATER, INFO) << "Embedded cover of '" << job.file << "' not stored (too large or unreadable)";
+
+			result.job = std::move(job);
+			results.push(std::move(result));
+		}
+		catch (std::exception& e)
+		{
+			LMS_LOG(DBUPDATER, ERROR) << "Cannot scan file '" << job.file << "': " << e.what();
+
+			if (_dryRunReport)
+				reportChange("not-imported", job.file, std::string("cannot scan file: ") + e.what());
+
+			stats.nbScanErrors++;
+			job.checkpointTracker->complete(job.checkpointId);
+		}
 	}
-	else
+}
+
+void
+Updater::waitForReadBudget(const ScanJob& job)
+{
+	// Back off while files are being streamed from the same disks
+	const bool backOff = (Av::Transcoder::getNbActiveTranscoders() > 0);
+
+	boost::posix_time::time_duration waitDuration = _scanThrottler.reserve(job.fileSize, backOff);
+
+	// Sleep by small steps so that a stop request is not delayed
+	static const boost::posix_time::time_duration maxSleepDuration = boost::posix_time::milliseconds(100);
+	while (_running && waitDuration > boost::posix_time::time_duration())
 	{
-		LMS_LOG(DBUPDATER, INFO) << "Updating '" << file << "'";
-		stats.nbModified++;
+		const boost::posix_time::time_duration sleepDuration = std::min(waitDuration, maxSleepDuration);
+
+		boost::this_thread::sleep(sleepDuration);
+		waitDuration -= sleepDuration;
 	}
+}
 
-	assert(track);
+void
+Updater::writeFiles(ScanResultQueue& results, Stats& stats)
+{
+	if (_scanThrottling)
+		setCurrentThreadLowPriority();
 
-	track.modify()->setChecksum(checksum);
-	track.modify()->setArtist(artist);
-	track.modify()->setRelease(release);
-	track.modify()->setLastWriteTime(lastWriteTime);
-	track.modify()->setName(title);
-	track.modify()->setDuration( boost::any_cast<boost::posix_time::time_duration>(items[MetaData::Type::Duration]) );
-	track.modify()->setAddedTime( boost::posix_time::second_clock::local_time() );
+	// Entities may have been removed since the last scan
+	_entityCache.clear();
 
+	// Group the writes to avoid paying a commit for each file
+	std::vector<ScanResult> batch;
+	boost::posix_time::ptime batchStartTime;
+
+	const std::chrono::milliseconds batchDuration(_scanBatchDuration.total_milliseconds());
+
+	while (true)
 	{
-		std::string trackGenreList;
-		// Product genre list
-		for (Genre::pointer genre : genres)
+		ScanResult result;
+		ScanResultQueue::PopStatus status = results.popFor(result, batchDuration);
+
+		if (status == ScanResultQueue::PopStatus::Closed)
+			break;
+
+		// Keep on draining the queue so that the workers never get stuck
+		if (!_running)
+			continue;
+
+		const boost::posix_time::ptime now = boost::posix_time::microsec_clock::local_time();
+
+		if (status == ScanResultQueue::PopStatus::Ok)
 		{
-			if (!trackGenreList.empty())
-				trackGenreList += ", ";
-			trackGenreList += genre->getName();
+			if (batch.empty())
+				batchStartTime = now;
+
+			batch.push_back(std::move(result));
 		}
 
-		track.modify()->setGenres( trackGenreList );
+		if (!batch.empty()
+				&& (status == ScanResultQueue::PopStatus::Timeout
+					|| batch.size() >= _scanBatchSize
+					|| now - batchStartTime >= _scanBatchDuration))
+		{
+			writeBatch(batch, stats);
+			batch.clear();
+		}
 	}
-	track.modify()->setGenres( genres );
 
-	if (items.find(MetaData::Type::TrackNumber) != items.end())
-		track.modify()->setTrackNumber( boost::any_cast<std::size_t>(items[MetaData::Type::TrackNumber]) );
+	if (!batch.empty() && _running)
+		writeBatch(batch, stats);
 
-	if (items.find(MetaData::Type::TotalTrack) != items.end())
-		track.modify()->setTotalTrackNumber( boost::any_cast<std::size_t>(items[MetaData::Type::TotalTrack]) );
+	_entityCache.clear();
+}
 
-	if (items.find(MetaData::Type::DiscNumber) != items.end())
-		track.modify()->setDiscNumber( boost::any_cast<std::size_t>(items[MetaData::Type::DiscNumber]) );
+void
+Updater::writeBatch(std::vector<ScanResult>& batch, Stats& stats)
+{
+	LMS_LOG(DBUPDATER, DEBUG) << "Writing batch of " << batch.size() << " file(s)";
 
-	if (items.find(MetaData::Type::TotalDisc) != items.end())
-		track.modify()->setTotalDiscNumber( boost::any_cast<std::size_t>(items[MetaData::Type::TotalDisc]) );
+	// Failed files are not retried before the next scan either
+	for (const ScanResult& result : batch)
+		result.job.checkpointTracker->complete(result.job.checkpointId);
 
-	if (items.find(MetaData::Type::Date) != items.end())
-		track.modify()->setDate( boost::any_cast<boost::posix_time::ptime>(items[MetaData::Type::Date]) );
+	if (_dryRunReport)
+	{
+		for (const ScanResult& result : batch)
+			reportFile(result, stats);
+		return;
+	}
 
-	if (items.find(MetaData::Type::OriginalDate) != items.end())
+	try
 	{
-		track.modify()->setOriginalDate( boost::any_cast<boost::posix_time::ptime>(items[MetaData::Type::OriginalDate]) );
+		Stats batchStats;
 
-		// If a file has an OriginalDate but no date, set the date to ease filtering
-		if (items.find(MetaData::Type::Date) == items.end())
-			track.modify()->setDate( boost::any_cast<boost::posix_time::ptime>(items[MetaData::Type::OriginalDate]) );
-	}
+		Wt::Dbo::Transaction transaction(_db.getSession());
 
-	if (items.find(MetaData::Type::MusicBrainzTrackID) != items.end())
+		for (ScanResult& result : batch)
+			writeFile(result, batchStats);
+
+		if (_saveCheckpoints)
+			saveCheckpoint(stats, batchStats);
+
+		transaction.commit();
+
+		stats.add(batchStats);
+		return;
+	}
+	catch (std::exception& e)
 	{
-		track.modify()->setMBID( boost::any_cast<std::string>(items[MetaData::Type::MusicBrainzTrackID]) );
+		LMS_LOG(DBUPDATER, ERROR) << "Cannot write batch of " << batch.size() << " file(s): " << e.what() << ", retrying file by file";
 	}
 
-	if (items.find(MetaData::Type::HasCover) != items.end())
+	// Entities created by the batch have been rolled back too
+	_entityCache.clear();
+
+	// The whole batch has been rolled back: isolate the faulty file(s)
+	for (ScanResult& result : batch)
 	{
-		bool hasCover = boost::any_cast<bool>(items[MetaData::Type::HasCover]);
+		try
+		{
+			Stats fileStats;
+
+			Wt::Dbo::Transaction transaction(_db.getSession());
+
+			writeFile(result, fileStats);
 
-		track.modify()->setCoverType( hasCover ? Track::CoverType::Embedded : Track::CoverType::None );
+			transaction.commit();
+
+			stats.add(fileStats);
+		}
+		catch (std::exception& e)
+		{
+			LMS_LOG(DBUPDATER, ERROR) << "Cannot write file '" << result.job.file << "' into database: " << e.what();
+			_entityCache.clear();
+		}
 	}
 
-	transaction.commit();
-}
+	if (_saveCheckpoints)
+	{
+		try
+		{
+			Wt::Dbo::Transaction transaction(_db.getSession());
 
+			saveCheckpoint(stats, Stats());
+		}
+		catch (std::exception& e)
+		{
+			LMS_LOG(DBUPDATER, ERROR) << "Cannot save scan checkpoint: " << e.what();
+		}
+	}
+}
 
-	void
-Updater::processRootDirectory(RootDirectory rootDirectory, Stats& stats)
+void
+Updater::saveCheckpoint(const Stats& stats, const Stats& batchStats)
 {
-	boost::system::error_code ec;
+	boost::filesystem::path rootDirectory;
+	boost::filesystem::path file;
 
-	boost::filesystem::recursive_directory_iterator itPath(rootDirectory.path, ec);
+	if (!getCheckpoint(rootDirectory, file))
+		return;
 
-	boost::filesystem::recursive_directory_iterator itEnd;
-	while (!ec && itPath != itEnd)
-	{
-		boost::filesystem::path path = *itPath;
-		itPath.increment(ec);
+	Stats totalStats;
+	totalStats.add(stats);
+	totalStats.add(batchStats);
 
-		if (!_running)
-			return;
+	ScanCheckpoint::pointer checkpoint = ScanCheckpoint::get(_db.getSession());
+
+	checkpoint.modify()->setInProgress(true);
+	checkpoint.modify()->setRootDirectory(rootDirectory);
+	checkpoint.modify()->setLastPath(file);
+	checkpoint.modify()->setStats(totalStats.serialize());
+}
+
+bool
+Updater::getCheckpoint(boost::filesystem::path& rootDirectory, boost::filesystem::path& file) const
+{
+	// Scans are resumed in the root directories order: the checkpoint is located
+	// in the first root directory that has not been completely processed yet
+	bool found = false;
+	std::size_t checkpointIndex = 0;
 
-		if (boost::filesystem::is_regular(path))
+	for (const std::unique_ptr<DeviceScan>& deviceScan : _deviceScans)
+	{
+		const bool walkDone = deviceScan->walkDone;
+		if (walkDone && deviceScan->checkpointTracker.isDrained())
+			continue;
+
+		// The root directories walked before the last completed file are done
+		boost::filesystem::path lastRootDirectory;
+		boost::filesystem::path lastFile;
+		const bool hasCheckpoint = deviceScan->checkpointTracker.getCheckpoint(lastRootDirectory, lastFile);
+
+		std::size_t pos = 0;
+		boost::filesystem::path resumeAfter;
+		if (hasCheckpoint)
 		{
-			switch( rootDirectory.type )
+			auto itRootDirectory = std::find_if(deviceScan->rootDirectories.begin(), deviceScan->rootDirectories.end(),
+					[&](const RootDirectory& root) { return root.path == lastRootDirectory; });
+
+			if (itRootDirectory != deviceScan->rootDirectories.end())
 			{
-				case Database::MediaDirectory::Audio:
-					if (isFileSupported(path, _audioFileExtensions))
-						processAudioFile(path, stats );
+				pos = std::distance(deviceScan->rootDirectories.begin(), itRootDirectory);
+				resumeAfter = lastFile;
+			}
+		}
 
-					break;
+		const std::size_t index = deviceScan->rootDirectoryIndexes[pos];
+		if (!found || index < checkpointIndex)
+		{
+			found = true;
+			checkpointIndex = index;
+			rootDirectory = deviceScan->rootDirectories[pos].path;
+			file = resumeAfter;
+		}
+	}
 
-				case Database::MediaDirectory::Video:
-					if (isFileSupported(path, _videoFileExtensions))
-						processVideoFile(path, stats);
-					break;
-			}
+	// Nothing completed in the first root directory yet
+	if (found && checkpointIndex == 0 && file.empty())
+		return false;
+
+	return found;
+}
+
+void
+Updater::writeFile(ScanResult& result, Stats& stats)
+{
+	switch (result.job.type)
+	{
+		case Database::MediaDirectory::Audio:
+			writeAudioFile(result, stats);
+			break;
+
+		case Database::MediaDirectory::Video:
+			writeVideoFile(result, stats);
+			break;
+	}
+}
+
+void
+Updater::reportChange(const char* change, const boost::filesystem::path& path, const std::string& reason)
+{
+	std::unique_lock<std::mutex> lock(_dryRunReportMutex);
+
+	*_dryRunReport << change << "\t" << path.string() << "\t" << reason << "\n";
+}
+
+void
+Updater::reportFile(const ScanResult& result, Stats& stats)
+{
+	// Same decisions as writeFile
+	std::string reason;
+	const bool importable = (result.job.type == Database::MediaDirectory::Audio)
+		? checkAudioFile(result.items, reason)
+		: checkVideoFile(result.items, reason);
+
+	if (!importable)
+	{
+		reportChange("not-imported", result.job.file, reason);
+		stats.nbNotImported++;
+
+		if (result.job.dbId != -1)
+		{
+			reportChange("removed", result.job.file, "no longer imported: " + reason);
+			stats.nbRemoved++;
 		}
+		return;
+	}
+
+	if (result.job.dbId == -1)
+	{
+		reportChange("added", result.job.file, "new file");
+		stats.nbAdded++;
+	}
+	else
+	{
+		reportChange("modified", result.job.file, "file changed since last scan");
+		stats.nbModified++;
 	}
 }
 
+void
+Updater::reportSummary(const Stats& stats)
+{
+	const ScanProgress progress = getProgress();
+
+	const boost::posix_time::time_duration walkDuration = progress.phaseDurations[static_cast<std::size_t>(ScanProgress::Phase::Walk)];
+	const boost::posix_time::time_duration removeDuration = progress.phaseDurations[static_cast<std::size_t>(ScanProgress::Phase::RemoveMissing)];
+
+	std::unique_lock<std::mutex> lock(_dryRunReportMutex);
+
+	std::ostream& report = *_dryRunReport;
+
+	report << "# Walked = " << stats.nbWalked << ", Skipped = " << stats.nbSkipped << ", Scanned = " << stats.nbScanned
+		<< " (" << stats.nbBytesScanned / (1024 * 1024) << " MiB), Scan errors = " << stats.nbScanErrors << "\n";
+	report << "# Added = " << stats.nbAdded << ", Modified = " << stats.nbModified << ", Removed = " << stats.nbRemoved
+		<< ", Not imported = " << stats.nbNotImported << "\n";
+	report << "# Walk and parse = " << walkDuration.total_seconds() << " s (" << static_cast<std::size_t>(progress.filesPerSecond) << " files/s, "
+		<< static_cast<std::size_t>(progress.bytesPerSecond / (1024 * 1024)) << " MiB/s), Removal check = " << removeDuration.total_seconds() << " s\n";
+
+	// The writer runs along with the parse workers, so the walk and parse time is a lower bound of a real scan
+	// Orphans and duplicates checks, checksums and cover storage are not included
+	report << "# Projected scan duration >= " << (walkDuration + removeDuration).total_seconds() << " s, using "
+		<< _nbScanWorkers << " worker(s)" << (_scanThrottling ? ", throttled" : "") << "\n";
+
+	report.flush();
+}
+
 bool
 Updater::checkFile(const boost::filesystem::path& p, const std::vector<boost::filesystem::path>& rootDirs, const std::vector<boost::filesystem::path>& extensions)
 {
@@ -671,168 +1936,174 @@ Updater::checkFile(const boost::filesystem::path& p, const std::vector<boost::fi
 }
 
 void
-Updater::checkAudioFiles( Stats& stats )
+Updater::removeOrphans()
 {
-	LMS_LOG(DBUPDATER, INFO) << "Checking audio files...";
+	LMS_LOG(DBUPDATER, DEBUG) << "Removing orphans...";
 
-	std::vector<boost::filesystem::path> trackPaths = Track::getAllPaths(_db.getSession());;
-	std::vector<boost::filesystem::path> rootDirs = getRootDirectoriesByType(_db.getSession(), Database::MediaDirectory::Audio);
+	const boost::posix_time::ptime startTime = boost::posix_time::microsec_clock::local_time();
 
-	LMS_LOG(DBUPDATER, DEBUG) << "Checking tracks...";
-	for (auto& trackPath : trackPaths)
+	std::size_t nbTrackGenres, nbGenres, nbArtists, nbReleases;
+	std::unordered_set<std::string> coverHashes;
 	{
-		if (!_running)
-			return;
+		Wt::Dbo::Transaction transaction(_db.getSession());
 
-		if (!checkFile(trackPath, rootDirs, _audioFileExtensions))
-		{
-			Wt::Dbo::Transaction transaction(_db.getSession());
+		nbTrackGenres = Genre::removeDanglingTrackLinks(_db.getSession());
+		nbGenres = Genre::removeOrphans(_db.getSession());
+		nbArtists = Artist::removeOrphans(_db.getSession());
+		nbReleases = Release::removeOrphans(_db.getSession());
 
-			Track::pointer track = Track::getByPath(_db.getSession(), trackPath);
-			if (track)
-			{
-				track.remove();
-				stats.nbRemoved++;
-			}
-		}
+		for (const std::string& hash : Track::getAllCoverHashes(_db.getSession()))
+			coverHashes.insert(hash);
 	}
 
-	LMS_LOG(DBUPDATER, DEBUG) << "Checking Genres...";
-	{
-		Wt::Dbo::Transaction transaction(_db.getSession());
+	// Covers no longer used by any track, release covers are taken from their tracks
+	const std::size_t nbCovers = CoverArt::Store::instance().removeUnused(coverHashes);
 
-		// Now process orphan Genre (no track)
-		auto genres = Genre::getAll(_db.getSession());
-		for (auto genre : genres)
-		{
-			if (genre->getTracks().size() == 0)
-			{
-				LMS_LOG(DBUPDATER, DEBUG) << "Removing orphan genre '" << genre->getName() << "'";
-				genre.remove();
-			}
-		}
-	}
+	LMS_LOG(DBUPDATER, INFO) << "Orphans removed in " << (boost::posix_time::microsec_clock::local_time() - startTime).total_milliseconds() << " ms: genres = " << nbGenres << ", artists = " << nbArtists << ", releases = " << nbReleases << ", dangling track genres = " << nbTrackGenres << ", covers = " << nbCovers;
+}
+
+void
+Updater::checkDuplicatedAudioFiles(bool fullCheck)
+{
+	LMS_LOG(DBUPDATER, INFO) << "Checking duplicated audio files" << (fullCheck ? "" : " of the changed tracks");
+
+	const boost::posix_time::ptime startTime = boost::posix_time::microsec_clock::local_time();
+
+	Wt::Dbo::Transaction transaction(_db.getSession());
 
-	LMS_LOG(DBUPDATER, DEBUG) << "Checking artists...";
+	if (fullCheck)
 	{
-		Wt::Dbo::Transaction transaction(_db.getSession());
+		TrackDuplicate::removeAll(_db.getSession());
 
-		auto artists = Artist::getAllOrphans(_db.getSession());
-		for (auto artist : artists)
-		{
-			LMS_LOG(DBUPDATER, DEBUG) << "Removing orphan artist '" << artist->getName() << "'";
-			artist.remove();
-		}
+		_changedDuplicateKeys.clear();
+		for (const std::string& mbid : Track::getDuplicatedMBIDs(_db.getSession()))
+			_changedDuplicateKeys.mbids.insert(mbid);
+		for (const Track::ChecksumQueryResult& checksum : Track::getDuplicatedChecksums(_db.getSession()))
+			_changedDuplicateKeys.checksums.insert(std::make_pair(checksum.get<0>(), checksum.get<1>()));
 	}
 
-	LMS_LOG(DBUPDATER, DEBUG) << "Checking releases...";
+	// Each key is checked from scratch, using the indexes
+	auto checkKey = [&](TrackDuplicate::Type type, const std::string& key, const std::vector<Track::pointer>& tracks)
 	{
-		Wt::Dbo::Transaction transaction(_db.getSession());
+		if (!fullCheck)
+			TrackDuplicate::removeByKey(_db.getSession(), type, key);
 
-		auto releases = Release::getAllOrphans(_db.getSession());
-		for (auto release : releases)
+		if (tracks.size() < 2)
+			return;
+
+		for (Track::pointer track : tracks)
 		{
-			LMS_LOG(DBUPDATER, DEBUG) << "Removing orphan release '" << release->getName() << "'";
-			release.remove();
+			LMS_LOG(DBUPDATER, DEBUG) << "Found duplicated " << (type == TrackDuplicate::Type::MBID ? "MBID" : "checksum") << " [" << key << "], file: " << track->getPath();
+			TrackDuplicate::create(_db.getSession(), type, key, track);
 		}
-	}
+	};
+
+	for (const std::string& mbid : _changedDuplicateKeys.mbids)
+		checkKey(TrackDuplicate::Type::MBID, mbid, Track::getAllByMBID(_db.getSession(), mbid));
 
-	LMS_LOG(DBUPDATER, INFO) << "Check audio files done!";
+	for (const auto& checksum : _changedDuplicateKeys.checksums)
+		checkKey(TrackDuplicate::Type::Checksum,
+				TrackDuplicate::getChecksumKey(checksum.first, checksum.second),
+				Track::getAllByChecksum(_db.getSession(), checksum.first, checksum.second));
+
+	const std::size_t nbCheckedKeys = _changedDuplicateKeys.mbids.size() + _changedDuplicateKeys.checksums.size();
+	_changedDuplicateKeys.clear();
+
+	LMS_LOG(DBUPDATER, INFO) << "Checking duplicated audio files done in " << (boost::posix_time::microsec_clock::local_time() - startTime).total_milliseconds() << " ms: checked keys = " << nbCheckedKeys << ", duplicated tracks = " << TrackDuplicate::getCount(_db.getSession());
+}
+
+bool
+Updater::setDuplicateCheckPending(bool pending)
+{
+	Wt::Dbo::Transaction transaction(_db.getSession());
+
+	ScanCheckpoint::pointer checkpoint = ScanCheckpoint::get(_db.getSession());
+
+	const bool wasPending = checkpoint->getDuplicateCheckPending();
+	if (wasPending != pending)
+		checkpoint.modify()->setDuplicateCheckPending(pending);
+
+	return wasPending;
 }
 
 void
-Updater::checkDuplicatedAudioFiles(Stats& stats)
+Updater::updateCounters(bool fullUpdate)
 {
-	LMS_LOG(DBUPDATER, INFO) << "Checking duplicated audio files";
+	LMS_LOG(DBUPDATER, INFO) << "Updating counters" << (fullUpdate ? "" : " of the changed entities");
+
+	const boost::posix_time::ptime startTime = boost::posix_time::microsec_clock::local_time();
 
 	Wt::Dbo::Transaction transaction(_db.getSession());
 
-	std::vector<Track::pointer> tracks = Database::Track::getMBIDDuplicates(_db.getSession());
-	for (Track::pointer track : tracks)
+	std::string nbEntities = "all";
+	if (fullUpdate || _changedCounterEntities.all)
 	{
-		LMS_LOG(DBUPDATER, INFO) << "Found duplicated MBID [" << track->getMBID() << "], file: " << track->getPath() << " - " << track->getArtist()->getName() << " - " << track->getName();
+		Artist::updateAllCounters(_db.getSession());
+		Release::updateAllCounters(_db.getSession());
+		Genre::updateAllCounters(_db.getSession());
 	}
-
-	tracks = Database::Track::getChecksumDuplicates(_db.getSession());
-	for (Track::pointer track : tracks)
+	else
 	{
-		LMS_LOG(DBUPDATER, INFO) << "Found duplicated checksum [" << bufferToString(track->getChecksum()) << "], file: " << track->getPath() << " - " << track->getArtist()->getName() << " - " << track->getName();
+		// The entities may have been removed meanwhile, as orphans
+		std::set<Artist::id_type> artistIds;
+		for (Artist::pointer artist : _changedCounterEntities.artists)
+			artistIds.insert(artist.id());
+
+		std::set<Release::id_type> releaseIds;
+		for (Release::pointer release : _changedCounterEntities.releases)
+			releaseIds.insert(release.id());
+
+		std::set<Genre::id_type> genreIds;
+		for (Genre::pointer genre : _changedCounterEntities.genres)
+			genreIds.insert(genre.id());
+
+		Artist::updateCounters(_db.getSession(), artistIds);
+		Release::updateCounters(_db.getSession(), releaseIds);
+		Genre::updateCounters(_db.getSession(), genreIds);
+
+		nbEntities = std::to_string(artistIds.size() + releaseIds.size() + genreIds.size());
 	}
 
+	_changedCounterEntities.clear();
 
-	LMS_LOG(DBUPDATER, INFO) << "Checking duplicated audio files done!";
+	LMS_LOG(DBUPDATER, INFO) << "Counters updated in " << (boost::posix_time::microsec_clock::local_time() - startTime).total_milliseconds() << " ms: entities = " << nbEntities;
 }
 
-void
-Updater::checkVideoFiles( Stats& stats )
+bool
+Updater::setCountersUpdatePending(bool pending)
 {
-	std::vector<boost::filesystem::path> rootDirs = getRootDirectoriesByType(_db.getSession(), Database::MediaDirectory::Video);
-	std::vector<boost::filesystem::path> videoPaths = Video::getAllPaths(_db.getSession());
-
-	LMS_LOG(DBUPDATER, DEBUG) << "Checking videos...";
-	for (auto& videoPath : videoPaths)
-	{
-		if (!_running)
-			return;
+	Wt::Dbo::Transaction transaction(_db.getSession());
 
-		if (!checkFile(videoPath, rootDirs, _videoFileExtensions))
-		{
-			Wt::Dbo::Transaction transaction(_db.getSession());
+	ScanCheckpoint::pointer checkpoint = ScanCheckpoint::get(_db.getSession());
 
-			Video::pointer video = Video::getByPath(_db.getSession(), videoPath);
-			if (video)
-			{
-				video.remove();
-				stats.nbRemoved++;
-			}
-		}
-	}
+	const bool wasPending = checkpoint->getCountersUpdatePending();
+	if (wasPending != pending)
+		checkpoint.modify()->setCountersUpdatePending(pending);
 
-	LMS_LOG(DBUPDATER, DEBUG) << "Check video files done!";
+	return wasPending;
 }
 
 void
-Updater::processVideoFile( const boost::filesystem::path& file, Stats& stats)
+Updater::writeVideoFile( ScanResult& result, Stats& stats)
 {
-	// Check last update time
-	boost::posix_time::ptime lastWriteTime (boost::posix_time::from_time_t( boost::filesystem::last_write_time( file ) ) );
-
-	Wt::Dbo::Transaction transaction(_db.getSession());
-
-	// Skip file if last write is the same
-	Wt::Dbo::ptr<Video> video = Video::getByPath(_db.getSession(), file);
-	if (video && video->getLastWriteTime() == lastWriteTime)
-		return;
+	const boost::filesystem::path& file = result.job.file;
+	MetaData::Items& items = result.items;
 
-	MetaData::Items items;
-	if (!_metadataParser.parse(file, items))
-		return;
+	Wt::Dbo::ptr<Video> video;
+	if (result.job.dbId != -1)
+		video = Video::getById(_db.getSession(), result.job.dbId);
 
-	// We estimate this is a video if:
-	// - we found a least one video stream
-	// - the duration is not null
-	if (items.find(MetaData::Type::VideoStreams) == items.end()
-			|| boost::any_cast<std::vector<MetaData::VideoStream> >(items[MetaData::Type::VideoStreams]).empty())
+	std::string reason;
+	if (!checkVideoFile(items, reason))
 	{
-		LMS_LOG(DBUPDATER, ERROR) << "Skipped '" << file << "' (no video stream found)";
+		LMS_LOG(DBUPDATER, ERROR) << "Skipped '" << file << "' (" << reason << ")";
 
 		// If the video exists here, delete it!
 		if (video) {
 			video.remove();
 			stats.nbRemoved++;
 		}
-		return;
-	}
-	if (items.find(MetaData::Type::Duration) == items.end()
-			|| boost::any_cast<boost::posix_time::time_duration>(items[MetaData::Type::Duration]).total_seconds() == 0)
-	{
-		LMS_LOG(DBUPDATER, ERROR) << "Skipped '" << file << "' (no duration or duration 0)";
-
-		// If Track exists here, delete it!
-		if (video) {
-			video.remove();
-			stats.nbRemoved++;
-		}
+		stats.nbNotImported++;
 		return;
 	}
 
@@ -854,10 +2125,29 @@ Updater::processVideoFile( const boost::filesystem::path& file, Stats& stats)
 	assert(video);
 
 	video.modify()->setName( file.filename().string() );
-	video.modify()->setDuration( boost::any_cast<boost::posix_time::time_duration>(items[MetaData::Type::Duration]) );
-	video.modify()->setLastWriteTime(lastWriteTime);
+	video.modify()->setDuration(items.duration);
+	video.modify()->setLastWriteTime(result.job.lastWriteTime);
+	video.modify()->setFileSize(result.job.fileSize);
+}
+
+bool
+Updater::checkVideoFile(const MetaData::Items& items, std::string& reason)
+{
+	// We estimate this is a video if:
+	// - we found a least one video stream
+	// - the duration is not null
+	if (items.videoStreams.empty())
+	{
+		reason = "no video stream found";
+		return false;
+	}
+	if (items.duration.total_seconds() == 0)
+	{
+		reason = "no duration or duration 0";
+		return false;
+	}
 
-	transaction.commit();
+	return true;
 }
 
 } // namespace DatabaseUpdater
@@ -20,19 +20,43 @@
 #ifndef DB_UPDATER_HPP
 #define DB_UPDATER_HPP
 
+#include <sys/types.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <ostream>
+#include <sstream>
+
 #include <boost/asio/deadline_timer.hpp>
+#include <boost/thread.hpp>
 #include <Wt/WIOService>
 
 #include "metadata/MetaData.hpp"
 
 #include "database/DatabaseHandler.hpp"
 
+#include "CheckpointTracker.hpp"
+#include "Checksum.hpp"
+#include "DirectoryIndex.hpp"
+#include "EntityCache.hpp"
+#include "PathIndex.hpp"
+#include "ScanProgress.hpp"
+#include "ScanQueue.hpp"
+#include "ScanThrottler.hpp"
+
 namespace DatabaseUpdater {
 
 class Updater
 {
 	public:
-		Updater(Wt::Dbo::SqlConnectionPool& connectionPool, MetaData::Parser& parser);
+		// Each parse worker creates its own parser, so that parsers need not be thread safe
+		typedef std::function<MetaData::Parser::pointer()> ParserFactory;
+
+		Updater(Wt::Dbo::SqlConnectionPool& connectionPool, ParserFactory parserFactory);
 
 		void setAudioExtensions(const std::vector<std::string>&	extensions);
 		void setVideoExtensions(const std::vector<std::string>&	extensions);
@@ -40,19 +64,83 @@ class Updater
 		void start();
 		void stop();
 
+		// Incremental update of some files or directories that have been changed, added or removed
+		// Processed asynchronously, after any running scan
+		void updatePaths(const std::vector<boost::filesystem::path>& paths);
+
+		// Full scan in the calling thread, for tools and benchmarks
+		// The updater must not be started
+		void scanNow(bool checkAllFiles);
+
+		// Dry run of a full scan in the calling thread: files are walked, parsed and compared with
+		// the database by the same workers, but nothing is written
+		// Each change is streamed to the report as a "<change>\t<path>\t<reason>" line, followed
+		// by a summary with the measured timings
+		// The updater must not be started
+		void dryRun(bool checkAllFiles, std::ostream& report);
+
+		// Progress of the current full scan, can be called from any thread
+		ScanProgress getProgress() const;
+
+		// Listeners are called every second during full scans, from an internal thread
+		typedef std::function<void(const ScanProgress&)> ProgressListener;
+		std::size_t addProgressListener(ProgressListener listener);
+		void removeProgressListener(std::size_t id);
+
 	private:
 
+		// Updated concurrently by the scan stages
 		struct Stats
 		{
-			std::size_t	nbSkipped = 0;		// no change since last scan
-			std::size_t	nbScanned = 0;
-			std::size_t	nbScanErrors = 0;	// cannot scan file
-			std::size_t	nbNotImported = 0;	// Not imported (criteria not filled)
-			std::size_t	nbAdded = 0;
-			std::size_t	nbRemoved = 0;
-			std::size_t	nbModified = 0;
+			std::atomic<std::size_t>	nbWalked {0};		// skipped or sent to parse
+			std::atomic<std::size_t>	nbSkipped {0};		// no change since last scan
+			std::atomic<std::size_t>	nbScanned {0};
+			std::atomic<std::size_t>	nbScanErrors {0};	// cannot scan file
+			std::atomic<std::size_t>	nbNotImported {0};	// Not imported (criteria not filled)
+			std::atomic<std::size_t>	nbAdded {0};
+			std::atomic<std::size_t>	nbRemoved {0};
+			std::atomic<std::size_t>	nbModified {0};
+			std::atomic<unsigned long long>	nbBytesScanned {0};
 
 			std::size_t nbChanges() const { return nbAdded + nbRemoved + nbModified;}
+
+			void add(const Stats& other)
+			{
+				nbWalked += other.nbWalked;
+				nbSkipped += other.nbSkipped;
+				nbScanned += other.nbScanned;
+				nbScanErrors += other.nbScanErrors;
+				nbNotImported += other.nbNotImported;
+				nbAdded += other.nbAdded;
+				nbRemoved += other.nbRemoved;
+				nbModified += other.nbModified;
+				nbBytesScanned += other.nbBytesScanned;
+			}
+
+			// Used to save the stats along with the scan checkpoints
+			std::string serialize() const
+			{
+				std::ostringstream oss;
+				oss << nbSkipped << " " << nbScanned << " " << nbScanErrors << " " << nbNotImported << " " << nbAdded << " " << nbRemoved << " " << nbModified;
+				return oss.str();
+			}
+
+			void deserialize(const std::string& str)
+			{
+				std::size_t values[7] = {};
+
+				std::istringstream iss(str);
+				for (std::size_t& value : values)
+					iss >> value;
+
+				nbSkipped = values[0];
+				nbScanned = values[1];
+				nbScanErrors = values[2];
+				nbNotImported = values[3];
+				nbAdded = values[4];
+				nbRemoved = values[5];
+				nbModified = values[6];
+			}
 		};
 
 		struct RootDirectory
@@ -63,6 +151,96 @@ class Updater
 			RootDirectory(Database::MediaDirectory::Type t, boost::filesystem::path p) : type(t), path(p) {}
 		};
 
+		// File selected by the walker, to be parsed by a worker
+		struct ScanJob
+		{
+			Database::MediaDirectory::Type	type;
+			boost::filesystem::path		file;
+			boost::posix_time::ptime	lastWriteTime;
+			long long			fileSize;
+			long long			dbId;	// -1 if the file is not in the database yet
+			CheckpointTracker*		checkpointTracker;
+			std::size_t			checkpointId;
+		};
+
+		// Parsed file, to be written by the database writer
+		struct ScanResult
+		{
+			ScanJob				job;
+			MetaData::Items			items;
+			std::vector<unsigned char>	checksum;
+			ChecksumType			checksumType = ChecksumType::Crc32;
+			std::string			coverHash;	// in the cover store
+		};
+
+		typedef ScanQueue<ScanJob>	ScanJobQueue;
+		typedef ScanQueue<ScanResult>	ScanResultQueue;
+
+		// MBIDs and checksums of the tracks changed since the last duplicate check
+		struct DuplicateKeys
+		{
+			std::set<std::string>						mbids;
+			std::set<std::pair<int, std::vector<unsigned char>>>	checksums;	// checksum type, checksum
+
+			void add(const Database::Track& track)
+			{
+				if (!track.getMBID().empty())
+					mbids.insert(track.getMBID());
+				if (!track.getChecksum().empty())
+					checksums.insert(std::make_pair(track.getChecksumType(), track.getChecksum()));
+			}
+
+			bool empty() const { return mbids.empty() && checksums.empty(); }
+			void clear() { mbids.clear(); checksums.clear(); }
+		};
+
+		// Artists, releases and genres whose tracks changed since the last counters update
+		// Pointers rather than ids, since the new entities get their ids once flushed
+		// A loaded entity has a single object in the session: its pointers are equal
+		struct CounterEntities
+		{
+			static const std::size_t maxSize = 10000;	// beyond, all the counters are updated
+
+			std::set<Database::Artist::pointer>	artists;
+			std::set<Database::Release::pointer>	releases;
+			std::set<Database::Genre::pointer>	genres;
+			bool					all = false;
+
+			void add(Database::Artist::pointer artist, Database::Release::pointer release, const std::vector<Database::Genre::pointer>& trackGenres)
+			{
+				if (all)
+					return;
+
+				artists.insert(artist);
+				releases.insert(release);
+				genres.insert(trackGenres.begin(), trackGenres.end());
+
+				if (artists.size() + releases.size() + genres.size() > maxSize)
+				{
+					clear();
+					all = true;
+				}
+			}
+
+			void add(const Database::Track& track) { add(track.getArtist(), track.getRelease(), track.getGenres()); }
+
+			bool empty() const { return !all && artists.empty() && releases.empty() && genres.empty(); }
+			void clear() { artists.clear(); releases.clear(); genres.clear(); all = false; }
+		};
+
+		// Root directories located on the same device
+		// Each device has its own walker and parse workers, so that devices are read concurrently
+		// while the number of concurrent reads on a given device stays bounded
+		struct DeviceScan
+		{
+			dev_t					device;
+			std::vector<RootDirectory>		rootDirectories;	// scan order
+			std::vector<std::size_t>		rootDirectoryIndexes;	// in the whole scan order
+			std::unique_ptr<ScanJobQueue>		jobs;
+			CheckpointTracker			checkpointTracker;
+			std::atomic<bool>			walkDone {false};
+		};
+
 		// Job handling
 		void processNextJob();
 		void scheduleScan(boost::posix_time::time_duration duration);
@@ -70,41 +248,130 @@ class Updater
 
 		// Update database (scheduled callback)
 		void process(boost::system::error_code ec);
+		void scan(bool checkAllFiles);
 
 		// Check if a file exists and is still in a root directory
+		// Only needed for the files located in a part of the tree that has not been entirely walked
 		static bool checkFile(const boost::filesystem::path& p,
 				const std::vector<boost::filesystem::path>& rootDirectories,
 				const std::vector<boost::filesystem::path>& extensions);
 
 
-		void processRootDirectory(  RootDirectory rootDirectory, Stats& stats);
+		std::vector<RootDirectory> getRootDirectories();
+
+		void processPaths(std::vector<boost::filesystem::path> paths);
+
+		// Snapshot of the files already in database
+		void loadPathIndexes();
+		void loadDirectoryIndex();
+		void saveDirectoryIndex(bool keepUnvisited);
+		void removeUnvisitedFiles(const std::vector<RootDirectory>& rootDirectories, Stats& stats);
+
+		// Scan pipeline: one walker (the calling thread), parse workers and one database writer
+		// The walk can be resumed after a given file of a given root directory (walk order)
+		void scanRootDirectories(const std::vector<RootDirectory>& rootDirectories, Stats& stats,
+				const boost::filesystem::path& resumeRootDirectory = boost::filesystem::path(),
+				const boost::filesystem::path& resumeAfter = boost::filesystem::path());
+		void walkDevice(DeviceScan& deviceScan, std::size_t resumeIndex, const boost::filesystem::path& resumeAfter, Stats& stats);
+		void processRootDirectory( const RootDirectory& rootDirectory, const boost::filesystem::path& resumeAfter, DeviceScan& deviceScan, Stats& stats);
+		// Returns false if the directory could not be entirely walked
+		bool processDirectory( const RootDirectory& rootDirectory, const boost::filesystem::path& directory, const boost::filesystem::path& resumeAfter, DeviceScan& deviceScan, Stats& stats);
+		void processFile( const RootDirectory& rootDirectory, const boost::filesystem::path& path, DeviceScan& deviceScan, Stats& stats);
+		void processUnchangedFile( const RootDirectory& rootDirectory, const boost::filesystem::path& path, Stats& stats);
+		void addUnwalkedPath(const boost::filesystem::path& path);
+		bool isUnwalkedPath(const boost::filesystem::path& path) const;
+		void parseFiles(ScanJobQueue& jobs, ScanResultQueue& results, Stats& stats);
+		void waitForReadBudget(const ScanJob& job);
+		void writeFiles(ScanResultQueue& results, Stats& stats);
+		void writeBatch(std::vector<ScanResult>& batch, Stats& stats);
+		void writeFile(ScanResult& result, Stats& stats);
+		void saveCheckpoint(const Stats& stats, const Stats& batchStats);	// within a writer transaction
+		bool getCheckpoint(boost::filesystem::path& rootDirectory, boost::filesystem::path& file) const;
+
+		// Dry run
+		void reportChange(const char* change, const boost::filesystem::path& path, const std::string& reason);
+		void reportFile(const ScanResult& result, Stats& stats);	// instead of writeFile
+		void reportSummary(const Stats& stats);
+
+		// Progress reporting
+		void startProgress(const Stats& stats);
+		void setProgressPhase(ScanProgress::Phase phase);
+		void setProgressQueues(std::vector<const ScanJobQueue*> jobs, const ScanResultQueue* results);
+		void stopProgress();
+		void reportProgress();	// progress reporter thread
 
 		// Helpers
 		Database::Artist::pointer getArtist( const boost::filesystem::path& file, const std::string& name, const std::string& MBID);
 		Database::Release::pointer getRelease( const boost::filesystem::path& file, const std::string& name, const std::string& MBID);
-		std::vector<Database::Genre::pointer> getGenres( const std::list<std::string>& names);
-		void updateFileExtensions();
+		std::vector<Database::Genre::pointer> getGenres( const MetaData::Genres& names);
+		void updateSettings();
 
 		// Audio
-		void checkAudioFiles( Stats& stats );
-		void checkDuplicatedAudioFiles( Stats& stats );
-		void processAudioFile( const boost::filesystem::path& file, Stats& stats);
+		void removeOrphans();
+		void checkDuplicatedAudioFiles( bool fullCheck );	// otherwise only the changed tracks
+		bool setDuplicateCheckPending( bool pending );	// returns the previous value
+		void updateCounters( bool fullUpdate );	// otherwise only the entities of the changed tracks
+		bool setCountersUpdatePending( bool pending );	// returns the previous value
+		void writeAudioFile( ScanResult& result, Stats& stats);
+		static bool checkAudioFile(const MetaData::Items& items, std::string& reason);
 
 		// Video
-		void checkVideoFiles( Stats& stats );
-		void processVideoFile( const boost::filesystem::path& file, Stats& stats);
+		void writeVideoFile( ScanResult& result, Stats& stats);
+		static bool checkVideoFile(const MetaData::Items& items, std::string& reason);
 
-		bool			_running;
+		std::atomic<bool>	_running;
+		Wt::Dbo::SqlConnectionPool&	_connectionPool;
 		Wt::WIOService		_ioService;
 
 		boost::asio::deadline_timer _scheduleTimer;
 
+		// Single session for all the reads and writes, so that no object cache gets stale
+		// During the walk, only the writer stage uses it
 		Database::Handler	_db;
 
+		std::size_t		_nbScanWorkers;
+		std::size_t		_nbScanWorkersPerDevice;	// 0 means unlimited
+		std::size_t		_scanBatchSize;
+		boost::posix_time::time_duration	_scanBatchDuration;
+
+		bool			_scanThrottling;
+		ScanThrottler		_scanThrottler;
+
 		std::vector<boost::filesystem::path>	_audioFileExtensions;
 		std::vector<boost::filesystem::path>	_videoFileExtensions;
 
-		MetaData::Parser&	_metadataParser;
+		PathIndex		_audioIndex;
+		PathIndex		_videoIndex;
+
+		DirectoryIndex		_directoryIndex;
+		bool			_skipUnchangedDirectories;
+		bool			_updateDirectoryIndex;	// only for full scans
+		std::set<std::string>	_unwalkedPaths;	// walk errors and parts skipped by a resumed scan
+
+		EntityCache		_entityCache;	// writer only
+		DuplicateKeys		_changedDuplicateKeys;	// writer, then removals
+		CounterEntities		_changedCounterEntities;	// writer, then removals
+
+		std::vector<std::unique_ptr<DeviceScan>>	_deviceScans;	// current scan
+		std::mutex		_walkMutex;	// indexes, shared by the device walkers
+		bool			_saveCheckpoints;	// only for full scans
+
+		std::ostream*		_dryRunReport;	// only set during dry runs
+		std::mutex		_dryRunReportMutex;
+
+		mutable std::mutex	_progressMutex;
+		ScanProgress		_progress;
+		boost::posix_time::ptime	_progressPhaseStartTime;
+		const Stats*		_progressStats;
+		std::vector<const ScanJobQueue*>	_progressJobs;
+		const ScanResultQueue*	_progressResults;
+
+		std::mutex		_progressListenersMutex;
+		std::map<std::size_t, ProgressListener>	_progressListeners;
+		std::size_t		_nextProgressListenerId;
+		boost::thread		_progressReporter;
+
+		ParserFactory		_parserFactory;
 
 
 }; // class Updater
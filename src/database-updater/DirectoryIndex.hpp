@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DB_UPDATER_DIRECTORY_INDEX_HPP
+#define DB_UPDATER_DIRECTORY_INDEX_HPP
+
+#include <string>
+#include <unordered_map>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace DatabaseUpdater {
+
+// State of the directories at the end of the last completed scan
+// A directory whose write time and number of entries have not changed still has the same entries,
+// so its files do not need to be checked one by one
+class DirectoryIndex
+{
+	public:
+
+		struct Entry
+		{
+			boost::posix_time::ptime	lastWriteTime;
+			std::size_t			nbEntries;
+			long long			id;		// database id, -1 if not stored yet
+			bool				visited;	// walked during the current scan
+			bool				changed;	// differs from the stored state
+		};
+
+		void clear()	{ _entries.clear(); }
+		std::size_t size() const { return _entries.size(); }
+
+		void set(const std::string& path, const Entry& entry)	{ _entries[path] = entry; }
+
+		// State of a walked directory
+		void update(const std::string& path, boost::posix_time::ptime lastWriteTime, std::size_t nbEntries)
+		{
+			auto it = _entries.find(path);
+			if (it == _entries.end())
+			{
+				_entries[path] = Entry {lastWriteTime, nbEntries, -1, true, true};
+				return;
+			}
+
+			Entry& entry = it->second;
+			entry.visited = true;
+			if (entry.lastWriteTime != lastWriteTime || entry.nbEntries != nbEntries)
+			{
+				entry.lastWriteTime = lastWriteTime;
+				entry.nbEntries = nbEntries;
+				entry.changed = true;
+			}
+		}
+
+		// Directory that could not be entirely walked: its state never matches, so that it is walked again
+		void invalidate(const std::string& path)
+		{
+			auto it = _entries.find(path);
+			if (it == _entries.end())
+				return;
+
+			Entry& entry = it->second;
+			entry.visited = true;
+			entry.changed = entry.changed || !entry.lastWriteTime.is_not_a_date_time();
+			entry.lastWriteTime = boost::posix_time::not_a_date_time;
+			entry.nbEntries = 0;
+		}
+
+		typedef std::unordered_map<std::string, Entry>::const_iterator const_iterator;
+		const_iterator begin() const	{ return _entries.begin(); }
+		const_iterator end() const	{ return _entries.end(); }
+
+		// Returns nullptr if the directory is not known
+		const Entry* find(const std::string& path) const
+		{
+			auto it = _entries.find(path);
+			return (it != _entries.end()) ? &it->second : nullptr;
+		}
+
+	private:
+
+		std::unordered_map<std::string, Entry>	_entries;
+};
+
+} // namespace DatabaseUpdater
+
+#endif
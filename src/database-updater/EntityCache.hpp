@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DB_UPDATER_ENTITY_CACHE_HPP
+#define DB_UPDATER_ENTITY_CACHE_HPP
+
+#include <string>
+#include <unordered_map>
+
+#include "database/Types.hpp"
+
+namespace DatabaseUpdater {
+
+// Scan scoped cache of the entities a track refers to, so that an album
+// does not resolve the same artist, release and genres for each of its tracks
+// Only used by the writer: the pointers belong to its session
+// Must be cleared whenever a transaction is rolled back, since the entities
+// created in that transaction no longer exist in database
+struct EntityCache
+{
+	void clear()
+	{
+		artistsByMBID.clear();
+		artistsByName.clear();
+		releasesByMBID.clear();
+		releasesByName.clear();
+		genresByName.clear();
+
+		noneArtist.reset();
+		noneRelease.reset();
+		noneGenre.reset();
+	}
+
+	// By name entries only refer to entities that do not have a MBID
+	std::unordered_map<std::string, Database::Artist::pointer>	artistsByMBID;
+	std::unordered_map<std::string, Database::Artist::pointer>	artistsByName;
+	std::unordered_map<std::string, Database::Release::pointer>	releasesByMBID;
+	std::unordered_map<std::string, Database::Release::pointer>	releasesByName;
+	std::unordered_map<std::string, Database::Genre::pointer>	genresByName;
+
+	Database::Artist::pointer	noneArtist;
+	Database::Release::pointer	noneRelease;
+	Database::Genre::pointer	noneGenre;
+};
+
+} // namespace DatabaseUpdater
+
+#endif
+
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DB_UPDATER_PATH_INDEX_HPP
+#define DB_UPDATER_PATH_INDEX_HPP
+
+#include <string>
+#include <unordered_map>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace DatabaseUpdater {
+
+// In memory snapshot of the files known by the database
+// Loaded once at scan start so that unchanged files can be skipped without any query,
+// and so that the files that have not been walked can be detected as removed
+class PathIndex
+{
+	public:
+
+		struct Entry
+		{
+			long long			id;	// database id, -1 if not written yet
+			boost::posix_time::ptime	lastWriteTime;
+			long long			fileSize;
+			bool				visited;	// seen during the current walk
+		};
+
+		void clear()	{ _entries.clear(); }
+		std::size_t size() const { return _entries.size(); }
+
+		void reserve(std::size_t size)	{ _entries.reserve(size); }
+
+		void set(const std::string& path, const Entry& entry)	{ _entries[path] = entry; }
+
+		typedef std::unordered_map<std::string, Entry>::const_iterator const_iterator;
+		const_iterator begin() const	{ return _entries.begin(); }
+		const_iterator end() const	{ return _entries.end(); }
+
+		// Returns nullptr if the file is not known
+		Entry* find(const std::string& path)
+		{
+			auto it = _entries.find(path);
+			return (it != _entries.end()) ? &it->second : nullptr;
+		}
+
+	private:
+
+		std::unordered_map<std::string, Entry>	_entries;
+};
+
+} // namespace DatabaseUpdater
+
+#endif
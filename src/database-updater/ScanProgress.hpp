@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DB_UPDATER_SCAN_PROGRESS_HPP
+#define DB_UPDATER_SCAN_PROGRESS_HPP
+
+#include <array>
+#include <string>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace DatabaseUpdater {
+
+// Snapshot of the scan in progress (or of the last scan, if idle)
+struct ScanProgress
+{
+	enum class Phase
+	{
+		Idle,
+		Walk,		// walk, parse and write files
+		RemoveMissing,	// remove files that have not been walked
+		RemoveOrphans,	// remove artists, releases and genres without tracks
+		Duplicates,	// report duplicated files
+		Counters,	// update the artist, release and genre counters
+	};
+	static const std::size_t nbPhases = 6;
+
+	Phase				phase = Phase::Idle;
+	boost::posix_time::ptime	startTime;	// of the current scan
+	std::array<boost::posix_time::time_duration, nbPhases>	phaseDurations;	// wall time spent in each phase
+
+	std::size_t		nbExpectedFiles = 0;	// files in database when the walk started
+	std::size_t		nbWalked = 0;		// skipped or sent to parse
+	std::size_t		nbSkipped = 0;
+	std::size_t		nbScanned = 0;
+	std::size_t		nbScanErrors = 0;
+	std::size_t		nbNotImported = 0;
+	std::size_t		nbAdded = 0;
+	std::size_t		nbRemoved = 0;
+	std::size_t		nbModified = 0;
+	unsigned long long	nbBytesScanned = 0;
+
+	// Over the walk phase
+	double			filesPerSecond = 0;
+	double			bytesPerSecond = 0;
+
+	std::size_t		jobQueueSize = 0;	// files waiting to be parsed
+	std::size_t		resultQueueSize = 0;	// files waiting to be written
+
+	boost::posix_time::time_duration	eta = boost::posix_time::not_a_date_time;	// of the walk phase, if it can be estimated
+
+	static std::string phaseToString(Phase phase)
+	{
+		switch (phase)
+		{
+			case Phase::Idle:		return "idle";
+			case Phase::Walk:		return "walk";
+			case Phase::RemoveMissing:	return "remove-missing";
+			case Phase::RemoveOrphans:	return "remove-orphans";
+			case Phase::Duplicates:		return "duplicates";
+			case Phase::Counters:		return "counters";
+		}
+		return "";
+	}
+};
+
+} // namespace DatabaseUpdater
+
+#endif
+
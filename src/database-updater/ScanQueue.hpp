@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DB_UPDATER_SCAN_QUEUE_HPP
+#define DB_UPDATER_SCAN_QUEUE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace DatabaseUpdater {
+
+// Bounded blocking queue used to chain the scan stages
+// Producers are blocked while the queue is full, consumers while it is empty
+template <typename T>
+class ScanQueue
+{
+	public:
+		enum class PopStatus
+		{
+			Ok,
+			Timeout,
+			Closed,		// closed and drained
+		};
+
+		ScanQueue(std::size_t maxSize) : _maxSize(maxSize) {}
+
+		ScanQueue(const ScanQueue&) = delete;
+		ScanQueue& operator=(const ScanQueue&) = delete;
+
+		// Returns false if the queue has been closed
+		bool push(T item)
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+
+			_notFull.wait(lock, [this] { return _closed || _items.size() < _maxSize; });
+			if (_closed)
+				return false;
+
+			_items.push_back(std::move(item));
+			_notEmpty.notify_one();
+
+			return true;
+		}
+
+		// Returns false if the queue has been closed and there is nothing left to pop
+		bool pop(T& item)
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+
+			_notEmpty.wait(lock, [this] { return _closed || !_items.empty(); });
+			if (_items.empty())
+				return false;
+
+			item = std::move(_items.front());
+			_items.pop_front();
+			_notFull.notify_one();
+
+			return true;
+		}
+
+		// Same as pop, but gives up if nothing has been pushed before timeout
+		PopStatus popFor(T& item, std::chrono::milliseconds timeout)
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+
+			if (!_notEmpty.wait_for(lock, timeout, [this] { return _closed || !_items.empty(); }))
+				return PopStatus::Timeout;
+
+			if (_items.empty())
+				return PopStatus::Closed;
+
+			item = std::move(_items.front());
+			_items.pop_front();
+			_notFull.notify_one();
+
+			return PopStatus::Ok;
+		}
+
+		// No more items can be pushed, consumers are woken up once the queue is drained
+		void close()
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+
+			_closed = true;
+			_notEmpty.notify_all();
+			_notFull.notify_all();
+		}
+
+		std::size_t size() const
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			return _items.size();
+		}
+
+	private:
+
+		const std::size_t		_maxSize;
+		bool				_closed = false;
+		std::deque<T>			_items;
+
+		mutable std::mutex		_mutex;
+		std::condition_variable		_notEmpty;
+		std::condition_variable		_notFull;
+};
+
+} // namespace DatabaseUpdater
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "logger/Logger.hpp"
+
+#include "ScanThrottler.hpp"
+
+namespace DatabaseUpdater {
+
+// Used while other readers are busy, whatever the configured budget is
+static const std::size_t backOffMaxFilesPerSecond = 2;
+
+// Not exposed by the libc
+static const int ioprioWhoProcess = 1;
+static const int ioprioClassIdle = 3;
+static const int ioprioClassShift = 13;
+
+ScanThrottler::ScanThrottler()
+: _maxFilesPerSecond(0),
+_maxBytesPerSecond(0),
+_nextFileTime(boost::posix_time::min_date_time),
+_nextByteTime(boost::posix_time::min_date_time)
+{
+}
+
+void
+ScanThrottler::setLimits(std::size_t maxFilesPerSecond, unsigned long long maxBytesPerSecond)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_maxFilesPerSecond = maxFilesPerSecond;
+	_maxBytesPerSecond = maxBytesPerSecond;
+}
+
+boost::posix_time::time_duration
+ScanThrottler::reserve(unsigned long long fileSize, bool backOff)
+{
+	const boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	std::size_t maxFilesPerSecond = _maxFilesPerSecond;
+	if (backOff)
+		maxFilesPerSecond = maxFilesPerSecond ? std::min(maxFilesPerSecond, backOffMaxFilesPerSecond) : backOffMaxFilesPerSecond;
+
+	boost::posix_time::ptime startTime = now;
+
+	if (maxFilesPerSecond > 0)
+	{
+		startTime = std::max(startTime, _nextFileTime);
+		_nextFileTime = startTime + boost::posix_time::microseconds(1000000 / maxFilesPerSecond);
+	}
+
+	if (_maxBytesPerSecond > 0)
+	{
+		const boost::posix_time::ptime byteStartTime = std::max(now, _nextByteTime);
+
+		startTime = std::max(startTime, byteStartTime);
+		_nextByteTime = byteStartTime + boost::posix_time::microseconds(fileSize * 1000000 / _maxBytesPerSecond);
+	}
+
+	return startTime - now;
+}
+
+void
+setCurrentThreadLowPriority()
+{
+	const pid_t tid = ::syscall(SYS_gettid);
+
+	// On Linux, the nice value is per thread
+	if (::setpriority(PRIO_PROCESS, tid, 19) != 0)
+		LMS_LOG(DBUPDATER, WARNING) << "Cannot set the nice value of the scan thread";
+
+	if (::syscall(SYS_ioprio_set, ioprioWhoProcess, tid, ioprioClassIdle << ioprioClassShift) != 0)
+		LMS_LOG(DBUPDATER, WARNING) << "Cannot set the I/O priority of the scan thread";
+}
+
+} // namespace DatabaseUpdater
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DB_UPDATER_SCAN_THROTTLER_HPP
+#define DB_UPDATER_SCAN_THROTTLER_HPP
+
+#include <mutex>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace DatabaseUpdater {
+
+// Spreads the file reads of the scan workers so that they fit in a files/s and a bytes/s budget
+class ScanThrottler
+{
+	public:
+		ScanThrottler();
+
+		// 0 means unlimited
+		void setLimits(std::size_t maxFilesPerSecond, unsigned long long maxBytesPerSecond);
+
+		// Reserves the budget needed to read a file, thread safe
+		// Returns the time to wait before reading it
+		// In back off mode, the files/s budget is lowered to let other readers use the disks
+		boost::posix_time::time_duration reserve(unsigned long long fileSize, bool backOff);
+
+	private:
+
+		std::mutex			_mutex;
+		std::size_t			_maxFilesPerSecond;
+		unsigned long long		_maxBytesPerSecond;
+		boost::posix_time::ptime	_nextFileTime;	// no budget is saved while idle
+		boost::posix_time::ptime	_nextByteTime;
+};
+
+// Lowest CPU and idle class I/O priorities for the calling thread
+// Cannot be undone without privileges
+void setCurrentThreadLowPriority();
+
+} // namespace DatabaseUpdater
+
+#endif
@@ -25,6 +25,16 @@
 namespace Database
 {
 
+namespace {
+
+// Counters of each artist, using the track_artist_idx index
+const std::string countersUpdate = "UPDATE artist SET"
+		" track_count = (SELECT COUNT(*) FROM track t WHERE t.artist_id = artist.id),"
+		" release_count = (SELECT COUNT(DISTINCT t.release_id) FROM track t WHERE t.artist_id = artist.id),"
+		" duration = (SELECT COALESCE(SUM(t.duration), 0) FROM track t WHERE t.artist_id = artist.id)";
+
+} // namespace
+
 Artist::Artist(const std::string& name, const std::string& MBID)
 : _name(std::string(name, 0 , _maxNameLength)),
 _MBID(MBID)
@@ -74,20 +84,47 @@ Artist::getAll(Wt::Dbo::Session& session, int offset, int size)
 	return std::vector<pointer>(res.begin(), res.end());
 }
 
-std::vector<Artist::pointer>
-Artist::getAllOrphans(Wt::Dbo::Session& session)
+std::size_t
+Artist::removeOrphans(Wt::Dbo::Session& session)
 {
-	Wt::Dbo::collection<Artist::pointer> res = session.query< Wt::Dbo::ptr<Artist> >("select a from artist a LEFT OUTER JOIN Track t ON a.id = t.artist_id WHERE t.id IS NULL");
+	const std::string orphanCondition = "NOT EXISTS (SELECT 1 FROM track t WHERE t.artist_id = artist.id)";
 
-	return std::vector<pointer>(res.begin(), res.end());
+	session.flush();
+
+	int count = session.query<int>("SELECT COUNT(*) FROM artist WHERE " + orphanCondition);
+	if (count > 0)
+		session.execute("DELETE FROM artist WHERE " + orphanCondition);
+
+	return count;
+}
+
+void
+Artist::updateCounters(Wt::Dbo::Session& session, const std::set<id_type>& ids)
+{
+	if (ids.empty())
+		return;
+
+	session.flush();
+	session.execute(countersUpdate + " WHERE id IN (" + generateIdList(ids) + ")");
+}
+
+void
+Artist::updateAllCounters(Wt::Dbo::Session& session)
+{
+	session.flush();
+	session.execute(countersUpdate);
 }
 
 std::vector<Artist::pointer>
 Artist::getByFilter(Wt::Dbo::Session& session, SearchFilter filter, int offset, int size)
 {
-	Wt::Dbo::collection<Artist::pointer> res = getQuery(session, filter).limit(size).offset(offset);
+	Wt::Dbo::collection<SortedQueryResult> rows = getQuery(session, filter).limit(size).offset(offset);
 
-	return std::vector<pointer>(res.begin(), res.end());
+	std::vector<pointer> res;
+	for (const SortedQueryResult& row : rows)
+		res.push_back(row.get<0>());
+
+	return res;
 }
 
 std::vector<Artist::pointer>
@@ -106,6 +143,36 @@ Artist::getByFilter(Wt::Dbo::Session& session, SearchFilter filter, int offset,
 	return res;
 }
 
+std::vector<Artist::pointer>
+Artist::getByFilter(Wt::Dbo::Session& session, SearchFilter filter, SearchCursor& cursor, int size, bool& moreResults)
+{
+	Wt::Dbo::collection<SortedQueryResult> collection = getQuery(session, filter, cursor).limit(size + 1);
+	std::vector<SortedQueryResult> rows(collection.begin(), collection.end());
+
+	moreResults = (rows.size() == static_cast<std::size_t>(size) + 1);
+	if (moreResults)
+		rows.pop_back();
+
+	std::vector<pointer> res;
+	for (const SortedQueryResult& row : rows)
+		res.push_back(row.get<0>());
+
+	// The sort keys of the last row come along with it
+	if (!rows.empty())
+	{
+		const SortedQueryResult& row = rows.back();
+
+		SearchCursor::Position position;
+		position.rank = row.get<1>();
+		position.artistName = row.get<2>();
+		position.id = row.get<0>().id();
+
+		cursor.last = position;
+	}
+
+	return res;
+}
+
 
 
 std::vector<Wt::Dbo::ptr<Release> >
@@ -120,29 +187,49 @@ Artist::getReleases() const
 	return std::vector< Wt::Dbo::ptr<Release> > (res.begin(), res.end());
 }
 
-Wt::Dbo::Query<Artist::pointer>
-Artist::getQuery(Wt::Dbo::Session& session, SearchFilter filter)
+Wt::Dbo::Query<Artist::SortedQueryResult>
+Artist::getQuery(Wt::Dbo::Session& session, SearchFilter filter, const SearchCursor& cursor)
 {
-	SqlQuery sqlQuery = generatePartialQuery(filter);
+	SearchQuery searchQuery(SearchFilter::Field::Artist, filter);
+
+	// Best name matches first, the id makes the order total
+	const std::string rankOrder = searchQuery.rankByName();
+	const std::string sortKeys = (rankOrder.empty() ? "" : rankOrder + ",") + "a.name,a.id";
+
+	// Rows sorted after the cursor
+	if (cursor.last)
+		searchQuery.where("(" + sortKeys + ") > (" + (rankOrder.empty() ? "" : "?,") + "?,?)");
 
-	Wt::Dbo::Query<pointer> query
-		= session.query<pointer>( "SELECT a FROM artist a INNER JOIN track t ON t.artist_id = a.id INNER JOIN release r ON r.id = t.release_id INNER JOIN genre g ON g.id = t_g.genre_id INNER JOIN track_genre t_g ON t_g.track_id = t.id " + sqlQuery.where().get()).groupBy("a.id").orderBy("a.name");
+	Wt::Dbo::Query<SortedQueryResult> query
+		= session.query<SortedQueryResult>(searchQuery.get("a, " + (rankOrder.empty() ? "0" : rankOrder) + ", a.name")).orderBy(sortKeys);
 
-	for (const std::string& bindArg : sqlQuery.where().getBindArgs())
+	for (const std::string& bindArg : searchQuery.getBindArgs())
 		query.bind(bindArg);
 
+	if (cursor.last)
+	{
+		if (!rankOrder.empty())
+			query.bind(cursor.last->rank);
+		query.bind(cursor.last->artistName).bind(cursor.last->id);
+	}
+
 	return query;
 }
 
 Wt::Dbo::Query<Artist::UIQueryResult>
 Artist::getUIQuery(Wt::Dbo::Session& session, SearchFilter filter)
 {
-	SqlQuery sqlQuery = generatePartialQuery(filter);
+	if (filter.isEmpty())
+		return session.query<UIQueryResult>("SELECT a.id, a.name, a.release_count, a.track_count FROM artist a WHERE a.track_count > 0").orderBy("a.name");
+
+	// Only the artist is joined: each matching track is counted once
+	SearchQuery searchQuery(SearchFilter::Field::Track, filter);
+	searchQuery.join(SearchFilter::Field::Artist);
 
 	Wt::Dbo::Query<UIQueryResult> query
-		= session.query<UIQueryResult>( "SELECT a.id, a.name, COUNT(DISTINCT r.id), COUNT(DISTINCT t.id) FROM artist a INNER JOIN track t ON t.artist_id = a.id INNER JOIN release r ON r.id = t.release_id INNER JOIN genre g ON g.id = t_g.genre_id INNER JOIN track_genre t_g ON t_g.track_id = t.id " + sqlQuery.where().get()).groupBy("a.id").orderBy("a.name");
+		= session.query<UIQueryResult>(searchQuery.get("a.id, a.name, COUNT(DISTINCT t.release_id), COUNT(t.id)")).groupBy("a.id").orderBy("a.name");
 
-	for (const std::string& bindArg : sqlQuery.where().getBindArgs())
+	for (const std::string& bindArg : searchQuery.getBindArgs())
 		query.bind(bindArg);
 
 	return query;
@@ -151,17 +238,10 @@ Artist::getUIQuery(Wt::Dbo::Session& session, SearchFilter filter)
 void
 Artist::updateUIQueryModel(Wt::Dbo::Session& session, Wt::Dbo::QueryModel<UIQueryResult>& model, SearchFilter filter, const std::vector<Wt::WString>& columnNames)
 {
-	Wt::Dbo::Query<UIQueryResult> query = getUIQuery(session, filter);
-
-	model.setQuery(query, columnNames.empty() ? true : false);
+	const bool counters = filter.isEmpty();
 
-	// TODO do something better
-	if (columnNames.size() == 3)
-	{
-		model.addColumn( "a.name", columnNames.at(0));
-		model.addColumn( "COUNT(DISTINCT r.id)", columnNames.at(1) );
-		model.addColumn( "COUNT(DISTINCT t.id)", columnNames.at(2) );
-	}
+	setUIQueryModel(model, getUIQuery(session, filter),
+			{"a.name", counters ? "a.release_count" : "COUNT(DISTINCT t.release_id)", counters ? "a.track_count" : "COUNT(t.id)"}, columnNames);
 }
 
 
@@ -20,9 +20,12 @@
 #ifndef _DB_ARTIST_HPP_
 #define _DB_ARTIST_HPP_
 
+#include <set>
 #include <string>
 #include <vector>
 
+#include <boost/date_time/posix_time/posix_time.hpp>
+
 #include <Wt/Dbo/Dbo>
 #include <Wt/Dbo/QueryModel>
 
@@ -52,14 +55,24 @@ class Artist : public Wt::Dbo::Dbo<Artist>
 		static std::vector<pointer>	getByName(Wt::Dbo::Session& session, const std::string& name);
 		static std::vector<pointer> 	getByFilter(Wt::Dbo::Session& session, SearchFilter filter, int offset = -1, int size = -1);
 		static std::vector<pointer> 	getByFilter(Wt::Dbo::Session& session, SearchFilter filter, int offset, int size, bool& moreExpected);
+		static std::vector<pointer> 	getByFilter(Wt::Dbo::Session& session, SearchFilter filter, SearchCursor& cursor, int size, bool& moreResults);	// page after the cursor, moved to the last row
 
 		static std::vector<pointer>	getAll(Wt::Dbo::Session& session, int offset = -1, int size = -1);
-		static std::vector<pointer>	getAllOrphans(Wt::Dbo::Session& session);
+		static std::size_t		removeOrphans(Wt::Dbo::Session& session);	// returns the number of removed artists
+
+		// Recompute the counters from the tracks
+		static void			updateCounters(Wt::Dbo::Session& session, const std::set<id_type>& ids);
+		static void			updateAllCounters(Wt::Dbo::Session& session);
 
 		// Accessors
 		std::string getName(void) const { return _name; }
 		std::string getMBID(void) const { return _MBID; }
 
+		// Counters, maintained by the database updater
+		int getTrackCount(void) const { return _trackCount; }
+		int getReleaseCount(void) const { return _releaseCount; }
+		boost::posix_time::time_duration getDuration(void) const { return _duration; }
+
 		// Get the releases that have at least one track for this artist
 		std::vector<Wt::Dbo::ptr<Release> >	getReleases() const;
 
@@ -81,18 +94,26 @@ class Artist : public Wt::Dbo::Dbo<Artist>
 			{
 				Wt::Dbo::field(a, _name, "name");
 				Wt::Dbo::field(a, _MBID, "mbid");
+				Wt::Dbo::field(a, _trackCount, "track_count");
+				Wt::Dbo::field(a, _releaseCount, "release_count");
+				Wt::Dbo::field(a, _duration, "duration");
 
 				Wt::Dbo::hasMany(a, _tracks, Wt::Dbo::ManyToOne, "artist");
 			}
 
 	private:
 
-		static Wt::Dbo::Query<pointer> getQuery(Wt::Dbo::Session& session, SearchFilter filter);
+		// Rows along with their sort keys (name rank, name), sorted after the cursor if any
+		typedef boost::tuple<pointer, double, std::string> SortedQueryResult;
+		static Wt::Dbo::Query<SortedQueryResult> getQuery(Wt::Dbo::Session& session, SearchFilter filter, const SearchCursor& cursor = SearchCursor());
 
 		static const std::size_t _maxNameLength = 128;
 
 		std::string _name;
 		std::string _MBID;	// Musicbrainz Identifier
+		int _trackCount = 0;
+		int _releaseCount = 0;
+		boost::posix_time::time_duration _duration;
 
 		Wt::Dbo::collection< Wt::Dbo::ptr<Track> > _tracks; // Tracks of this artist
 };
@@ -17,6 +17,8 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cassert>
+
 #include <Wt/Dbo/FixedSqlConnectionPool>
 #include <Wt/Dbo/backend/Sqlite3>
 
@@ -31,6 +33,7 @@
 #include "logger/Logger.hpp"
 
 #include "DatabaseHandler.hpp"
+#include "Migration.hpp"
 
 namespace Database {
 
@@ -75,37 +78,38 @@ Handler::getPasswordService()
 }
 
 
-Handler::Handler(Wt::Dbo::SqlConnectionPool& connectionPool)
+void
+Handler::mapClasses(Wt::Dbo::Session& session)
 {
-	_session.setConnectionPool(connectionPool);
-
-
-	_session.mapClass<Database::Artist>("artist");
-	_session.mapClass<Database::Genre>("genre");
-	_session.mapClass<Database::Track>("track");
-	_session.mapClass<Database::Playlist>("playlist");
-	_session.mapClass<Database::PlaylistEntry>("playlist_entry");
-	_session.mapClass<Database::Release>("release");
-	_session.mapClass<Database::Video>("video");
-	_session.mapClass<Database::MediaDirectory>("media_directory");
-	_session.mapClass<Database::MediaDirectorySettings>("media_directory_settings");
-
-	_session.mapClass<Database::User>("user");
-	_session.mapClass<Database::AuthInfo>("auth_info");
-	_session.mapClass<Database::AuthInfo::AuthIdentityType>("auth_identity");
-	_session.mapClass<Database::AuthInfo::AuthTokenType>("auth_token");
+	session.mapClass<Database::Artist>("artist");
+	session.mapClass<Database::Genre>("genre");
+	session.mapClass<Database::Track>("track");
+	session.mapClass<Database::TrackDuplicate>("track_duplicate");
+	session.mapClass<Database::Playlist>("playlist");
+	session.mapClass<Database::PlaylistEntry>("playlist_entry");
+	session.mapClass<Database::Release>("release");
+	session.mapClass<Database::Video>("video");
+	session.mapClass<Database::MediaDirectory>("media_directory");
+	session.mapClass<Database::MediaDirectorySettings>("media_directory_settings");
+	session.mapClass<Database::ScanCheckpoint>("scan_checkpoint");
+	session.mapClass<Database::ScannedDirectory>("scanned_directory");
+
+	session.mapClass<Database::User>("user");
+	session.mapClass<Database::AuthInfo>("auth_info");
+	session.mapClass<Database::AuthInfo::AuthIdentityType>("auth_identity");
+	session.mapClass<Database::AuthInfo::AuthTokenType>("auth_token");
+}
 
-	try {
-		Wt::Dbo::Transaction transaction(_session);
+Handler::Handler(Wt::Dbo::SqlConnectionPool& connectionPool, Wt::Dbo::SqlConnectionPool* readConnectionPool)
+{
+	_session.setConnectionPool(connectionPool);
+	mapClasses(_session);
 
-	        _session.createTables();
-		_session.execute("CREATE INDEX artist_name_idx ON artist(name)");
-		_session.execute("CREATE INDEX genre_name_idx ON genre(name)");
-		_session.execute("CREATE INDEX release_name_idx ON release(name)");
-		_session.execute("CREATE INDEX track_name_idx ON track(name)");
-	}
-	catch(std::exception& e) {
-		LMS_LOG(DB, ERROR) << "Cannot create tables: " << e.what();
+	if (readConnectionPool)
+	{
+		_readSession.reset(new Wt::Dbo::Session());
+		_readSession->setConnectionPool(*readConnectionPool);
+		mapClasses(*_readSession);
 	}
 
 	{
@@ -168,7 +172,85 @@ Handler::createConnectionPool(boost::filesystem::path p)
 	connection->executeSql("pragma journal_mode=WAL");
 
 	//  connection->setProperty("show-queries", "true");
-	return new Wt::Dbo::FixedSqlConnectionPool(connection, 1);
+	std::unique_ptr<Wt::Dbo::SqlConnectionPool> connectionPool(new Wt::Dbo::FixedSqlConnectionPool(connection, 1));
+
+	migrate(*connectionPool);
+
+	return connectionPool.release();
+}
+
+void
+Handler::migrate(Wt::Dbo::SqlConnectionPool& connectionPool)
+{
+	Wt::Dbo::Session session;
+	session.setConnectionPool(connectionPool);
+	mapClasses(session);
+
+	try
+	{
+		migrateSchema(session);
+	}
+	catch (std::exception& e)
+	{
+		LMS_LOG(DB, ERROR) << "Cannot migrate database schema: " << e.what();
+		throw;
+	}
+}
+
+Wt::Dbo::SqlConnectionPool*
+Handler::createReadConnectionPool(boost::filesystem::path p, std::size_t nbConnections)
+{
+	LMS_LOG(DB, INFO) << "Creating read connection pool on file " << p << ", connections = " << nbConnections;
+
+	assert(nbConnections > 0);
+
+	Wt::Dbo::SqlConnectionPool* connectionPool = new Wt::Dbo::FixedSqlConnectionPool(new Wt::Dbo::backend::Sqlite3(p.string()), nbConnections);
+
+	// The connections are cloned by the pool: setup each one of them
+	std::vector<Wt::Dbo::SqlConnection*> connections;
+	for (std::size_t i = 0; i < nbConnections; ++i)
+		connections.push_back(connectionPool->getConnection());
+
+	for (Wt::Dbo::SqlConnection* connection : connections)
+	{
+		connection->executeSql("PRAGMA query_only=ON");
+		connectionPool->returnConnection(connection);
+	}
+
+	return connectionPool;
+}
+
+void
+Handler::setBulkImportMode(Wt::Dbo::SqlConnectionPool& connectionPool, bool enable)
+{
+	LMS_LOG(DB, INFO) << (enable ? "Entering" : "Leaving") << " bulk import mode";
+
+	// The safety level cannot be changed inside a transaction,
+	// so use the connection directly instead of a session
+	Wt::Dbo::SqlConnection* connection = connectionPool.getConnection();
+
+	try
+	{
+		if (enable)
+		{
+			// In WAL mode, NORMAL only syncs on checkpoints: the database cannot get corrupted,
+			// but the last commits may be lost on power failure
+			connection->executeSql("PRAGMA synchronous=NORMAL");
+			connection->executeSql("PRAGMA cache_size=-65536"); // 64 MiB
+		}
+		else
+		{
+			// Back to the SQLite defaults
+			connection->executeSql("PRAGMA synchronous=FULL");
+			connection->executeSql("PRAGMA cache_size=-2000");
+		}
+	}
+	catch (std::exception& e)
+	{
+		LMS_LOG(DB, ERROR) << "Cannot change bulk import mode: " << e.what();
+	}
+
+	connectionPool.returnConnection(connection);
 }
 
 
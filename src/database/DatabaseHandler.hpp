@@ -20,6 +20,8 @@
 #ifndef DATABASE_HANDLER_HPP
 #define DATABASE_HANDLER_HPP
 
+#include <memory>
+
 #include <boost/filesystem.hpp>
 
 #include <Wt/Dbo/Dbo>
@@ -40,11 +42,17 @@ class Handler
 {
 	public:
 
-		Handler(Wt::Dbo::SqlConnectionPool& connectionPool);
+		// Read only requests may be routed to a pool of reader connections, so that they
+		// are not serialized with the writes (the writer pool has a single connection)
+		Handler(Wt::Dbo::SqlConnectionPool& connectionPool, Wt::Dbo::SqlConnectionPool* readConnectionPool = nullptr);
 		~Handler();
 
 		Wt::Dbo::Session& getSession() { return _session; }
 
+		// Objects loaded using this session must not be modified
+		// Same as getSession() if there is no reader pool
+		Wt::Dbo::Session& getReadSession() { return _readSession ? *_readSession : _session; }
+
 		Wt::Dbo::ptr<User> getCurrentUser();	// get the current user, may return empty
 		Wt::Dbo::ptr<User> getUser(const Wt::Auth::User& authUser);	// Get or create the given user
 
@@ -57,16 +65,46 @@ class Handler
 		static const Wt::Auth::AuthService& getAuthService();
 		static const Wt::Auth::PasswordService& getPasswordService();
 
+		// Also migrates the database schema
 		static Wt::Dbo::SqlConnectionPool*	createConnectionPool(boost::filesystem::path db);
 
+		// Brings the database schema up to date, to be done once before creating any Handler
+		static void	migrate(Wt::Dbo::SqlConnectionPool& connectionPool);
+
+		// Read only connections, the database must have been created by the writer pool first
+		// Thanks to WAL, readers neither block nor are blocked by the writer
+		static Wt::Dbo::SqlConnectionPool*	createReadConnectionPool(boost::filesystem::path db, std::size_t nbConnections);
+
+		// Trade durability for speed on the pool's connections during large imports
+		// (relaxed synchronous mode, bigger page cache)
+		// See BulkImportMode below
+		static void	setBulkImportMode(Wt::Dbo::SqlConnectionPool& connectionPool, bool enable);
+
 	private:
 
+		static void mapClasses(Wt::Dbo::Session& session);
+
 		Wt::Dbo::Session		_session;
+		std::unique_ptr<Wt::Dbo::Session>	_readSession;
 		UserDatabase*			_users;
 		Wt::Auth::Login 		_login;
 
 };
 
+// Bulk import mode for the lifetime of the object, left even if the import throws
+class BulkImportMode
+{
+	public:
+		BulkImportMode(Wt::Dbo::SqlConnectionPool& connectionPool) : _connectionPool(connectionPool) { Handler::setBulkImportMode(_connectionPool, true); }
+		~BulkImportMode() { Handler::setBulkImportMode(_connectionPool, false); }
+
+		BulkImportMode(const BulkImportMode&) = delete;
+		BulkImportMode& operator=(const BulkImportMode&) = delete;
+
+	private:
+		Wt::Dbo::SqlConnectionPool&	_connectionPool;
+};
+
 } // namespace Database
 
 #endif
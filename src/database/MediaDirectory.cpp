@@ -54,7 +54,15 @@ MediaDirectorySettings::MediaDirectorySettings()
 : _manualScanRequested(false),
 _updatePeriod(Never),
 _audioFileExtensions(".mp3 .ogg .oga .aac .m4a .flac .wav .wma .aif .aiff .ape .mpc .shn"),
-_videoFileExtensions(".flv .avi .mpg .mpeg .mp4 .m4v .mkv .mov .wmv .ogv .divx .m2ts")
+_videoFileExtensions(".flv .avi .mpg .mpeg .mp4 .m4v .mkv .mov .wmv .ogv .divx .m2ts"),
+_scanWorkerCount(0),
+_scanWorkersPerDevice(0),
+_scanBatchSize(200),
+_scanBatchDuration(boost::posix_time::seconds(2)),
+_fullScanPeriod(boost::posix_time::hours(24 * 7)),
+_scanThrottling(false),
+_scanMaxFilesPerSecond(20),
+_scanMaxMBytesPerSecond(20)
 {
 }
 
@@ -139,4 +147,57 @@ MediaDirectory::get(Wt::Dbo::Session& session, boost::filesystem::path p, Type t
 }
 
 
+ScanCheckpoint::ScanCheckpoint()
+: _inProgress(false),
+_duplicateCheckPending(false),
+_countersUpdatePending(false)
+{
+}
+
+ScanCheckpoint::pointer
+ScanCheckpoint::get(Wt::Dbo::Session& session)
+{
+	pointer res = session.find<ScanCheckpoint>().where("id = ?").bind(1);
+	if (!res)
+		res = session.add( new ScanCheckpoint());
+
+	return res;
+}
+
+void
+ScanCheckpoint::reset()
+{
+	_inProgress = false;
+	_rootDirectory.clear();
+	_lastPath.clear();
+	_stats.clear();
+}
+
+ScannedDirectory::ScannedDirectory(const boost::filesystem::path& p, boost::posix_time::ptime lastWriteTime, std::size_t nbEntries)
+: _path(p.string()),
+_lastWriteTime(lastWriteTime),
+_nbEntries(nbEntries)
+{
+}
+
+ScannedDirectory::pointer
+ScannedDirectory::create(Wt::Dbo::Session& session, const boost::filesystem::path& p, boost::posix_time::ptime lastWriteTime, std::size_t nbEntries)
+{
+	return session.add( new ScannedDirectory(p, lastWriteTime, nbEntries) );
+}
+
+ScannedDirectory::pointer
+ScannedDirectory::getById(Wt::Dbo::Session& session, long long id)
+{
+	return session.find<ScannedDirectory>().where("id = ?").bind(id);
+}
+
+std::vector<ScannedDirectory::pointer>
+ScannedDirectory::getAll(Wt::Dbo::Session& session)
+{
+	Wt::Dbo::collection<ScannedDirectory::pointer> res = session.find<ScannedDirectory>();
+
+	return std::vector<ScannedDirectory::pointer>(res.begin(), res.end());
+}
+
 } // namespace Database
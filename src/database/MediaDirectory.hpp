@@ -57,6 +57,15 @@ class MediaDirectorySettings
 		void	setLastScan(boost::posix_time::ptime time)	{ _lastScan = time; }
 		void	setAudioFileExtensions(std::vector<boost::filesystem::path> extensions);
 		void	setVideoFileExtensions(std::vector<boost::filesystem::path> extensions);
+		void	setScanWorkerCount(int count)			{ _scanWorkerCount = count; }
+		void	setScanWorkersPerDevice(int count)		{ _scanWorkersPerDevice = count; }
+		void	setScanBatchSize(int size)			{ _scanBatchSize = size; }
+		void	setScanBatchDuration(boost::posix_time::time_duration dur)	{ _scanBatchDuration = dur; }
+		void	setFullScanPeriod(boost::posix_time::time_duration dur)	{ _fullScanPeriod = dur; }
+		void	setLastFullScan(boost::posix_time::ptime time)	{ _lastFullScan = time; }
+		void	setScanThrottling(bool value)			{ _scanThrottling = value; }
+		void	setScanMaxFilesPerSecond(int value)		{ _scanMaxFilesPerSecond = value; }
+		void	setScanMaxMBytesPerSecond(int value)		{ _scanMaxMBytesPerSecond = value; }
 
 		// Read accessors
 		bool				getManualScanRequested(void) const	{ return _manualScanRequested; }
@@ -66,6 +75,15 @@ class MediaDirectorySettings
 		boost::posix_time::ptime	getLastScan(void) const			{ return _lastScan; }
 		std::vector<boost::filesystem::path>	getAudioFileExtensions(void) const;
 		std::vector<boost::filesystem::path>	getVideoFileExtensions(void) const;
+		int				getScanWorkerCount(void) const		{ return _scanWorkerCount; }
+		int				getScanWorkersPerDevice(void) const	{ return _scanWorkersPerDevice; }
+		int				getScanBatchSize(void) const		{ return _scanBatchSize; }
+		boost::posix_time::time_duration	getScanBatchDuration(void) const	{ return _scanBatchDuration; }
+		boost::posix_time::time_duration	getFullScanPeriod(void) const	{ return _fullScanPeriod; }
+		boost::posix_time::ptime	getLastFullScan(void) const		{ return _lastFullScan; }
+		bool				getScanThrottling(void) const		{ return _scanThrottling; }
+		int				getScanMaxFilesPerSecond(void) const	{ return _scanMaxFilesPerSecond; }
+		int				getScanMaxMBytesPerSecond(void) const	{ return _scanMaxMBytesPerSecond; }
 
 		template<class Action>
 			void persist(Action& a)
@@ -77,6 +95,15 @@ class MediaDirectorySettings
 				Wt::Dbo::field(a, _videoFileExtensions,	"video_file_extensions");
 				Wt::Dbo::field(a, _lastUpdate,		"last_update");
 				Wt::Dbo::field(a, _lastScan,		"last_scan");
+				Wt::Dbo::field(a, _scanWorkerCount,	"scan_worker_count");
+				Wt::Dbo::field(a, _scanWorkersPerDevice,	"scan_workers_per_device");
+				Wt::Dbo::field(a, _scanBatchSize,	"scan_batch_size");
+				Wt::Dbo::field(a, _scanBatchDuration,	"scan_batch_duration");
+				Wt::Dbo::field(a, _fullScanPeriod,	"full_scan_period");
+				Wt::Dbo::field(a, _lastFullScan,	"last_full_scan");
+				Wt::Dbo::field(a, _scanThrottling,	"scan_throttling");
+				Wt::Dbo::field(a, _scanMaxFilesPerSecond,	"scan_max_files_per_second");
+				Wt::Dbo::field(a, _scanMaxMBytesPerSecond,	"scan_max_mbytes_per_second");
 				Wt::Dbo::hasMany(a, _mediaDirectories, Wt::Dbo::ManyToOne, "media_directory_settings");
 			}
 
@@ -89,6 +116,18 @@ class MediaDirectorySettings
 		std::string				_videoFileExtensions;	// Extension of the video files to be scanned
 		boost::posix_time::ptime		_lastUpdate;		// last time the database has changed
 		boost::posix_time::ptime		_lastScan;		// last time the database has been scanned
+		int					_scanWorkerCount;	// Number of parse/checksum workers, 0 means one per core
+		int					_scanWorkersPerDevice;	// Max number of workers reading the same device, 0 means unlimited
+		int					_scanBatchSize;		// Max number of files written in a single transaction
+		boost::posix_time::time_duration	_scanBatchDuration;	// Max time a write transaction is kept open
+		// Between two full scans, the directories with the same write time and number of entries are skipped. Not seen until the next full scan:
+		// - files modified in place, as the directory write time does not change
+		// - sub directories of a skipped directory that are missing from the directory states
+		boost::posix_time::time_duration	_fullScanPeriod;	// Max time between two scans that do not skip unchanged directories
+		boost::posix_time::ptime		_lastFullScan;		// last time a full scan has been completed
+		bool					_scanThrottling;	// Low priority scan threads, read budgets and back off while transcoding
+		int					_scanMaxFilesPerSecond;	// Throttling only, 0 means unlimited
+		int					_scanMaxMBytesPerSecond;	// Throttling only, 0 means unlimited
 		Wt::Dbo::collection< Wt::Dbo::ptr<MediaDirectory> > _mediaDirectories;	// list of media directories
 };
 
@@ -135,6 +174,91 @@ class MediaDirectory
 
 };
 
+// Progress of the current full scan, used to resume an interrupted scan
+class ScanCheckpoint
+{
+	public:
+
+		typedef Wt::Dbo::ptr<ScanCheckpoint> pointer;
+
+		ScanCheckpoint();
+
+		static pointer get(Wt::Dbo::Session& session);	// created if needed
+
+		// write accessors
+		void	setInProgress(bool value)				{ _inProgress = value; }
+		void	setRootDirectory(const boost::filesystem::path& p)	{ _rootDirectory = p.string(); }
+		void	setLastPath(const boost::filesystem::path& p)		{ _lastPath = p.string(); }
+		void	setStats(const std::string& stats)			{ _stats = stats; }
+		void	setDuplicateCheckPending(bool value)			{ _duplicateCheckPending = value; }
+		void	setCountersUpdatePending(bool value)			{ _countersUpdatePending = value; }
+		void	reset();
+
+		// Read accessors
+		bool			getInProgress(void) const	{ return _inProgress; }
+		boost::filesystem::path	getRootDirectory(void) const	{ return _rootDirectory; }
+		boost::filesystem::path	getLastPath(void) const		{ return _lastPath; }
+		const std::string&	getStats(void) const		{ return _stats; }
+		bool			getDuplicateCheckPending(void) const	{ return _duplicateCheckPending; }
+		bool			getCountersUpdatePending(void) const	{ return _countersUpdatePending; }
+
+		template<class Action>
+			void persist(Action& a)
+			{
+				Wt::Dbo::field(a, _inProgress,		"in_progress");
+				Wt::Dbo::field(a, _rootDirectory,	"root_directory");
+				Wt::Dbo::field(a, _lastPath,		"last_path");
+				Wt::Dbo::field(a, _stats,		"stats");
+				Wt::Dbo::field(a, _duplicateCheckPending,	"duplicate_check_pending");
+				Wt::Dbo::field(a, _countersUpdatePending,	"counters_update_pending");
+			}
+
+	private:
+
+		bool		_inProgress;	// A scan has been started but not completed
+		std::string	_rootDirectory;	// root directory being walked
+		std::string	_lastPath;	// everything up to this path (walk order) has been written
+		std::string	_stats;		// stats of the scan so far, serialized by the updater
+		bool		_duplicateCheckPending;	// tracks may have changed since the last duplicate check, not cleared by reset
+		bool		_countersUpdatePending;	// same for the counters
+};
+
+// Directory state at the end of the last completed scan
+// Used to skip the directories whose content has not changed
+class ScannedDirectory
+{
+	public:
+
+		typedef Wt::Dbo::ptr<ScannedDirectory> pointer;
+
+		ScannedDirectory() {}
+		ScannedDirectory(const boost::filesystem::path& p, boost::posix_time::ptime lastWriteTime, std::size_t nbEntries);
+
+		static pointer create(Wt::Dbo::Session& session, const boost::filesystem::path& p, boost::posix_time::ptime lastWriteTime, std::size_t nbEntries);
+		static pointer getById(Wt::Dbo::Session& session, long long id);
+		static std::vector<pointer> getAll(Wt::Dbo::Session& session);
+
+		boost::filesystem::path		getPath(void) const		{ return _path; }
+		boost::posix_time::ptime	getLastWriteTime(void) const	{ return _lastWriteTime; }
+		std::size_t			getNbEntries(void) const	{ return _nbEntries; }
+
+		void setState(boost::posix_time::ptime lastWriteTime, std::size_t nbEntries)	{ _lastWriteTime = lastWriteTime; _nbEntries = nbEntries; }
+
+		template<class Action>
+			void persist(Action& a)
+			{
+				Wt::Dbo::field(a, _path,		"path");
+				Wt::Dbo::field(a, _lastWriteTime,	"last_write_time");
+				Wt::Dbo::field(a, _nbEntries,		"entry_count");
+			}
+
+	private:
+
+		std::string			_path;
+		boost::posix_time::ptime	_lastWriteTime;
+		int				_nbEntries;
+};
+
 } // namespace Database
 
 #endif
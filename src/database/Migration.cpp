@@ -0,0 +1,413 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <cstdio>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "logger/Logger.hpp"
+
+#include "SearchFilter.hpp"
+#include "Types.hpp"
+
+#include "Migration.hpp"
+
+namespace Database {
+
+namespace {
+
+struct Index
+{
+	const char*	name;
+	const char*	table;
+	const char*	columns;
+};
+
+// Indexes used by the hot queries (browsing, scanner lookups, duplicates)
+const std::vector<Index> managedIndexes =
+{
+	{"artist_name_idx",		"artist",		"name"},
+	{"artist_mbid_idx",		"artist",		"mbid"},
+	{"genre_name_idx",		"genre",		"name"},
+	{"release_name_idx",		"release",		"name"},
+	{"release_mbid_idx",		"release",		"mbid"},
+	{"track_name_idx",		"track",		"name"},
+	{"track_path_idx",		"track",		"file_path"},
+	{"track_mbid_idx",		"track",		"mbid"},
+	{"track_checksum_idx",		"track",		"checksum, checksum_type"},
+	{"track_artist_idx",		"track",		"artist_id, date"},			// sorted by artist name, then date
+	{"track_release_idx",		"track",		"release_id, disc_number, track_number"},	// then disc and track numbers
+	{"track_genre_track_idx",	"track_genre",		"track_id"},
+	{"track_genre_genre_idx",	"track_genre",		"genre_id"},
+	{"track_duplicate_key_idx",	"track_duplicate",	"type, duplicate_key"},
+	{"video_path_idx",		"video",		"path"},
+};
+
+// Steps are idempotent: a step that has been partially applied can be run again
+struct Migration
+{
+	int		version;	// schema version once applied
+	const char*	description;
+	std::function<void(Wt::Dbo::Session&)>	apply;
+};
+
+bool
+hasTable(Wt::Dbo::Session& session, const std::string& table)
+{
+	int count = session.query<int>("SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' AND name = ?").bind(table);
+	return count > 0;
+}
+
+bool
+hasColumn(Wt::Dbo::Session& session, const std::string& table, const std::string& column)
+{
+	int count = session.query<int>("SELECT COUNT(*) FROM pragma_table_info('" + table + "') WHERE name = ?").bind(column);
+	return count > 0;
+}
+
+// Existing rows get the default value
+void
+addColumn(Wt::Dbo::Session& session, const std::string& table, const std::string& column, const std::string& definition)
+{
+	if (!hasColumn(session, table, column))
+		session.execute("ALTER TABLE \"" + table + "\" ADD COLUMN \"" + column + "\" " + definition);
+}
+
+void
+createIndexes(Wt::Dbo::Session& session)
+{
+	for (const Index& index : managedIndexes)
+		session.execute(std::string("CREATE INDEX IF NOT EXISTS ") + index.name + " ON " + index.table + "(" + index.columns + ")");
+}
+
+// Tables whose names are indexed for the keyword searches
+const std::vector<std::string> fullTextTables = {"artist", "release", "genre", "track"};
+
+// FTS5 with the trigram tokenizer, SQLite 3.34 or later
+bool
+hasFullTextSupport(Wt::Dbo::Session& session)
+{
+	int used = session.query<int>("SELECT sqlite_compileoption_used('ENABLE_FTS5')");
+	if (used == 0)
+		return false;
+
+	const std::string version = session.query<std::string>("SELECT sqlite_version()");
+
+	int major = 0;
+	int minor = 0;
+	if (std::sscanf(version.c_str(), "%d.%d", &major, &minor) != 2)
+		return false;
+
+	return major > 3 || (major == 3 && minor >= 34);
+}
+
+// Wt::Dbo updates all the columns of a modified object: only reindex the names that did change
+void
+createFullTextUpdateTrigger(Wt::Dbo::Session& session, const std::string& table)
+{
+	const std::string fts = table + "_fts";
+
+	session.execute("CREATE TRIGGER IF NOT EXISTS " + fts + "_update AFTER UPDATE OF name ON \"" + table + "\" WHEN old.name IS NOT new.name BEGIN "
+			"INSERT INTO " + fts + "(" + fts + ", rowid, name) VALUES ('delete', old.id, old.name); "
+			"INSERT INTO " + fts + "(rowid, name) VALUES (new.id, new.name); END");
+}
+
+// External content FTS5 tables, kept in sync with the names by triggers
+// Trigrams match any part of the names, as the LIKE conditions they replace
+void
+createFullTextIndexes(Wt::Dbo::Session& session)
+{
+	if (!hasFullTextSupport(session))
+	{
+		LMS_LOG(DB, WARNING) << "SQLite built without FTS5 or older than 3.34, keyword searches will be slower";
+		return;
+	}
+
+	for (const std::string& table : fullTextTables)
+	{
+		const std::string fts = table + "_fts";
+
+		session.execute("CREATE VIRTUAL TABLE IF NOT EXISTS " + fts + " USING fts5(name, content='" + table + "', content_rowid='id', tokenize='trigram')");
+
+		session.execute("CREATE TRIGGER IF NOT EXISTS " + fts + "_insert AFTER INSERT ON \"" + table + "\" BEGIN "
+				"INSERT INTO " + fts + "(rowid, name) VALUES (new.id, new.name); END");
+		session.execute("CREATE TRIGGER IF NOT EXISTS " + fts + "_delete AFTER DELETE ON \"" + table + "\" BEGIN "
+				"INSERT INTO " + fts + "(" + fts + ", rowid, name) VALUES ('delete', old.id, old.name); END");
+		createFullTextUpdateTrigger(session, table);
+
+		session.execute("INSERT INTO " + fts + "(" + fts + ") VALUES ('rebuild')");
+	}
+}
+
+int
+getVersion(Wt::Dbo::Session& session)
+{
+	return session.query<int>("SELECT user_version FROM pragma_user_version");
+}
+
+void
+setVersion(Wt::Dbo::Session& session, int version)
+{
+	session.execute("PRAGMA user_version = " + std::to_string(version));
+}
+
+// Selects all the mapped columns of the class
+template <class C>
+void
+checkTable(Wt::Dbo::Session& session)
+{
+	Wt::Dbo::collection<Wt::Dbo::ptr<C>> res = session.find<C>().limit(1);
+	for (auto it = res.begin(); it != res.end(); ++it)
+		;
+}
+
+// A schema change made without its migration step fails here, at startup, rather than during a scan
+void
+checkSchema(Wt::Dbo::Session& session)
+{
+	try
+	{
+		checkTable<Artist>(session);
+		checkTable<Genre>(session);
+		checkTable<Track>(session);
+		checkTable<TrackDuplicate>(session);
+		checkTable<Playlist>(session);
+		checkTable<PlaylistEntry>(session);
+		checkTable<Release>(session);
+		checkTable<Video>(session);
+		checkTable<MediaDirectory>(session);
+		checkTable<MediaDirectorySettings>(session);
+		checkTable<ScanCheckpoint>(session);
+		checkTable<ScannedDirectory>(session);
+		checkTable<User>(session);
+	}
+	catch (Wt::Dbo::Exception& e)
+	{
+		throw std::runtime_error(std::string("Database schema does not match the classes, missing migration step? ") + e.what());
+	}
+}
+
+// Version 0 is the schema created before the versioning
+// Columns are added the way Wt::Dbo creates them, with the defaults of the constructors
+// (time durations are stored in milliseconds)
+// Steps only use plain SQL: the classes follow the latest schema, not the one of the step
+const std::vector<Migration> migrations =
+{
+	{1, "scanner settings, file sizes, checksum types, scan checkpoints and directory states", [](Wt::Dbo::Session& session)
+	{
+		addColumn(session, "media_directory_settings", "scan_worker_count",		"integer not null default 0");
+		addColumn(session, "media_directory_settings", "scan_workers_per_device",	"integer not null default 0");
+		addColumn(session, "media_directory_settings", "scan_batch_size",		"integer not null default 200");
+		addColumn(session, "media_directory_settings", "scan_batch_duration",		"integer default 2000");
+		addColumn(session, "media_directory_settings", "full_scan_period",		"integer default 604800000");
+		addColumn(session, "media_directory_settings", "last_full_scan",		"text");
+		addColumn(session, "media_directory_settings", "scan_throttling",		"boolean not null default 0");
+		addColumn(session, "media_directory_settings", "scan_max_files_per_second",	"integer not null default 20");
+		addColumn(session, "media_directory_settings", "scan_max_mbytes_per_second",	"integer not null default 20");
+
+		// Unknown sizes: the files are parsed again by the next scan
+		addColumn(session, "track", "file_size",	"bigint not null default 0");
+		addColumn(session, "track", "checksum_type",	"integer not null default 0");
+		addColumn(session, "video", "file_size",	"bigint not null default 0");
+
+		session.execute("CREATE TABLE IF NOT EXISTS \"scan_checkpoint\" ("
+				"\"id\" integer primary key autoincrement, "
+				"\"version\" integer not null, "
+				"\"in_progress\" boolean not null, "
+				"\"root_directory\" text not null, "
+				"\"last_path\" text not null, "
+				"\"stats\" text not null)");
+
+		session.execute("CREATE TABLE IF NOT EXISTS \"scanned_directory\" ("
+				"\"id\" integer primary key autoincrement, "
+				"\"version\" integer not null, "
+				"\"path\" text not null, "
+				"\"last_write_time\" text, "
+				"\"entry_count\" integer not null)");
+	}},
+
+	{2, "cover store hashes", [](Wt::Dbo::Session& session)
+	{
+		addColumn(session, "track", "cover_hash",	"text not null default ''");
+		addColumn(session, "release", "cover_hash",	"text not null default ''");
+
+		// Backfill: the embedded covers are extracted by the scanner only
+		// Forget the last write time of these tracks so that they are parsed again
+		session.execute("UPDATE track SET file_last_write = NULL WHERE cover_type = ? AND cover_hash = ''").bind(static_cast<int>(Track::CoverType::Embedded));
+
+		// The next scan must be a full one, as the skipped directories would not reach these tracks
+		session.execute("UPDATE media_directory_settings SET last_full_scan = NULL");
+	}},
+
+	{3, "track duplicates", [](Wt::Dbo::Session& session)
+	{
+		// Filled by the next full scan
+		session.execute("CREATE TABLE IF NOT EXISTS \"track_duplicate\" ("
+				"\"id\" integer primary key autoincrement, "
+				"\"version\" integer not null, "
+				"\"type\" integer not null, "
+				"\"duplicate_key\" text not null, "
+				"\"track_id\" bigint, "
+				"constraint \"fk_track_duplicate_track\" foreign key (\"track_id\") references \"track\" (\"id\") on delete cascade deferrable initially deferred)");
+	}},
+
+	{4, "managed indexes", [](Wt::Dbo::Session& session)
+	{
+		createIndexes(session);
+	}},
+
+	{5, "full text search indexes", [](Wt::Dbo::Session& session)
+	{
+		createFullTextIndexes(session);
+	}},
+
+	{6, "artist, release and genre counters", [](Wt::Dbo::Session& session)
+	{
+		addColumn(session, "artist", "track_count",	"integer not null default 0");
+		addColumn(session, "artist", "release_count",	"integer not null default 0");
+		addColumn(session, "artist", "duration",	"integer default 0");
+		addColumn(session, "release", "track_count",	"integer not null default 0");
+		addColumn(session, "release", "duration",	"integer default 0");
+		addColumn(session, "release", "date",		"text");
+		addColumn(session, "genre", "track_count",	"integer not null default 0");
+		addColumn(session, "genre", "release_count",	"integer not null default 0");
+		addColumn(session, "genre", "duration",		"integer default 0");
+
+		// Counters updates of this version, later ones may rely on newer columns
+		session.execute("UPDATE artist SET"
+				" track_count = (SELECT COUNT(*) FROM track t WHERE t.artist_id = artist.id),"
+				" release_count = (SELECT COUNT(DISTINCT t.release_id) FROM track t WHERE t.artist_id = artist.id),"
+				" duration = (SELECT COALESCE(SUM(t.duration), 0) FROM track t WHERE t.artist_id = artist.id)");
+		session.execute("UPDATE release SET"
+				" track_count = (SELECT COUNT(*) FROM track t WHERE t.release_id = release.id),"
+				" duration = (SELECT COALESCE(SUM(t.duration), 0) FROM track t WHERE t.release_id = release.id),"
+				" date = (SELECT MIN(t.date) FROM track t WHERE t.release_id = release.id)");
+		session.execute("UPDATE genre SET"
+				" track_count = (SELECT COUNT(*) FROM track_genre t_g WHERE t_g.genre_id = genre.id),"
+				" release_count = (SELECT COUNT(DISTINCT t.release_id) FROM track t INNER JOIN track_genre t_g ON t_g.track_id = t.id WHERE t_g.genre_id = genre.id),"
+				" duration = (SELECT COALESCE(SUM(t.duration), 0) FROM track t INNER JOIN track_genre t_g ON t_g.track_id = t.id WHERE t_g.genre_id = genre.id)");
+	}},
+
+	{7, "pending duplicate check", [](Wt::Dbo::Session& session)
+	{
+		addColumn(session, "scan_checkpoint", "duplicate_check_pending",	"boolean not null default 0");
+	}},
+
+	{8, "full text index updates of the changed names only", [](Wt::Dbo::Session& session)
+	{
+		for (const std::string& table : fullTextTables)
+		{
+			if (!hasTable(session, table + "_fts"))
+				continue;
+
+			session.execute("DROP TRIGGER IF EXISTS " + table + "_fts_update");
+			createFullTextUpdateTrigger(session, table);
+		}
+	}},
+
+	{9, "pending counters update", [](Wt::Dbo::Session& session)
+	{
+		addColumn(session, "scan_checkpoint", "counters_update_pending",	"boolean not null default 0");
+	}},
+
+	{10, "trigram full text indexes", [](Wt::Dbo::Session& session)
+	{
+		// Word indexes only matched the beginning of the words
+		std::size_t nbTrigramIndexes = 0;
+		for (const std::string& table : fullTextTables)
+		{
+			const std::string fts = table + "_fts";
+
+			int trigram = session.query<int>("SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' AND name = ? AND instr(sql, 'trigram') > 0").bind(fts);
+			if (trigram > 0)
+			{
+				nbTrigramIndexes++;
+				continue;
+			}
+
+			session.execute("DROP TRIGGER IF EXISTS " + fts + "_insert");
+			session.execute("DROP TRIGGER IF EXISTS " + fts + "_delete");
+			session.execute("DROP TRIGGER IF EXISTS " + fts + "_update");
+			session.execute("DROP TABLE IF EXISTS " + fts);
+		}
+
+		if (nbTrigramIndexes < fullTextTables.size())
+			createFullTextIndexes(session);
+	}},
+};
+
+} // namespace
+
+void
+migrateSchema(Wt::Dbo::Session& session)
+{
+	assert(migrations.back().version == schemaVersion);
+
+	bool created = false;
+	{
+		Wt::Dbo::Transaction transaction(session);
+
+		if (!hasTable(session, "track"))
+		{
+			LMS_LOG(DB, INFO) << "Creating database schema, version " << schemaVersion;
+
+			session.createTables();
+			createIndexes(session);
+			createFullTextIndexes(session);
+			setVersion(session, schemaVersion);
+			created = true;
+		}
+	}
+
+	if (!created)
+	{
+		int version;
+		{
+			Wt::Dbo::Transaction transaction(session);
+			version = getVersion(session);
+		}
+
+		if (version > schemaVersion)
+			throw std::runtime_error("Database schema version " + std::to_string(version) + " is newer than the supported one (" + std::to_string(schemaVersion) + ")");
+
+		for (const Migration& migration : migrations)
+		{
+			if (migration.version <= version)
+				continue;
+
+			LMS_LOG(DB, INFO) << "Migrating database schema to version " << migration.version << ": " << migration.description;
+
+			Wt::Dbo::Transaction transaction(session);
+
+			migration.apply(session);
+			setVersion(session, migration.version);
+		}
+	}
+
+	Wt::Dbo::Transaction transaction(session);
+
+	checkSchema(session);
+
+	// The index may be missing if SQLite lacked FTS5 when it was migrated
+	enableFullTextSearch(hasFullTextSupport(session) && hasTable(session, "artist_fts"));
+}
+
+} // namespace Database
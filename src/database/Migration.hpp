@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DATABASE_MIGRATION_HPP
+#define DATABASE_MIGRATION_HPP
+
+#include <Wt/Dbo/Dbo>
+
+namespace Database {
+
+// Schema version, stored in the database file (SQLite user_version)
+// Bump it along with a new migration step for each schema change
+static const int schemaVersion = 10;
+
+// Brings the database schema up to date, or creates it if the database is empty
+// Each step runs in its own transaction, so that an interrupted migration resumes where it stopped
+// The managed indexes are created by step 4 on existing databases, along with the tables on new ones
+// Then checks that the tables have all the columns of the classes
+// Also enables the full text search if the database has its indexes
+// Throws on failure
+void migrateSchema(Wt::Dbo::Session& session);
+
+} // namespace Database
+
+#endif
@@ -24,6 +24,19 @@
 namespace Database
 {
 
+namespace {
+
+// Counters of each release, using the track_release_idx index
+// The cover is the one of the first track that has one, none for the special release "None"
+const std::string countersUpdate = "UPDATE release SET"
+		" track_count = (SELECT COUNT(*) FROM track t WHERE t.release_id = release.id),"
+		" duration = (SELECT COALESCE(SUM(t.duration), 0) FROM track t WHERE t.release_id = release.id),"
+		" date = (SELECT MIN(t.date) FROM track t WHERE t.release_id = release.id),"
+		" cover_hash = COALESCE((SELECT t.cover_hash FROM track t WHERE t.release_id = release.id AND t.cover_hash <> '' AND release.name <> '<None>'"
+			" ORDER BY t.disc_number, t.track_number, t.id LIMIT 1), '')";
+
+} // namespace
+
 Release::Release(const std::string& name, const std::string& MBID)
 : _name(std::string(name, 0 , _maxNameLength)),
 _MBID(MBID)
@@ -79,38 +92,80 @@ Release::getAll(Wt::Dbo::Session& session, int offset, int size)
 	return std::vector<pointer>(res.begin(), res.end());
 }
 
-std::vector<Release::pointer>
-Release::getAllOrphans(Wt::Dbo::Session& session)
+std::size_t
+Release::removeOrphans(Wt::Dbo::Session& session)
 {
-	Wt::Dbo::collection<Release::pointer> res = session.query< Wt::Dbo::ptr<Release> >("select r from release r LEFT OUTER JOIN Track t ON r.id = t.release_id WHERE t.id IS NULL");
+	const std::string orphanCondition = "NOT EXISTS (SELECT 1 FROM track t WHERE t.release_id = release.id)";
 
-	return std::vector<pointer>(res.begin(), res.end());
+	session.flush();
+
+	int count = session.query<int>("SELECT COUNT(*) FROM release WHERE " + orphanCondition);
+	if (count > 0)
+		session.execute("DELETE FROM release WHERE " + orphanCondition);
+
+	return count;
 }
 
-Wt::Dbo::Query<Release::pointer>
-Release::getQuery(Wt::Dbo::Session& session, SearchFilter filter)
+void
+Release::updateCounters(Wt::Dbo::Session& session, const std::set<id_type>& ids)
 {
-	SqlQuery sqlQuery = generatePartialQuery(filter);
+	if (ids.empty())
+		return;
 
-	Wt::Dbo::Query<pointer> query
-		= session.query<pointer>("SELECT r FROM release r INNER JOIN artist a ON a.id = t.artist_id INNER JOIN track t ON t.release_id = r.id INNER JOIN genre g ON g.id = t_g.genre_id INNER JOIN track_genre t_g ON t_g.track_id = t.id " + sqlQuery.where().get()).groupBy("r.id").orderBy("r.name");
+	session.flush();
+	session.execute(countersUpdate + " WHERE id IN (" + generateIdList(ids) + ")");
+}
 
-	for (const std::string& bindArg : sqlQuery.where().getBindArgs())
+void
+Release::updateAllCounters(Wt::Dbo::Session& session)
+{
+	session.flush();
+	session.execute(countersUpdate);
+}
+
+Wt::Dbo::Query<Release::SortedQueryResult>
+Release::getQuery(Wt::Dbo::Session& session, SearchFilter filter, const SearchCursor& cursor)
+{
+	SearchQuery searchQuery(SearchFilter::Field::Release, filter);
+
+	// Best name matches first, the id makes the order total
+	const std::string rankOrder = searchQuery.rankByName();
+	const std::string sortKeys = (rankOrder.empty() ? "" : rankOrder + ",") + "r.name,r.id";
+
+	// Rows sorted after the cursor
+	if (cursor.last)
+		searchQuery.where("(" + sortKeys + ") > (" + (rankOrder.empty() ? "" : "?,") + "?,?)");
+
+	Wt::Dbo::Query<SortedQueryResult> query
+		= session.query<SortedQueryResult>(searchQuery.get("r, " + (rankOrder.empty() ? "0" : rankOrder) + ", r.name")).orderBy(sortKeys);
+
+	for (const std::string& bindArg : searchQuery.getBindArgs())
 		query.bind(bindArg);
 
+	if (cursor.last)
+	{
+		if (!rankOrder.empty())
+			query.bind(cursor.last->rank);
+		query.bind(cursor.last->releaseName).bind(cursor.last->id);
+	}
+
 	return query;
 }
 
 Wt::Dbo::Query<Release::UIQueryResult>
 Release::getUIQuery(Wt::Dbo::Session& session, SearchFilter filter)
 {
-	SqlQuery sqlQuery = generatePartialQuery(filter);
+	if (filter.isEmpty())
+		return session.query<UIQueryResult>("SELECT r.id, r.name, r.date, r.track_count FROM release r WHERE r.track_count > 0").orderBy("r.name");
+
+	SearchQuery searchQuery(SearchFilter::Field::Track, filter);
+	searchQuery.join(SearchFilter::Field::Release);
 
 	// TODO DATE of RELEASE
 	Wt::Dbo::Query<UIQueryResult> query
-		= session.query<UIQueryResult>("SELECT r.id, r.name, t.date, COUNT(DISTINCT t.id) FROM release r INNER JOIN track t ON t.release_id = r.id INNER JOIN artist a ON a.id = t.artist_id INNER JOIN genre g ON g.id = t_g.genre_id INNER JOIN track_genre t_g ON t_g.track_id = t.id " + sqlQuery.where().get()).groupBy("r.id").orderBy("r.name");
+		= session.query<UIQueryResult>(searchQuery.get("r.id, r.name, t.date, COUNT(t.id)")).groupBy("r.id").orderBy("r.name");
 
-	for (const std::string& bindArg : sqlQuery.where().getBindArgs())
+	for (const std::string& bindArg : searchQuery.getBindArgs())
 		query.bind(bindArg);
 
 	return query;
@@ -119,25 +174,22 @@ Release::getUIQuery(Wt::Dbo::Session& session, SearchFilter filter)
 void
 Release::updateUIQueryModel(Wt::Dbo::Session& session, Wt::Dbo::QueryModel<UIQueryResult>& model, SearchFilter filter, const std::vector<Wt::WString>& columnNames)
 {
-	Wt::Dbo::Query<UIQueryResult> query = getUIQuery(session, filter);
-
-	model.setQuery(query, columnNames.empty() ? true : false);
+	const bool counters = filter.isEmpty();
 
-	// TODO do something better
-	if (columnNames.size() == 3)
-	{
-		model.addColumn( "r.name", columnNames[0]);
-		model.addColumn( "t.date", columnNames[1]);
-		model.addColumn( "COUNT(DISTINCT t.id)", columnNames[2]);
-	}
+	setUIQueryModel(model, getUIQuery(session, filter),
+			{"r.name", counters ? "r.date" : "t.date", counters ? "r.track_count" : "COUNT(t.id)"}, columnNames);
 }
 
 std::vector<Release::pointer>
 Release::getByFilter(Wt::Dbo::Session& session, SearchFilter filter, int offset, int size)
 {
-	Wt::Dbo::collection<pointer> res = getQuery(session, filter).limit(size).offset(offset);
+	Wt::Dbo::collection<SortedQueryResult> rows = getQuery(session, filter).limit(size).offset(offset);
 
-	return std::vector<pointer>(res.begin(), res.end());
+	std::vector<pointer> res;
+	for (const SortedQueryResult& row : rows)
+		res.push_back(row.get<0>());
+
+	return res;
 }
 
 std::vector<Release::pointer>
@@ -156,6 +208,36 @@ Release::getByFilter(Wt::Dbo::Session& session, SearchFilter filter, int offset,
 	return res;
 }
 
+std::vector<Release::pointer>
+Release::getByFilter(Wt::Dbo::Session& session, SearchFilter filter, SearchCursor& cursor, int size, bool& moreResults)
+{
+	Wt::Dbo::collection<SortedQueryResult> collection = getQuery(session, filter, cursor).limit(size + 1);
+	std::vector<SortedQueryResult> rows(collection.begin(), collection.end());
+
+	moreResults = (rows.size() == static_cast<std::size_t>(size) + 1);
+	if (moreResults)
+		rows.pop_back();
+
+	std::vector<pointer> res;
+	for (const SortedQueryResult& row : rows)
+		res.push_back(row.get<0>());
+
+	// The sort keys of the last row come along with it
+	if (!rows.empty())
+	{
+		const SortedQueryResult& row = rows.back();
+
+		SearchCursor::Position position;
+		position.rank = row.get<1>();
+		position.releaseName = row.get<2>();
+		position.id = row.get<0>().id();
+
+		cursor.last = position;
+	}
+
+	return res;
+}
+
 int
 Release::getReleaseYear(bool original) const
 {
@@ -20,6 +20,10 @@
 #ifndef _DB_RELEASE_HPP_
 #define _DB_RELEASE_HPP_
 
+#include <set>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
 #include <Wt/Dbo/Dbo>
 #include <Wt/Dbo/QueryModel>
 
@@ -46,10 +50,13 @@ class Release : public Wt::Dbo::Dbo<Release>
 		static std::vector<pointer>	getByName(Wt::Dbo::Session& session, const std::string& name);
 		static pointer			getById(Wt::Dbo::Session& session, id_type id);
 		static pointer			getNone(Wt::Dbo::Session& session); // Special entry
-		static std::vector<pointer>	getAllOrphans(Wt::Dbo::Session& session);
+		static std::size_t		removeOrphans(Wt::Dbo::Session& session);	// returns the number of removed releases
 		static std::vector<pointer>	getAll(Wt::Dbo::Session& session, int offset, int size);
+		static void			updateCounters(Wt::Dbo::Session& session, const std::set<id_type>& ids);	// recompute the counters and the cover from the tracks
+		static void			updateAllCounters(Wt::Dbo::Session& session);
 		static std::vector<pointer> 	getByFilter(Wt::Dbo::Session& session, SearchFilter filter, int offset = -1, int size = -1);
 		static std::vector<pointer> 	getByFilter(Wt::Dbo::Session& session, SearchFilter filter, int offset, int size, bool& moreExpected);
+		static std::vector<pointer> 	getByFilter(Wt::Dbo::Session& session, SearchFilter filter, SearchCursor& cursor, int size, bool& moreResults);	// page after the cursor, moved to the last row
 
 		// Create
 		static pointer create(Wt::Dbo::Session& session, const std::string& name, const std::string& MBID = "");
@@ -67,8 +74,13 @@ class Release : public Wt::Dbo::Dbo<Release>
 		// Accessosrs
 		std::string	getName() const		{ return _name; }
 		std::string	getMBID() const		{ return _MBID; }
+		const std::string& getCoverHash() const	{ return _coverHash; }
 		bool		isNone(void) const;
-		boost::posix_time::time_duration getDuration(void) const;
+
+		// Counters, maintained by the database updater
+		int		getTrackCount() const	{ return _trackCount; }
+		boost::posix_time::time_duration getDuration(void) const { return _duration; }
+		boost::posix_time::ptime getDate() const	{ return _date; }	// of the earliest dated track
 
 		void setMBID(std::string mbid) { _MBID = mbid; }
 
@@ -77,17 +89,27 @@ class Release : public Wt::Dbo::Dbo<Release>
 			{
 				Wt::Dbo::field(a, _name, "name");
 				Wt::Dbo::field(a, _MBID, "mbid");
+				Wt::Dbo::field(a, _coverHash, "cover_hash");
+				Wt::Dbo::field(a, _trackCount, "track_count");
+				Wt::Dbo::field(a, _duration, "duration");
+				Wt::Dbo::field(a, _date, "date");
 
 				Wt::Dbo::hasMany(a, _tracks, Wt::Dbo::ManyToOne, "release");
 			}
 
 	private:
-		static Wt::Dbo::Query<pointer> getQuery(Wt::Dbo::Session& session, SearchFilter filter);
+		// Rows along with their sort keys (name rank, name), sorted after the cursor if any
+		typedef boost::tuple<pointer, double, std::string> SortedQueryResult;
+		static Wt::Dbo::Query<SortedQueryResult> getQuery(Wt::Dbo::Session& session, SearchFilter filter, const SearchCursor& cursor = SearchCursor());
 
 		static const std::size_t _maxNameLength = 128;
 
 		std::string _name;
 		std::string _MBID;
+		std::string _coverHash;	// taken from the first track with a cover, along with the counters
+		int _trackCount = 0;
+		boost::posix_time::time_duration _duration;
+		boost::posix_time::ptime _date;
 
 		Wt::Dbo::collection< Wt::Dbo::ptr<Track> > _tracks; // Tracks in the release
 };
@@ -17,107 +17,366 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "logger/Logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
 
 #include "SearchFilter.hpp"
 
 namespace Database
 {
 
-static std::ostream& operator<<(std::ostream& ost, const std::vector< Wt::Dbo::dbo_default_traits::IdType>& ids)
+namespace {
+
+std::atomic<bool> fullTextSearchEnabled {false};
+
+// Full text index and matched id column of each field
+const char*
+getFullTextTable(SearchFilter::Field field)
+{
+	switch (field)
+	{
+		case SearchFilter::Field::Artist:	return "artist_fts";
+		case SearchFilter::Field::Release:	return "release_fts";
+		case SearchFilter::Field::Genre:	return "genre_fts";
+		case SearchFilter::Field::Track:	return "track_fts";
+	}
+	return "";
+}
+
+const char*
+getIdColumn(SearchFilter::Field field)
 {
-	const char *sep = "";
+	switch (field)
+	{
+		case SearchFilter::Field::Artist:	return "a.id";
+		case SearchFilter::Field::Release:	return "r.id";
+		case SearchFilter::Field::Genre:	return "g.id";
+		case SearchFilter::Field::Track:	return "t.id";
+	}
+	return "";
+}
 
-	for (auto id : ids)
+const char*
+getNameColumn(SearchFilter::Field field)
+{
+	switch (field)
 	{
-		ost << sep << std::to_string(id);
-		sep = ",";
+		case SearchFilter::Field::Artist:	return "a.name";
+		case SearchFilter::Field::Release:	return "r.name";
+		case SearchFilter::Field::Genre:	return "g.name";
+		case SearchFilter::Field::Track:	return "t.name";
 	}
+	return "";
+}
+
+// Column of the track table holding the id of each field
+const char*
+getTrackIdColumn(SearchFilter::Field field)
+{
+	switch (field)
+	{
+		case SearchFilter::Field::Artist:	return "t.artist_id";
+		case SearchFilter::Field::Release:	return "t.release_id";
+		case SearchFilter::Field::Genre:	return "t_g.genre_id";
+		case SearchFilter::Field::Track:	return "t.id";
+	}
+	return "";
+}
+
+// The trigram index cannot match keywords shorter than 3 characters, they are matched with LIKE
+bool
+isIndexable(const std::string& keyword)
+{
+	std::size_t nbChars = 0;
+	for (char c : keyword)
+	{
+		// UTF-8 continuation bytes are not counted
+		if ((static_cast<unsigned char>(c) & 0xC0) != 0x80)
+			nbChars++;
+	}
+	return nbChars >= 3;
+}
+
+// Substring query on a quoted string, so that the keyword cannot be taken as FTS5 syntax
+std::string
+getSubstringQuery(const std::string& keyword)
+{
+	std::string res = "\"";
+	for (char c : keyword)
+	{
+		if (c == '"')
+			res += "\"\"";
+		else
+			res += c;
+	}
+	res += "\"";
+
+	return res;
+}
+
+} // namespace
 
-	return ost;
+void
+enableFullTextSearch(bool enable)
+{
+	fullTextSearchEnabled = enable;
 }
 
-SqlQuery generatePartialQuery(SearchFilter& filter)
+SearchQuery::SearchQuery(SearchFilter::Field table, const SearchFilter& filter)
+: _table(table)
 {
-	SqlQuery sqlQuery;
+	const bool fullText = fullTextSearchEnabled;
 
-	// Process name like parameters
-	for (auto nameLikeMatches : filter.nameLikeMatch)
+	for (const auto& nameLikeMatches : filter.nameLikeMatch)
 	{
-		WhereClause likeWhereClause;
+		Term term;
+		for (const auto& nameLikeMatch : nameLikeMatches)
+		{
+			for (const std::string& name : nameLikeMatch.second)
+				term.push_back(Condition {nameLikeMatch.first, true, fullText && isIndexable(name), name, {}});
+		}
+
+		if (!term.empty())
+			_terms.push_back(term);
+	}
 
-		for (auto nameLikeMatch : nameLikeMatches)
+	for (const auto& idMatch : filter.idMatch)
+		_terms.push_back(Term {Condition {idMatch.first, false, false, "", idMatch.second}});
+}
+
+SearchQuery&
+SearchQuery::join(SearchFilter::Field field)
+{
+	assert(_table == SearchFilter::Field::Track);
+
+	_joins.insert(field);
+	return *this;
+}
+
+SearchQuery&
+SearchQuery::where(const std::string& condition)
+{
+	_conditions.push_back(condition);
+	return *this;
+}
+
+std::string
+SearchQuery::rankByName()
+{
+	// Same conditions as the filter, restricted to the names of the table
+	_rankQuery.clear();
+	for (const Term& term : _terms)
+	{
+		std::string orQuery;
+		for (const Condition& condition : term)
 		{
-			switch (nameLikeMatch.first)
+			if (!condition.fullText || condition.field != _table)
+				continue;
+
+			if (!orQuery.empty())
+				orQuery += " OR ";
+			orQuery += getSubstringQuery(condition.name);
+		}
+
+		if (orQuery.empty())
+			continue;
+
+		if (!_rankQuery.empty())
+			_rankQuery += " AND ";
+		_rankQuery += "(" + orQuery + ")";
+	}
+
+	// Rows matched by other fields come last
+	return _rankQuery.empty() ? "" : "COALESCE(fts.rank, 0)";
+}
+
+std::string
+SearchQuery::get(const std::string& columns) const
+{
+	std::string from;
+	switch (_table)
+	{
+		case SearchFilter::Field::Artist:	from = "artist a"; break;
+		case SearchFilter::Field::Release:	from = "release r"; break;
+		case SearchFilter::Field::Genre:	from = "genre g"; break;
+		case SearchFilter::Field::Track:
 			{
-				case SearchFilter::Field::Artist:
-					for (const std::string& name : nameLikeMatch.second)
-						likeWhereClause.Or( WhereClause("a.name LIKE ?") ).bind("%%" + name + "%%");
-					break;
-
-				case SearchFilter::Field::Release:
-					for (const std::string& name : nameLikeMatch.second)
-						likeWhereClause.Or( WhereClause("r.name LIKE ?") ).bind("%%" + name + "%%");
-					break;
-
-				case SearchFilter::Field::Genre:
-					for (const std::string& name : nameLikeMatch.second)
-						likeWhereClause.Or( WhereClause("g.name LIKE ?") ).bind("%%" + name + "%%");
-					break;
-
-				case SearchFilter::Field::Track:
-					for (const std::string& name : nameLikeMatch.second)
-						likeWhereClause.Or( WhereClause("t.name LIKE ?") ).bind("%%" + name + "%%");
-					break;
+				std::set<SearchFilter::Field> tables = getNeededTables(_terms);
+				tables.insert(_joins.begin(), _joins.end());
+
+				from = "track t" + generateJoins(tables);
 			}
+			break;
+	}
+
+	// Ranks of the matching names, computed once
+	if (!_rankQuery.empty())
+	{
+		const std::string table = getFullTextTable(_table);
+		from += " LEFT JOIN (SELECT rowid AS id, rank FROM " + table + " WHERE " + table + " MATCH ?) fts ON fts.id = " + getIdColumn(_table);
+	}
+
+	const std::string where = generateWhereClause().get();
+
+	return "SELECT " + columns + " FROM " + from + (where.empty() ? "" : " " + where);
+}
+
+std::list<std::string>
+SearchQuery::getBindArgs(void) const
+{
+	std::list<std::string> bindArgs = generateWhereClause().getBindArgs();
+
+	if (!_rankQuery.empty())
+		bindArgs.push_front(_rankQuery);
+
+	return bindArgs;
+}
+
+// Tables to join to the track table to check the terms
+// Ids and full text matches only need the id columns of the track table
+std::set<SearchFilter::Field>
+SearchQuery::getNeededTables(const std::vector<Term>& terms) const
+{
+	std::set<SearchFilter::Field> tables;
+
+	for (const Term& term : terms)
+	{
+		for (const Condition& condition : term)
+		{
+			if (condition.byName && !condition.fullText && condition.field != SearchFilter::Field::Genre)
+				tables.insert(condition.field);
+		}
+	}
+
+	return tables;
+}
+
+std::string
+SearchQuery::generateJoins(const std::set<SearchFilter::Field>& tables) const
+{
+	std::string joins;
+
+	if (tables.count(SearchFilter::Field::Artist))
+		joins += " INNER JOIN artist a ON a.id = t.artist_id";
+	if (tables.count(SearchFilter::Field::Release))
+		joins += " INNER JOIN release r ON r.id = t.release_id";
+	if (tables.count(SearchFilter::Field::Genre))
+		joins += " INNER JOIN track_genre t_g ON t_g.track_id = t.id INNER JOIN genre g ON g.id = t_g.genre_id";
+
+	return joins;
+}
+
+// tables: the tables that can be referenced, the track table is always there
+WhereClause
+SearchQuery::generateTermClause(const Term& term, const std::set<SearchFilter::Field>& tables) const
+{
+	WhereClause termClause;
+
+	for (const Condition& condition : term)
+	{
+		const bool joined = (tables.count(condition.field) > 0);
+		const std::string idColumn = joined ? getIdColumn(condition.field) : getTrackIdColumn(condition.field);
+
+		std::string clause;
+		std::string bindArg;
+		if (!condition.byName)
+			clause = idColumn + " IN (" + generateIdList(condition.ids) + ")";
+		else if (condition.fullText)
+		{
+			const std::string table = getFullTextTable(condition.field);
+			clause = idColumn + " IN (SELECT rowid FROM " + table + " WHERE " + table + " MATCH ?)";
+			bindArg = getSubstringQuery(condition.name);
 		}
-		sqlQuery.where().And( likeWhereClause );
+		else
+		{
+			clause = std::string(getNameColumn(condition.field)) + " LIKE ?";
+			bindArg = "%%" + condition.name + "%%";
+		}
+
+		// Genres of the track
+		if (condition.field == SearchFilter::Field::Genre && !joined)
+			clause = std::string("EXISTS (SELECT 1 FROM track_genre t_g")
+				+ (condition.byName && !condition.fullText ? " INNER JOIN genre g ON g.id = t_g.genre_id" : "")
+				+ " WHERE t_g.track_id = t.id AND " + clause + ")";
+
+		WhereClause conditionClause(clause);
+		if (condition.byName)
+			conditionClause.bind(bindArg);
+
+		termClause.Or(conditionClause);
 	}
 
-	// Process id exact match parameters
-	// Id list may be long, we do not bind the parameters
-	// Safe since we already known these are just ints
-	for (auto idMatch : filter.idMatch)
+	return termClause;
+}
+
+WhereClause
+SearchQuery::generateWhereClause() const
+{
+	WhereClause where;
+
+	if (_table == SearchFilter::Field::Track)
 	{
-		WhereClause idWhereClause;
+		std::set<SearchFilter::Field> tables = getNeededTables(_terms);
+		tables.insert(_joins.begin(), _joins.end());
+		tables.insert(SearchFilter::Field::Track);
 
-		switch (idMatch.first)
+		for (const Term& term : _terms)
+			where.And(generateTermClause(term, tables));
+	}
+	else
+	{
+		// Terms on the table itself are checked directly, the other ones on its tracks
+		std::vector<Term> trackTerms;
+		for (const Term& term : _terms)
+		{
+			if (std::all_of(term.begin(), term.end(), [&](const Condition& condition) { return condition.field == _table; }))
+				where.And(generateTermClause(term, {_table}));
+			else
+				trackTerms.push_back(term);
+		}
+
+		std::set<SearchFilter::Field> joins = getNeededTables(trackTerms);
+		joins.erase(_table);
+
+		std::set<SearchFilter::Field> tables = joins;
+		tables.insert(_table);
+		tables.insert(SearchFilter::Field::Track);
+
+		std::string from;
+		WhereClause trackWhere;
+		switch (_table)
 		{
 			case SearchFilter::Field::Artist:
-				{
-					std::ostringstream oss;
-					oss << "a.id IN (" << idMatch.second << ")";
-					idWhereClause.Or(oss.str());
-				}
+				from = "track t";
+				trackWhere = WhereClause("t.artist_id = a.id");
 				break;
 			case SearchFilter::Field::Release:
-				{
-					std::ostringstream oss;
-					oss << "r.id IN (" << idMatch.second << ")";
-					idWhereClause.Or(oss.str());
-				}
+				from = "track t";
+				trackWhere = WhereClause("t.release_id = r.id");
 				break;
 			case SearchFilter::Field::Genre:
-				{
-					std::ostringstream oss;
-					oss << "g.id IN (" << idMatch.second << ")";
-					idWhereClause.Or(oss.str());
-				}
+				from = trackTerms.empty() ? "track_genre t_g" : "track_genre t_g INNER JOIN track t ON t.id = t_g.track_id";
+				trackWhere = WhereClause("t_g.genre_id = g.id");
 				break;
 			case SearchFilter::Field::Track:
-				{
-					std::ostringstream oss;
-					oss << "t.id IN (" << idMatch.second << ")";
-					idWhereClause.Or(oss.str());
-				}
 				break;
 		}
 
-		sqlQuery.where().And( idWhereClause );
+		for (const Term& term : trackTerms)
+			trackWhere.And(generateTermClause(term, tables));
+
+		WhereClause existsClause("EXISTS (SELECT 1 FROM " + from + generateJoins(joins) + " " + trackWhere.get() + ")");
+		for (const std::string& bindArg : trackWhere.getBindArgs())
+			existsClause.bind(bindArg);
+
+		where.And(existsClause);
 	}
 
-	return sqlQuery;
+	for (const std::string& condition : _conditions)
+		where.And(WhereClause(condition));
+
+	return where;
 }
 
 } // namespace Database
-
@@ -20,11 +20,16 @@
 #ifndef _DB_SEARCH_FILTER_HPP_
 #define _DB_SEARCH_FILTER_HPP_
 
+#include <list>
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
-#include <map>
+
+#include <boost/optional.hpp>
 
 #include <Wt/Dbo/Dbo>
+#include <Wt/Dbo/QueryModel>
 
 #include "SqlQuery.hpp"
 
@@ -81,9 +86,25 @@ class SearchFilter
 			return NameLikeMatch(nameLikeMatch);
 		}
 
+		// No condition at all
+		bool isEmpty() const
+		{
+			for (const auto& nameLikeMatches : nameLikeMatch)
+			{
+				for (const auto& names : nameLikeMatches)
+				{
+					if (!names.second.empty())
+						return false;
+				}
+			}
+
+			return idMatch.empty();
+		}
+
 		// The filter is a AND of the following conditions:
 
 		// ((Field1.name LIKE STR1-1 OR Field1.name LIKE STR1-2 ...) OR (Field2.name LIKE STR2-1 OR Field2.name LIKE STR2-2 ...) ...
+		// If the full text index is available, keywords of at least 3 characters are matched through it instead
 		NameLikeMatchType	nameLikeMatch;
 
 		// (Field1.id IN (ID1-1,ID1-2 ... ) AND (Field2.id IN (ID2-1,ID2-2 ... ) ...
@@ -95,7 +116,110 @@ class SearchFilter
 		SearchFilter(const IdMatchType& _idMatch) : idMatch(_idMatch) {}
 };
 
-SqlQuery generatePartialQuery(SearchFilter& filter);
+// Continuation token of the paginated searches
+// Holds the sort keys of the last returned row: the next page starts right after them,
+// even if this row has been removed or renamed meanwhile
+struct SearchCursor
+{
+	struct Position
+	{
+		double		rank = 0;		// only if the names are ranked
+		std::string	artistName;		// artists and tracks
+		std::string	date;			// tracks
+		std::string	releaseName;		// releases and tracks
+		int		discNumber = 0;		// tracks
+		int		trackNumber = 0;	// tracks
+		Wt::Dbo::dbo_default_traits::IdType	id = 0;
+	};
+
+	boost::optional<Position> last;	// none for the first page
+};
+
+// Query of the rows of a table matching a search filter
+// Artists, releases and genres match if at least one of their tracks matches
+// Only the tables needed by the conditions are joined to the track table:
+// ids are checked on the track columns and genres through EXISTS subqueries,
+// so that the rows are not multiplied and need no grouping
+class SearchQuery
+{
+	public:
+
+		SearchQuery(SearchFilter::Field table, const SearchFilter& filter);
+
+		// Joins a table to the track table, for the selected columns, the grouping or the order
+		// Only for the track table
+		SearchQuery& join(SearchFilter::Field field);
+
+		// Extra condition, its bind args come after the ones of the filter
+		SearchQuery& where(const std::string& condition);
+
+		// Ranks the name matches of the table, through a single join on the full text index
+		// Returns the expression to sort on, best first, or an empty string if there is nothing to rank
+		std::string rankByName();
+
+		// "SELECT columns FROM ... WHERE ..."
+		std::string get(const std::string& columns) const;
+		std::list<std::string> getBindArgs(void) const;
+
+	private:
+
+		// Name or id match on a field
+		struct Condition
+		{
+			SearchFilter::Field	field;
+			bool			byName;
+			bool			fullText;	// name matched through the full text index
+			std::string		name;
+			std::vector<Wt::Dbo::dbo_default_traits::IdType>	ids;
+		};
+		typedef std::vector<Condition> Term;	// OR of the conditions
+
+		WhereClause generateWhereClause() const;
+		WhereClause generateTermClause(const Term& term, const std::set<SearchFilter::Field>& tables) const;
+		std::string generateJoins(const std::set<SearchFilter::Field>& tables) const;
+		std::set<SearchFilter::Field> getNeededTables(const std::vector<Term>& terms) const;
+
+		SearchFilter::Field		_table;
+		std::vector<Term>		_terms;	// AND of the terms
+		std::set<SearchFilter::Field>	_joins;
+		std::vector<std::string>	_conditions;
+		std::string			_rankQuery;	// full text query of the ranked names
+};
+
+// Sets the query of a UI model, with a column for each field
+// Without any filter, the UI queries read the counters directly instead of aggregating the tracks:
+// the current columns and their sort order are only kept if their fields did not change
+template <typename Result>
+void
+setUIQueryModel(Wt::Dbo::QueryModel<Result>& model, Wt::Dbo::Query<Result> query, const std::vector<std::string>& fields, std::vector<Wt::WString> columnNames)
+{
+	if (columnNames.empty())
+	{
+		bool sameFields = (static_cast<std::size_t>(model.columnCount()) == fields.size());
+		for (std::size_t column = 0; sameFields && column < fields.size(); ++column)
+			sameFields = (model.fieldName(column) == fields[column]);
+
+		if (sameFields || static_cast<std::size_t>(model.columnCount()) != fields.size())
+		{
+			model.setQuery(query, true);
+			return;
+		}
+
+		for (int column = 0; column < model.columnCount(); ++column)
+			columnNames.push_back(Wt::asString(model.headerData(column)));
+	}
+
+	model.setQuery(query, false);
+
+	if (columnNames.size() == fields.size())
+	{
+		for (std::size_t column = 0; column < fields.size(); ++column)
+			model.addColumn(fields[column], columnNames[column]);
+	}
+}
+
+// Set once the schema is up to date, depending on the availability of the FTS5 index
+void enableFullTextSearch(bool enable);
 
 } // namespace Database
 
@@ -23,6 +23,23 @@
 #include <list>
 #include <string>
 
+// Comma separated ids, to be inlined in a query
+// Id lists may be long, these are just ints: no need to bind them
+template <typename Ids>
+std::string
+generateIdList(const Ids& ids)
+{
+	std::string res;
+	const char* sep = "";
+
+	for (auto id : ids)
+	{
+		res += sep + std::to_string(id);
+		sep = ",";
+	}
+
+	return res;
+}
 
 class WhereClause
 {
@@ -47,92 +64,5 @@ class WhereClause
 
 };
 
-class InnerJoinClause
-{
-	public:
-
-		InnerJoinClause() {}
-		InnerJoinClause(const std::string& clause);
-
-		InnerJoinClause&	And(const InnerJoinClause& clause);
-		std::string get() const	{ return _clause;}
-
-	private:
-
-		std::string _clause;
-};
-
-class GroupByStatement
-{
-	public:
-		GroupByStatement() {}
-		GroupByStatement(const std::string& statement) { _statement = statement; }
-
-		GroupByStatement& And(const GroupByStatement& statement);
-
-		std::string get() const      {return _statement;}
-
-	private:
-		std::string _statement;		// SELECT statement
-
-};
-
-class SelectStatement
-{
-	public:
-		SelectStatement() {};
-		SelectStatement(const std::string& item);
-
-		SelectStatement& And(const std::string& item);
-
-		std::string get() const;
-
-	private:
-
-		std::list<std::string>	_statement;
-};
-
-class FromClause
-{
-	public:
-
-		FromClause() {}
-		FromClause(const std::string& clause);
-
-		FromClause& And(const FromClause& clause);
-
-		std::string get() const;
-
-	private:
-
-		std::list<std::string>	_clause;
-
-};
-
-class SqlQuery
-{
-	public:
-
-		SelectStatement&	select(void)		{ return _selectStatement;}
-		SelectStatement&	select(const std::string& statement)		{ _selectStatement = SelectStatement(statement); return _selectStatement; }
-		FromClause&		from(void)		{ return _fromClause; }
-		FromClause&		from(const std::string& clause)			{ _whereClause = WhereClause(clause); return _fromClause; }
-		InnerJoinClause&	innerJoin(void)		{ return _innerJoinClause; }
-		WhereClause&		where(void)		{ return _whereClause; }
-		const WhereClause&	where(void) const	{ return _whereClause; }
-		GroupByStatement&	groupBy(void) 		{ return _groupByStatement; }
-		const GroupByStatement&	groupBy(void) const	{ return _groupByStatement; }
-
-		std::string get(void) const;
-
-	private:
-
-		SelectStatement		_selectStatement;	// SELECT statement
-		InnerJoinClause		_innerJoinClause;	// INNER JOIN
-		FromClause		_fromClause;		// FROM tables
-		WhereClause		_whereClause;		// WHERE clause
-		GroupByStatement	_groupByStatement;	// GROUP BY statement
-};
-
 #endif
 
@@ -27,6 +27,16 @@
 
 namespace Database {
 
+namespace {
+
+// Counters of each genre, using the track_genre_genre_idx index
+const std::string countersUpdate = "UPDATE genre SET"
+		" track_count = (SELECT COUNT(*) FROM track_genre t_g WHERE t_g.genre_id = genre.id),"
+		" release_count = (SELECT COUNT(DISTINCT t.release_id) FROM track t INNER JOIN track_genre t_g ON t_g.track_id = t.id WHERE t_g.genre_id = genre.id),"
+		" duration = (SELECT COALESCE(SUM(t.duration), 0) FROM track t INNER JOIN track_genre t_g ON t_g.track_id = t.id WHERE t_g.genre_id = genre.id)";
+
+} // namespace
+
 Track::Track(const boost::filesystem::path& p)
 :
 _trackNumber(0),
@@ -34,6 +44,8 @@ _totalTrackNumber(0),
 _discNumber(0),
 _totalDiscNumber(0),
 _filePath( p.string() ),
+_fileChecksumType(0),
+_fileSize(0),
 _coverType(CoverType::None)
 {
 }
@@ -79,6 +91,15 @@ Track::create(Wt::Dbo::Session& session, const boost::filesystem::path& p)
 	return session.add(new Track(p) );
 }
 
+Wt::Dbo::collection<Track::FileInfoQueryResult>
+Track::getFileInfosUnder(Wt::Dbo::Session& session, const boost::filesystem::path& p)
+{
+	// Paths below 'p/' sort between 'p/' and 'p0', since '0' follows '/'
+	return session.query<FileInfoQueryResult>("SELECT id, file_path, file_last_write, file_size FROM track")
+		.where("file_path = ? OR (file_path >= ? AND file_path < ?)")
+		.bind(p.string()).bind(p.string() + "/").bind(p.string() + "0");
+}
+
 std::vector<boost::filesystem::path>
 Track::getAllPaths(Wt::Dbo::Session& session)
 {
@@ -87,20 +108,50 @@ Track::getAllPaths(Wt::Dbo::Session& session)
 	return std::vector<boost::filesystem::path>(res.begin(), res.end());
 }
 
+std::vector<std::string>
+Track::getAllCoverHashes(Wt::Dbo::Session& session)
+{
+	Wt::Dbo::Transaction transaction(session);
+	Wt::Dbo::collection<std::string> res = session.query<std::string>("SELECT DISTINCT cover_hash FROM track WHERE cover_hash <> ''");
+	return std::vector<std::string>(res.begin(), res.end());
+}
+
+Wt::Dbo::collection<Track::FileInfoQueryResult>
+Track::getAllFileInfos(Wt::Dbo::Session& session)
+{
+	// Rows are fetched while iterating, there is no need to hold the whole result at once
+	return session.query<FileInfoQueryResult>("SELECT id, file_path, file_last_write, file_size FROM track");
+}
+
 std::vector<Track::pointer>
-Track::getMBIDDuplicates(Wt::Dbo::Session& session)
+Track::getAllByMBID(Wt::Dbo::Session& session, const std::string& mbid)
 {
-	Wt::Dbo::collection<pointer> res = session.query<pointer>( "SELECT track FROM track WHERE mbid in (SELECT mbid FROM track WHERE mbid <> '' GROUP BY mbid HAVING COUNT (*) > 1)").orderBy("track.release_id,track.disc_number,track.track_number,track.mbid");
+	Wt::Dbo::collection<pointer> res = session.find<Track>().where("mbid = ?").bind(mbid);
 	return std::vector<pointer>(res.begin(), res.end());
 }
 
 std::vector<Track::pointer>
-Track::getChecksumDuplicates(Wt::Dbo::Session& session)
+Track::getAllByChecksum(Wt::Dbo::Session& session, int checksumType, const std::vector<unsigned char>& checksum)
 {
-	Wt::Dbo::collection<pointer> res = session.query<pointer>( "SELECT track FROM track WHERE checksum in (SELECT checksum FROM track WHERE Length(checksum) > 0 GROUP BY checksum HAVING COUNT(*) > 1)").orderBy("track.release_id,track.disc_number,track.track_number,track.checksum");
+	// Checksums computed using different algorithms cannot be compared
+	Wt::Dbo::collection<pointer> res = session.find<Track>().where("checksum = ? AND checksum_type = ?").bind(checksum).bind(checksumType);
 	return std::vector<pointer>(res.begin(), res.end());
 }
 
+std::vector<std::string>
+Track::getDuplicatedMBIDs(Wt::Dbo::Session& session)
+{
+	Wt::Dbo::collection<std::string> res = session.query<std::string>("SELECT mbid FROM track WHERE mbid <> '' GROUP BY mbid HAVING COUNT(*) > 1");
+	return std::vector<std::string>(res.begin(), res.end());
+}
+
+std::vector<Track::ChecksumQueryResult>
+Track::getDuplicatedChecksums(Wt::Dbo::Session& session)
+{
+	Wt::Dbo::collection<ChecksumQueryResult> res = session.query<ChecksumQueryResult>("SELECT checksum_type, checksum FROM track WHERE Length(checksum) > 0 GROUP BY checksum, checksum_type HAVING COUNT(*) > 1");
+	return std::vector<ChecksumQueryResult>(res.begin(), res.end());
+}
+
 std::vector< Genre::pointer >
 Track::getGenres(void) const
 {
@@ -109,29 +160,48 @@ Track::getGenres(void) const
 	return genres;
 }
 
-Wt::Dbo::Query< Track::pointer >
-Track::getQuery(Wt::Dbo::Session& session, SearchFilter filter)
+Wt::Dbo::Query<Track::SortedQueryResult>
+Track::getQuery(Wt::Dbo::Session& session, SearchFilter filter, const SearchCursor& cursor)
 {
-	SqlQuery sqlQuery = generatePartialQuery(filter);
+	// Artist and release are needed by the order
+	SearchQuery searchQuery(SearchFilter::Field::Track, filter);
+	searchQuery.join(SearchFilter::Field::Artist).join(SearchFilter::Field::Release);
+
+	// Best name matches first, the id makes the order total
+	const std::string rankOrder = searchQuery.rankByName();
+	const std::string sortKeys = (rankOrder.empty() ? "" : rankOrder + ",") + "a.name,COALESCE(t.date, ''),r.name,t.disc_number,t.track_number,t.id";
+
+	// Rows sorted after the cursor
+	if (cursor.last)
+		searchQuery.where("(" + sortKeys + ") > (" + (rankOrder.empty() ? "" : "?,") + "?,?,?,?,?,?)");
 
-	Wt::Dbo::Query<pointer> query
-		= session.query<pointer>( "SELECT t FROM track t INNER JOIN artist a ON t.artist_id = a.id INNER JOIN genre g ON g.id = t_g.genre_id INNER JOIN track_genre t_g ON t_g.track_id = t.id INNER JOIN release r ON r.id = t.release_id " + sqlQuery.where().get()).groupBy("t.id").orderBy("a.name,t.date,r.name,t.disc_number,t.track_number");
+	Wt::Dbo::Query<SortedQueryResult> query
+		= session.query<SortedQueryResult>(searchQuery.get("t, " + (rankOrder.empty() ? "0" : rankOrder) + ", a.name, COALESCE(t.date, ''), r.name, t.disc_number, t.track_number")).orderBy(sortKeys);
 
-	for (const std::string& bindArg : sqlQuery.where().getBindArgs())
+	for (const std::string& bindArg : searchQuery.getBindArgs())
 		query.bind(bindArg);
 
+	if (cursor.last)
+	{
+		if (!rankOrder.empty())
+			query.bind(cursor.last->rank);
+		query.bind(cursor.last->artistName).bind(cursor.last->date).bind(cursor.last->releaseName)
+			.bind(cursor.last->discNumber).bind(cursor.last->trackNumber).bind(cursor.last->id);
+	}
+
 	return query;
 }
 
 Wt::Dbo::Query< Track::UIQueryResult >
 Track::getUIQuery(Wt::Dbo::Session& session, SearchFilter filter)
 {
-	SqlQuery sqlQuery = generatePartialQuery(filter);
+	SearchQuery searchQuery(SearchFilter::Field::Track, filter);
+	searchQuery.join(SearchFilter::Field::Artist).join(SearchFilter::Field::Release);
 
 	Wt::Dbo::Query<UIQueryResult> query
-		= session.query<UIQueryResult>( "SELECT t.id, a.name, r.name, t.disc_number, t.track_number, t.name, t.duration, t.date, t.original_date, t.genre_list FROM track t INNER JOIN artist a ON t.artist_id = a.id INNER JOIN genre g ON g.id = t_g.genre_id INNER JOIN track_genre t_g ON t_g.track_id = t.id INNER JOIN release r ON r.id = t.release_id " + sqlQuery.where().get()).groupBy("t.id").orderBy("a.name,t.date,r.name,t.disc_number,t.track_number");
+		= session.query<UIQueryResult>(searchQuery.get("t.id, a.name, r.name, t.disc_number, t.track_number, t.name, t.duration, t.date, t.original_date, t.genre_list")).orderBy("a.name,t.date,r.name,t.disc_number,t.track_number");
 
-	for (const std::string& bindArg : sqlQuery.where().getBindArgs())
+	for (const std::string& bindArg : searchQuery.getBindArgs())
 		query.bind(bindArg);
 
 	return query;
@@ -140,11 +210,12 @@ Track::getUIQuery(Wt::Dbo::Session& session, SearchFilter filter)
 Track::StatsQueryResult
 Track::getStats(Wt::Dbo::Session& session, SearchFilter filter)
 {
-	SqlQuery sqlQuery = generatePartialQuery(filter);
+	// Each track appears once, no need to group
+	SearchQuery searchQuery(SearchFilter::Field::Track, filter);
 
-	Wt::Dbo::Query<StatsQueryResult> query = session.query<StatsQueryResult>( "SELECT COUNT(\"id\"), SUM(\"dur\") FROM  (SELECT t.id as \"id\", t.duration as \"dur\" FROM track t INNER JOIN artist a ON t.artist_id = a.id INNER JOIN genre g ON g.id = t_g.genre_id INNER JOIN track_genre t_g ON t_g.track_id = t.id INNER JOIN release r ON r.id = t.release_id " + sqlQuery.where().get() + " GROUP BY t.id)");
+	Wt::Dbo::Query<StatsQueryResult> query = session.query<StatsQueryResult>(searchQuery.get("COUNT(t.id), SUM(t.duration)"));
 
-	for (const std::string& bindArg : sqlQuery.where().getBindArgs())
+	for (const std::string& bindArg : searchQuery.getBindArgs())
 		query.bind(bindArg);
 
 	return query;
@@ -154,9 +225,13 @@ Track::getStats(Wt::Dbo::Session& session, SearchFilter filter)
 std::vector<Track::pointer>
 Track::getByFilter(Wt::Dbo::Session& session, SearchFilter filter, int offset, int size)
 {
-	Wt::Dbo::collection<pointer> res = getQuery(session, filter).limit(size).offset(offset);
+	Wt::Dbo::collection<SortedQueryResult> rows = getQuery(session, filter).limit(size).offset(offset);
 
-	return std::vector<pointer>(res.begin(), res.end());
+	std::vector<pointer> res;
+	for (const SortedQueryResult& row : rows)
+		res.push_back(row.get<0>());
+
+	return res;
 }
 
 std::vector<Track::pointer>
@@ -175,6 +250,40 @@ Track::getByFilter(Wt::Dbo::Session& session, SearchFilter filter, int offset, i
 	return res;
 }
 
+std::vector<Track::pointer>
+Track::getByFilter(Wt::Dbo::Session& session, SearchFilter filter, SearchCursor& cursor, int size, bool& moreResults)
+{
+	Wt::Dbo::collection<SortedQueryResult> collection = getQuery(session, filter, cursor).limit(size + 1);
+	std::vector<SortedQueryResult> rows(collection.begin(), collection.end());
+
+	moreResults = (rows.size() == static_cast<std::size_t>(size) + 1);
+	if (moreResults)
+		rows.pop_back();
+
+	std::vector<pointer> res;
+	for (const SortedQueryResult& row : rows)
+		res.push_back(row.get<0>());
+
+	// The sort keys of the last row come along with it
+	if (!rows.empty())
+	{
+		const SortedQueryResult& row = rows.back();
+
+		SearchCursor::Position position;
+		position.rank = row.get<1>();
+		position.artistName = row.get<2>();
+		position.date = row.get<3>();
+		position.releaseName = row.get<4>();
+		position.discNumber = row.get<5>();
+		position.trackNumber = row.get<6>();
+		position.id = row.get<0>().id();
+
+		cursor.last = position;
+	}
+
+	return res;
+}
+
 void
 Track::updateUIQueryModel(Wt::Dbo::Session& session, Wt::Dbo::QueryModel< UIQueryResult >& model, SearchFilter filter, const std::vector<Wt::WString>& columnNames)
 {
@@ -241,15 +350,59 @@ Genre::create(Wt::Dbo::Session& session, const std::string& name)
 	return session.add(new Genre(name));
 }
 
+std::size_t
+Genre::removeOrphans(Wt::Dbo::Session& session)
+{
+	const std::string orphanCondition = "NOT EXISTS (SELECT 1 FROM track_genre t_g WHERE t_g.genre_id = genre.id)";
+
+	session.flush();
+
+	int count = session.query<int>("SELECT COUNT(*) FROM genre WHERE " + orphanCondition);
+	if (count > 0)
+		session.execute("DELETE FROM genre WHERE " + orphanCondition);
+
+	return count;
+}
+
+std::size_t
+Genre::removeDanglingTrackLinks(Wt::Dbo::Session& session)
+{
+	const std::string danglingCondition = "track_id NOT IN (SELECT id FROM track) OR genre_id NOT IN (SELECT id FROM genre)";
+
+	session.flush();
+
+	int count = session.query<int>("SELECT COUNT(*) FROM track_genre WHERE " + danglingCondition);
+	if (count > 0)
+		session.execute("DELETE FROM track_genre WHERE " + danglingCondition);
+
+	return count;
+}
+
+void
+Genre::updateCounters(Wt::Dbo::Session& session, const std::set<id_type>& ids)
+{
+	if (ids.empty())
+		return;
+
+	session.flush();
+	session.execute(countersUpdate + " WHERE id IN (" + generateIdList(ids) + ")");
+}
+
+void
+Genre::updateAllCounters(Wt::Dbo::Session& session)
+{
+	session.flush();
+	session.execute(countersUpdate);
+}
+
 Wt::Dbo::Query<Genre::pointer>
 Genre::getQuery(Wt::Dbo::Session& session, SearchFilter filter)
 {
-	SqlQuery sqlQuery = generatePartialQuery(filter);
+	SearchQuery searchQuery(SearchFilter::Field::Genre, filter);
 
-	Wt::Dbo::Query<pointer> query
-		= session.query<pointer>( "SELECT g FROM genre g INNER JOIN track_genre t_g ON t_g.genre_id = g.id INNER JOIN artist a ON t.artist_id = a.id INNER JOIN release r ON r.id = t.release_id INNER JOIN track t ON t.id = t_g.track_id " + sqlQuery.where().get()).groupBy("g.name").orderBy("g.name");
+	Wt::Dbo::Query<pointer> query = session.query<pointer>(searchQuery.get("g")).orderBy("g.name");
 
-	for (const std::string& bindArg : sqlQuery.where().getBindArgs())
+	for (const std::string& bindArg : searchQuery.getBindArgs())
 		query.bind(bindArg);
 
 	return query;
@@ -258,12 +411,16 @@ Genre::getQuery(Wt::Dbo::Session& session, SearchFilter filter)
 Wt::Dbo::Query<Genre::UIQueryResult>
 Genre::getUIQuery(Wt::Dbo::Session& session, SearchFilter filter)
 {
-	SqlQuery sqlQuery = generatePartialQuery(filter);
+	if (filter.isEmpty())
+		return session.query<UIQueryResult>("SELECT g.id, g.name, g.track_count FROM genre g WHERE g.track_count > 0").orderBy("g.name");
+
+	SearchQuery searchQuery(SearchFilter::Field::Track, filter);
+	searchQuery.join(SearchFilter::Field::Genre);
 
 	Wt::Dbo::Query<UIQueryResult> query
-		= session.query<UIQueryResult>( "SELECT g.id, g.name, COUNT(DISTINCT t.id) FROM genre g INNER JOIN track_genre t_g ON t_g.genre_id = g.id INNER JOIN artist a ON t.artist_id = a.id INNER JOIN release r ON r.id = t.release_id INNER JOIN track t ON t.id = t_g.track_id " + sqlQuery.where().get()).groupBy("g.name").orderBy("g.name");
+		= session.query<UIQueryResult>(searchQuery.get("g.id, g.name, COUNT(DISTINCT t.id)")).groupBy("g.name").orderBy("g.name");
 
-	for (const std::string& bindArg : sqlQuery.where().getBindArgs())
+	for (const std::string& bindArg : searchQuery.getBindArgs())
 		query.bind(bindArg);
 
 	return query;
@@ -272,15 +429,8 @@ Genre::getUIQuery(Wt::Dbo::Session& session, SearchFilter filter)
 void
 Genre::updateUIQueryModel(Wt::Dbo::Session& session,  Wt::Dbo::QueryModel<UIQueryResult>& model, SearchFilter filter, const std::vector<Wt::WString>& columnNames)
 {
-	Wt::Dbo::Query<UIQueryResult> query = getUIQuery(session, filter);
-	model.setQuery(query, columnNames.empty() ? true : false);
-
-	// TODO do something better
-	if (columnNames.size() == 2)
-	{
-		model.addColumn( "g.name", columnNames[0] );
-		model.addColumn( "COUNT(DISTINCT t.id)", columnNames[1] );
-	}
+	setUIQueryModel(model, getUIQuery(session, filter),
+			{"g.name", filter.isEmpty() ? "g.track_count" : "COUNT(DISTINCT t.id)"}, columnNames);
 }
 
 std::vector<Genre::pointer>
@@ -291,5 +441,58 @@ Genre::getByFilter(Wt::Dbo::Session& session, SearchFilter filter, int offset, i
 	return std::vector<pointer>(res.begin(), res.end());
 }
 
-} // namespace Database
+TrackDuplicate::TrackDuplicate(Type type, const std::string& key, Track::pointer track)
+: _type(type),
+_key(key),
+_track(track)
+{
+}
+
+std::string
+TrackDuplicate::getChecksumKey(int checksumType, const std::vector<unsigned char>& checksum)
+{
+	static const char hexDigits[] = "0123456789abcdef";
+
+	std::string res = std::to_string(checksumType) + ":";
+	for (unsigned char c : checksum)
+	{
+		res.push_back(hexDigits[c >> 4]);
+		res.push_back(hexDigits[c & 0x0F]);
+	}
+
+	return res;
+}
+
+TrackDuplicate::pointer
+TrackDuplicate::create(Wt::Dbo::Session& session, Type type, const std::string& key, Track::pointer track)
+{
+	return session.add(new TrackDuplicate(type, key, track));
+}
+
+std::vector<TrackDuplicate::pointer>
+TrackDuplicate::getAll(Wt::Dbo::Session& session, int offset, int size)
+{
+	Wt::Dbo::collection<pointer> res = session.find<TrackDuplicate>().orderBy("type, duplicate_key, track_id").offset(offset).limit(size);
+	return std::vector<pointer>(res.begin(), res.end());
+}
 
+std::size_t
+TrackDuplicate::getCount(Wt::Dbo::Session& session)
+{
+	return session.query<int>("SELECT COUNT(*) FROM track_duplicate");
+}
+
+void
+TrackDuplicate::removeByKey(Wt::Dbo::Session& session, Type type, const std::string& key)
+{
+	session.flush();
+	session.execute("DELETE FROM track_duplicate WHERE type = ? AND duplicate_key = ?").bind(static_cast<int>(type)).bind(key);
+}
+
+void
+TrackDuplicate::removeAll(Wt::Dbo::Session& session)
+{
+	session.execute("DELETE FROM track_duplicate");
+}
+
+} // namespace Database
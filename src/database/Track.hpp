@@ -20,6 +20,7 @@
 #ifndef _AUDIO_TYPES_HPP_
 #define _AUDIO_TYPES_HPP_
 
+#include <set>
 #include <string>
 #include <vector>
 
@@ -63,15 +64,31 @@ class Genre
 		// Create utility
 		static pointer create(Wt::Dbo::Session& session, const std::string& name);
 
+		// Cleanup utilities, return the number of removed rows
+		static std::size_t removeOrphans(Wt::Dbo::Session& session);	// genres without tracks
+		static std::size_t removeDanglingTrackLinks(Wt::Dbo::Session& session);	// track_genre rows pointing to nothing
+
+		// Recompute the counters from the tracks
+		static void updateCounters(Wt::Dbo::Session& session, const std::set<id_type>& ids);
+		static void updateAllCounters(Wt::Dbo::Session& session);
+
 		// Accessors
 		const std::string& getName(void) const { return _name; }
 		bool isNone(void) const;
 		const Wt::Dbo::collection< Wt::Dbo::ptr<Track> >&	getTracks() const { return _tracks;}
 
+		// Counters, maintained by the database updater
+		int getTrackCount(void) const { return _trackCount; }
+		int getReleaseCount(void) const { return _releaseCount; }
+		boost::posix_time::time_duration getDuration(void) const { return _duration; }
+
 		template<class Action>
 			void persist(Action& a)
 			{
 				Wt::Dbo::field(a, _name,	"name");
+				Wt::Dbo::field(a, _trackCount,	"track_count");
+				Wt::Dbo::field(a, _releaseCount,	"release_count");
+				Wt::Dbo::field(a, _duration,	"duration");
 				Wt::Dbo::hasMany(a, _tracks, Wt::Dbo::ManyToMany, "track_genre", "", Wt::Dbo::OnDeleteCascade);
 			}
 
@@ -80,6 +97,9 @@ class Genre
 
 		static const std::size_t _maxNameLength = 128;
 		std::string	_name;
+		int		_trackCount = 0;
+		int		_releaseCount = 0;
+		boost::posix_time::time_duration	_duration;
 
 		Wt::Dbo::collection< Wt::Dbo::ptr<Track> > _tracks;
 };
@@ -106,10 +126,22 @@ class Track
 		static pointer getByMBID(Wt::Dbo::Session& session, const std::string& MBID);
 		static std::vector<pointer> 	getByFilter(Wt::Dbo::Session& session, SearchFilter filter, int offset = -1, int size = -1);
 		static std::vector<pointer> 	getByFilter(Wt::Dbo::Session& session, SearchFilter filter, int offset, int size, bool &moreResults);
+		static std::vector<pointer> 	getByFilter(Wt::Dbo::Session& session, SearchFilter filter, SearchCursor& cursor, int size, bool& moreResults);	// page after the cursor, moved to the last row
 		static Wt::Dbo::collection< pointer > getAll(Wt::Dbo::Session& session);
 		static std::vector<boost::filesystem::path> getAllPaths(Wt::Dbo::Session& session);
-		static std::vector<pointer> getMBIDDuplicates(Wt::Dbo::Session& session);
-		static std::vector<pointer> getChecksumDuplicates(Wt::Dbo::Session& session);
+		static std::vector<std::string> getAllCoverHashes(Wt::Dbo::Session& session);
+
+		// ID, path, last write time and size of each track file, used to detect changes
+		typedef boost::tuple<id_type, std::string, boost::posix_time::ptime, long long> FileInfoQueryResult;
+		static Wt::Dbo::collection<FileInfoQueryResult> getAllFileInfos(Wt::Dbo::Session& session);
+		static Wt::Dbo::collection<FileInfoQueryResult> getFileInfosUnder(Wt::Dbo::Session& session, const boost::filesystem::path& p); // p itself or below
+
+		// Duplicate detection, using the mbid and checksum indexes
+		static std::vector<pointer> getAllByMBID(Wt::Dbo::Session& session, const std::string& MBID);
+		static std::vector<pointer> getAllByChecksum(Wt::Dbo::Session& session, int checksumType, const std::vector<unsigned char>& checksum);
+		static std::vector<std::string> getDuplicatedMBIDs(Wt::Dbo::Session& session);
+		typedef boost::tuple<int, std::vector<unsigned char>> ChecksumQueryResult;	// checksum type, checksum
+		static std::vector<ChecksumQueryResult> getDuplicatedChecksums(Wt::Dbo::Session& session);
 
 		// Utility fonctions
 		// MVC models for the user interface
@@ -146,12 +178,15 @@ class Track
 		void setName(const std::string& name)				{ _name = std::string(name, 0, _maxNameLength); }
 		void setDuration(boost::posix_time::time_duration duration)	{ _duration = duration; }
 		void setLastWriteTime(boost::posix_time::ptime time)		{ _fileLastWrite = time; }
+		void setFileSize(long long size)				{ _fileSize = size; }
 		void setAddedTime(boost::posix_time::ptime time)		{ _fileAdded = time; }
 		void setChecksum(const std::vector<unsigned char>& checksum)	{ _fileChecksum = checksum; }
+		void setChecksumType(int type)					{ _fileChecksumType = type; }
 		void setDate(const boost::posix_time::ptime& date)		{ _date = date; }
 		void setOriginalDate(const boost::posix_time::ptime& date)	{ _originalDate = date; }
 		void setGenres(const std::string& genreList)			{ _genreList = genreList; }
 		void setCoverType(CoverType coverType)				{ _coverType = coverType; }
+		void setCoverHash(const std::string& hash)			{ _coverHash = hash; }
 		void setMBID(const std::string& MBID)				{ _MBID = MBID; }
 		void setArtist(Wt::Dbo::ptr<Artist> artist)			{ _artist = artist; }
 		void setRelease(Wt::Dbo::ptr<Release> release)			{ _release = release; }
@@ -167,9 +202,12 @@ class Track
 		boost::posix_time::ptime	getDate(void) const			{ return _date; }
 		boost::posix_time::ptime	getOriginalDate(void) const		{ return _originalDate; }
 		boost::posix_time::ptime	getLastWriteTime(void) const		{ return _fileLastWrite; }
+		long long			getFileSize(void) const			{ return _fileSize; }
 		boost::posix_time::ptime	getAddedTime(void) const		{ return _fileAdded; }
 		const std::vector<unsigned char>& getChecksum(void) const		{ return _fileChecksum; }
+		int				getChecksumType(void) const		{ return _fileChecksumType; }
 		CoverType			getCoverType(void) const		{ return _coverType; }
+		const std::string&		getCoverHash(void) const		{ return _coverHash; }
 		const std::string&		getMBID(void) const			{ return _MBID; }
 		Wt::Dbo::ptr<Artist>		getArtist(void) const			{ return _artist; }
 		Wt::Dbo::ptr<Release>		getRelease(void) const			{ return _release; }
@@ -190,9 +228,12 @@ class Track
 				Wt::Dbo::field(a, _genreList,		"genre_list");
 				Wt::Dbo::field(a, _filePath,		"file_path");
 				Wt::Dbo::field(a, _fileLastWrite,	"file_last_write");
+				Wt::Dbo::field(a, _fileSize,		"file_size");
 				Wt::Dbo::field(a, _fileAdded,		"file_added");
 				Wt::Dbo::field(a, _fileChecksum,	"checksum");
+				Wt::Dbo::field(a, _fileChecksumType,	"checksum_type");
 				Wt::Dbo::field(a, _coverType,		"cover_type");
+				Wt::Dbo::field(a, _coverHash,		"cover_hash");
 				Wt::Dbo::field(a, _MBID,		"mbid");
 				Wt::Dbo::belongsTo(a, _release, "release", Wt::Dbo::OnDeleteCascade);
 				Wt::Dbo::belongsTo(a, _artist, "artist", Wt::Dbo::OnDeleteCascade);
@@ -202,7 +243,9 @@ class Track
 
 	private:
 
-		static Wt::Dbo::Query< pointer > getQuery(Wt::Dbo::Session& session, SearchFilter filter);
+		// Rows along with their sort keys (name rank, artist, date, release, disc, track), sorted after the cursor if any
+		typedef boost::tuple<pointer, double, std::string, std::string, std::string, int, int> SortedQueryResult;
+		static Wt::Dbo::Query<SortedQueryResult> getQuery(Wt::Dbo::Session& session, SearchFilter filter, const SearchCursor& cursor = SearchCursor());
 
 		static const std::size_t _maxNameLength = 128;
 
@@ -219,9 +262,12 @@ class Track
 		std::string				_genreList;
 		std::string				_filePath;
 		std::vector<unsigned char>		_fileChecksum;
+		int					_fileChecksumType;	// algorithm used to compute _fileChecksum
 		boost::posix_time::ptime		_fileLastWrite;
+		long long				_fileSize;
 		boost::posix_time::ptime		_fileAdded;
 		CoverType				_coverType;
+		std::string				_coverHash;	// embedded cover in the cover store, empty if none
 		std::string				_MBID; // Musicbrainz Identifier
 
 		Wt::Dbo::ptr<Artist>			_artist;
@@ -231,6 +277,51 @@ class Track
 
 };
 
+// Track sharing its MBID or its checksum with at least another track
+// Maintained by the database updater, for the tracks changed by each scan
+class TrackDuplicate
+{
+	public:
+
+		typedef Wt::Dbo::ptr<TrackDuplicate> pointer;
+
+		enum class Type
+		{
+			MBID,
+			Checksum,
+		};
+
+		TrackDuplicate() {}
+		TrackDuplicate(Type type, const std::string& key, Track::pointer track);
+
+		// Duplicates are grouped by key: the MBID or the checksum type and value
+		static std::string getChecksumKey(int checksumType, const std::vector<unsigned char>& checksum);
+
+		static pointer create(Wt::Dbo::Session& session, Type type, const std::string& key, Track::pointer track);
+		static std::vector<pointer> getAll(Wt::Dbo::Session& session, int offset = -1, int size = -1);	// grouped by key
+		static std::size_t getCount(Wt::Dbo::Session& session);
+		static void removeByKey(Wt::Dbo::Session& session, Type type, const std::string& key);
+		static void removeAll(Wt::Dbo::Session& session);
+
+		Type			getType(void) const	{ return _type; }
+		const std::string&	getKey(void) const	{ return _key; }
+		Track::pointer		getTrack(void) const	{ return _track; }
+
+		template<class Action>
+			void persist(Action& a)
+			{
+				Wt::Dbo::field(a, _type,	"type");
+				Wt::Dbo::field(a, _key,		"duplicate_key");
+				Wt::Dbo::belongsTo(a, _track, "track", Wt::Dbo::OnDeleteCascade);
+			}
+
+	private:
+
+		Type			_type;
+		std::string		_key;
+		Track::pointer		_track;
+};
+
 
 
 
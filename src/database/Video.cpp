@@ -22,11 +22,13 @@
 namespace Database {
 
 Video::Video()
+: _fileSize(0)
 {
 }
 
 Video::Video(const boost::filesystem::path& p)
-: _filePath(p.string())
+: _filePath(p.string()),
+_fileSize(0)
 {
 }
 
@@ -48,6 +50,27 @@ Video::getByPath(Wt::Dbo::Session& session, const boost::filesystem::path& p)
 	return session.find<Video>().where("path = ?").bind(p.string());
 }
 
+Video::pointer
+Video::getById(Wt::Dbo::Session& session, id_type id)
+{
+	return session.find<Video>().where("id = ?").bind(id);
+}
+
+Wt::Dbo::collection<Video::FileInfoQueryResult>
+Video::getAllFileInfos(Wt::Dbo::Session& session)
+{
+	return session.query<FileInfoQueryResult>("SELECT id, path, last_write, file_size FROM video");
+}
+
+Wt::Dbo::collection<Video::FileInfoQueryResult>
+Video::getFileInfosUnder(Wt::Dbo::Session& session, const boost::filesystem::path& p)
+{
+	// Paths below 'p/' sort between 'p/' and 'p0', since '0' follows '/'
+	return session.query<FileInfoQueryResult>("SELECT id, path, last_write, file_size FROM video")
+		.where("path = ? OR (path >= ? AND path < ?)")
+		.bind(p.string()).bind(p.string() + "/").bind(p.string() + "0");
+}
+
 std::vector<boost::filesystem::path>
 Video::getAllPaths(Wt::Dbo::Session& session)
 {
@@ -36,6 +36,7 @@ class Video
 	public:
 
 		typedef Wt::Dbo::ptr<Video> pointer;
+		typedef Wt::Dbo::dbo_traits<Video>::IdType id_type;
 
 		Video();
 		Video( const boost::filesystem::path& p);
@@ -44,6 +45,12 @@ class Video
 		static pointer getByPath(Wt::Dbo::Session& session, const boost::filesystem::path& p);
 		static Wt::Dbo::collection< pointer > getAll(Wt::Dbo::Session& session);
 		static std::vector<boost::filesystem::path> getAllPaths(Wt::Dbo::Session& session);
+		static pointer getById(Wt::Dbo::Session& session, id_type id);
+
+		// ID, path, last write time and size of each video file, used to detect changes
+		typedef boost::tuple<id_type, std::string, boost::posix_time::ptime, long long> FileInfoQueryResult;
+		static Wt::Dbo::collection<FileInfoQueryResult> getAllFileInfos(Wt::Dbo::Session& session);
+		static Wt::Dbo::collection<FileInfoQueryResult> getFileInfosUnder(Wt::Dbo::Session& session, const boost::filesystem::path& p); // p itself or below
 
 		// Create utility
 		static pointer	create(Wt::Dbo::Session& session, const boost::filesystem::path& p);
@@ -52,12 +59,14 @@ class Video
 		void setName(const std::string& name)				{ _name = name; }
 		void setDuration(boost::posix_time::time_duration duration)	{ _duration = duration; }
 		void setLastWriteTime(boost::posix_time::ptime time)		{ _fileLastWrite = time; }
+		void setFileSize(long long size)				{ _fileSize = size; }
 
 		// Accessors
 		std::string 				getName(void) const	{ return _name; }
 		boost::posix_time::time_duration	getDuration(void) const	{ return _duration; }
 		boost::filesystem::path			getPath(void) const	{ return _filePath; }
 		boost::posix_time::ptime		getLastWriteTime(void) const { return _fileLastWrite; }
+		long long				getFileSize(void) const	{ return _fileSize; }
 
 		template<class Action>
 			void persist(Action& a)
@@ -66,6 +75,7 @@ class Video
 				Wt::Dbo::field(a, _duration,		"duration");
 				Wt::Dbo::field(a, _fileLastWrite,	"last_write");
 				Wt::Dbo::field(a, _filePath,		"path");
+				Wt::Dbo::field(a, _fileSize,		"file_size");
 			}
 
 	private:
@@ -74,6 +84,7 @@ class Video
 		boost::posix_time::time_duration	_duration;
 		std::string				_filePath;
 		boost::posix_time::ptime		_fileLastWrite;
+		long long				_fileSize;
 
 }; // Video
 
@@ -17,21 +17,67 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
 #include <boost/filesystem.hpp>
 
 #include "config/config.h"
 #include "av/AvInfo.hpp"
 #include "av/AvTranscoder.hpp"
+#include "cover/CoverStore.hpp"
 #include "logger/Logger.hpp"
 #include "image/Image.hpp"
+#include "utils/Utils.hpp"
 
 #include "ui/LmsApplication.hpp"
 
+#include "database-updater/DatabaseUpdater.hpp"
+#include "metadata/AvFormat.hpp"
 #include "service/ServiceManager.hpp"
 #include "service/DatabaseUpdateService.hpp"
+#include "service/MediaDirectoryWatchService.hpp"
+#include "ui/resource/ScanMetricsResource.hpp"
 
 #include <Wt/WServer>
 
+// "true" or "false" property of the configuration file
+static bool
+readBoolProperty(Wt::WServer& server, const std::string& name, bool defaultValue)
+{
+	std::string value;
+	if (!server.readConfigurationProperty(name, value))
+		return defaultValue;
+
+	if (value != "true" && value != "false")
+		throw std::runtime_error("Bad value for the '" + name + "' property");
+
+	return value == "true";
+}
+
+// Removes the "--dry-run[=<report file>]" option from the arguments, since Wt does not know it
+// Returns true if the option is set, reportPath is left empty to report on the standard output
+static bool
+extractDryRunOption(std::vector<char*>& args, std::string& reportPath)
+{
+	static const char option[] = "--dry-run";
+
+	for (auto it = args.begin(); it != args.end(); ++it)
+	{
+		if (std::strcmp(*it, option) == 0 || std::strncmp(*it, "--dry-run=", sizeof(option)) == 0)
+		{
+			const char* value = *it + sizeof(option) - 1;
+			reportPath = (*value == '=') ? value + 1 : "";
+
+			args.erase(it);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 int main(int argc, char* argv[])
 {
 	int res = EXIT_FAILURE;
@@ -44,8 +90,13 @@ int main(int argc, char* argv[])
 		// Make pstream work with ffmpeg
 		close(STDIN_FILENO);
 
+		std::vector<char*> args(argv, argv + argc);
+
+		std::string dryRunReportPath;
+		const bool dryRun = extractDryRunOption(args, dryRunReportPath);
+
 		Wt::WServer server(argv[0]);
-		server.setServerConfiguration (argc, argv);
+		server.setServerConfiguration (args.size(), args.data());
 
 		Wt::WServer::instance()->logger().configure("*"); // log everything
 
@@ -58,12 +109,65 @@ int main(int argc, char* argv[])
 		Database::Handler::configureAuth();
 
 		// Initializing a connection pool to the database that will be shared along services
-		std::unique_ptr<Wt::Dbo::SqlConnectionPool> connectionPool( Database::Handler::createConnectionPool("/var/lms/lms.db")); // TODO use $datadir from autotools
-
-		serviceManager.add( std::make_shared<Service::DatabaseUpdateService>(*connectionPool));
+		const boost::filesystem::path dbPath = "/var/lms/lms.db"; // TODO use $datadir from autotools
+		std::unique_ptr<Wt::Dbo::SqlConnectionPool> connectionPool( Database::Handler::createConnectionPool(dbPath));
+
+		// Reader connections for the user interface, so that browsing is not serialized with the scans
+		// Configured by the "db-read-connections" property, 0 to share the writer connection
+		std::size_t nbReadConnections = 4;
+		{
+			std::string value;
+			if (server.readConfigurationProperty("db-read-connections", value) && !readAs(value, nbReadConnections))
+				throw std::runtime_error("Bad value for the 'db-read-connections' property");
+		}
+
+		std::unique_ptr<Wt::Dbo::SqlConnectionPool> readConnectionPool;
+		if (nbReadConnections > 0)
+			readConnectionPool.reset( Database::Handler::createReadConnectionPool(dbPath, nbReadConnections));
+
+		// Embedded covers extracted by the scanner, configured by the "covers-dir" property
+		{
+			std::string coversDir;
+			if (server.readConfigurationProperty("covers-dir", coversDir))
+				CoverArt::Store::instance().setDirectory(coversDir);
+		}
+
+		// Tags read straight from the file headers, libav being only a fallback
+		// Enabled by setting the "scan-header-parsing" property to true
+		const bool headerParsing = readBoolProperty(server, "scan-header-parsing", false);
+
+		// Report what a full scan would change, without writing anything nor starting the server
+		if (dryRun)
+		{
+			DatabaseUpdater::Updater updater(*connectionPool, [headerParsing] { return std::make_shared<MetaData::AvFormat>(headerParsing); });
+
+			LMS_LOG(MAIN, INFO) << "Running a dry scan...";
+
+			if (dryRunReportPath.empty())
+				updater.dryRun(true, std::cout);
+			else
+			{
+				std::ofstream report(dryRunReportPath);
+				if (!report)
+					throw std::runtime_error("Cannot open report file '" + dryRunReportPath + "'");
+
+				updater.dryRun(true, report);
+			}
+
+			return EXIT_SUCCESS;
+		}
+
+		Service::DatabaseUpdateService::pointer databaseUpdateService = std::make_shared<Service::DatabaseUpdateService>(*connectionPool, headerParsing);
+		serviceManager.add( databaseUpdateService );
+		serviceManager.add( std::make_shared<Service::MediaDirectoryWatchService>(*connectionPool, databaseUpdateService));
+
+		// Scan progress, for monitoring purposes
+		// Served to local clients only, unless the "scan-metrics-remote-access" property is set to true
+		UserInterface::ScanMetricsResource scanMetricsResource(databaseUpdateService, readBoolProperty(server, "scan-metrics-remote-access", false));
+		server.addResource(&scanMetricsResource, "/metrics/scan");
 
 		// bind entry point
-		server.addEntryPoint(Wt::Application, boost::bind(UserInterface::LmsApplication::create, _1, boost::ref(*connectionPool)));
+		server.addEntryPoint(Wt::Application, boost::bind(UserInterface::LmsApplication::create, _1, boost::ref(*connectionPool), readConnectionPool.get()));
 
 		// Starting the main server
 		LMS_LOG(MAIN, INFO) << "Starting server...";
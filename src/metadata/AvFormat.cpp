@@ -25,6 +25,8 @@
 
 #include "av/AvInfo.hpp"
 
+#include "HeaderParser.hpp"
+
 
 namespace MetaData
 {
@@ -32,7 +34,48 @@ namespace MetaData
 bool
 AvFormat::parse(const boost::filesystem::path& p, Items& items)
 {
+	if (_headerParsing)
+	{
+		try
+		{
+			if (parseFromHeaders(p, items))
+				return true;
+		}
+		catch (std::exception& e)
+		{
+			LMS_LOG(METADATA, ERROR) << "Header parsing failed on '" << p.string() << "': " << e.what();
+		}
+
+		items.clear();
+	}
+
+	return parseAv(p, items);
+}
+
+bool
+AvFormat::parseFromHeaders(const boost::filesystem::path& p, Items& items)
+{
+	HeaderInfo info;
+	if (!parseHeaders(p, info))
+		return false;
+
+	AudioStream audioStream;
+	audioStream.desc = std::move(info.audioStreamDesc);
+	audioStream.bitRate = info.audioBitrate;
+
+	items.audioStreams.push_back(std::move(audioStream));
+	items.duration = info.duration;
+	items.hasCover = info.hasCover;
+	items.cover = std::move(info.cover);
+
+	parseTags(info.tags, items);
+
+	return true;
+}
 
+bool
+AvFormat::parseAv(const boost::filesystem::path& p, Items& items)
+{
 	Av::MediaFile mediaFile(p);
 
 	if (!mediaFile.open())
@@ -41,160 +84,131 @@ AvFormat::parse(const boost::filesystem::path& p, Items& items)
 	if (!mediaFile.scan())
 		return false;
 
-	std::map<std::string, std::string> metadata = mediaFile.getMetaData();
-
 	// Stream info
+	for (Av::Stream& stream : mediaFile.getStreams(Av::Stream::Type::Audio))
 	{
-		std::vector<AudioStream> audioStreams;
+		AudioStream audioStream;
+		audioStream.desc = std::move(stream.desc);
+		audioStream.bitRate = stream.bitrate;
 
-		std::vector<Av::Stream> streams = mediaFile.getStreams(Av::Stream::Type::Audio);
+		items.audioStreams.push_back(std::move(audioStream));
+	}
 
-		for (Av::Stream& stream : streams)
-		{
-			AudioStream audioStream;
-			audioStream.desc = stream.desc;
-			audioStream.bitRate = stream.bitrate;
+	for (Av::Stream& stream : mediaFile.getStreams(Av::Stream::Type::Video))
+	{
+		VideoStream videoStream;
+		videoStream.desc = std::move(stream.desc);
+		videoStream.bitRate = stream.bitrate;
 
-			audioStreams.push_back(audioStream);
-		}
+		items.videoStreams.push_back(std::move(videoStream));
+	}
 
-		if (!audioStreams.empty())
-			items.insert( std::make_pair(MetaData::Type::AudioStreams, audioStreams));
+	for (Av::Stream& stream : mediaFile.getStreams(Av::Stream::Type::Subtitle))
+	{
+		SubtitleStream subtitleStream;
+		subtitleStream.desc = std::move(stream.desc);
+
+		items.subtitleStreams.push_back(std::move(subtitleStream));
 	}
 
+	// Duration
+	items.duration = mediaFile.getDuration();
+
+	// Cover
+	items.hasCover = mediaFile.hasAttachedPictures();
+	if (items.hasCover)
 	{
-		std::vector<VideoStream> videoStreams;
+		std::vector<Av::Picture> pictures = mediaFile.getAttachedPictures(1);
+		if (!pictures.empty())
+			items.cover = std::move(pictures.front().data);
+	}
 
-		std::vector<Av::Stream> streams = mediaFile.getStreams(Av::Stream::Type::Video);
+	parseTags(mediaFile.getMetaData(), items);
 
-		for (Av::Stream& stream : streams)
-		{
-			VideoStream videoStream;
-			videoStream.desc = stream.desc;
-			videoStream.bitRate = stream.bitrate;
+	return true;
+}
 
-			videoStreams.push_back(videoStream);
-		}
+namespace
+{
 
-		if (!videoStreams.empty())
-			items.insert( std::make_pair(MetaData::Type::VideoStreams, videoStreams));
-	}
+// The first matching tag wins
+void setString(std::string& field, const std::string& value)
+{
+	if (field.empty())
+		field = stringTrim( stringToUTF8(value) );
+}
 
-	{
-		std::vector<SubtitleStream> subtitleStreams;
+// Expecting 'Number/Total'
+void setNumberPair(boost::optional<std::size_t>& number, boost::optional<std::size_t>& total, const std::string& value)
+{
+	if (number || total)
+		return;
 
-		std::vector<Av::Stream> streams = mediaFile.getStreams(Av::Stream::Type::Subtitle);
+	auto strings = splitString(value, "/");
 
-		for (Av::Stream& stream : streams)
-		{
-			SubtitleStream subtitleStream;
-			subtitleStream.desc = stream.desc;
+	std::size_t res;
+	if (strings.size() > 0 && readAs<std::size_t>(strings[0], res))
+		number = res;
 
-			subtitleStreams.push_back(subtitleStream);
-		}
+	if (strings.size() > 1 && readAs<std::size_t>(strings[1], res))
+		total = res;
+}
 
-		if (!subtitleStreams.empty())
-			items.insert( std::make_pair(MetaData::Type::SubtitleStreams, subtitleStreams));
-	}
+void setDate(boost::optional<boost::posix_time::ptime>& date, const std::string& value)
+{
+	boost::posix_time::ptime p;
+	if (!date && readAsPosixTime(value, p))
+		date = p;
+}
 
-	// Duration
-	items.insert( std::make_pair(MetaData::Type::Duration, mediaFile.getDuration() ));
+void setGenres(Genres& genres, const std::string& value)
+{
+	if (genres.empty())
+		readList(value, ";,\\", genres);
+}
 
-	// Cover
-	items.insert( std::make_pair(MetaData::Type::HasCover, mediaFile.hasAttachedPictures()));
+} // namespace
 
+void
+AvFormat::parseTags(const std::map<std::string, std::string>& tags, Items& items)
+{
 	// Embedded MetaData
 	// Make sure to convert strings into UTF-8
-	std::map<std::string, std::string>::const_iterator it;
-	for (it = metadata.begin(); it != metadata.end(); ++it)
+	for (const auto& tag : tags)
 	{
-		if (boost::iequals(it->first, "artist"))
-			items.insert( std::make_pair(MetaData::Type::Artist, stringTrim( stringToUTF8(it->second)) ));
-		else if (boost::iequals(it->first, "album"))
-			items.insert( std::make_pair(MetaData::Type::Album, stringTrim( stringToUTF8(it->second)) ));
-		else if (boost::iequals(it->first, "title"))
-			items.insert( std::make_pair(MetaData::Type::Title, stringTrim( stringToUTF8(it->second)) ));
-		else if (boost::iequals(it->first, "track"))
-		{
-			// Expecting 'Number/Total'
-			auto strings = splitString(it->second, "/");
-
-			if (strings.size() > 0)
-			{
-				std::size_t number;
-				if (readAs<std::size_t>(strings[0], number))
-					items.insert( std::make_pair(MetaData::Type::TrackNumber, number ));
-
-				if (strings.size() > 1)
-				{
-					std::size_t totalNumber;
-					if (readAs<std::size_t>(strings[1], totalNumber))
-						items.insert( std::make_pair(MetaData::Type::TotalTrack, totalNumber ));
-				}
-			}
-		}
-		else if (boost::iequals(it->first, "disc"))
-		{
-			// Expecting 'Number/Total'
-			auto strings = splitString(it->second, "/");
-
-			if (strings.size() > 0)
-			{
-				std::size_t number;
-				if (readAs<std::size_t>(strings[0], number))
-					items.insert( std::make_pair(MetaData::Type::DiscNumber, number ));
-
-				if (strings.size() > 1)
-				{
-					std::size_t totalNumber;
-					if (readAs<std::size_t>(strings[1], totalNumber))
-						items.insert( std::make_pair(MetaData::Type::TotalDisc, totalNumber ));
-				}
-			}
-		}
-		else if (boost::iequals(it->first, "date")
-				|| boost::iequals(it->first, "year")
-				|| boost::iequals(it->first, "WM/Year"))
-		{
-			boost::posix_time::ptime p;
-			if (readAsPosixTime(it->second, p))
-				items.insert( std::make_pair(MetaData::Type::Date, p));
-		}
-		else if (boost::iequals(it->first, "TDOR")	// Original release time (ID3v2 2.4)
-				|| boost::iequals(it->first, "TORY"))	// Original release year
-		{
-			boost::posix_time::ptime p;
-			if (readAsPosixTime(it->second, p))
-				items.insert( std::make_pair(MetaData::Type::OriginalDate, p));
-		}
-		else if (boost::iequals(it->first, "genre"))
-		{
-			// TODO use splitStrings
-			std::list<std::string> genres;
-			if (readList(it->second, ";,\\", genres))
-				items.insert( std::make_pair(MetaData::Type::Genres, genres));
-
-		}
-		else if (boost::iequals(it->first, "MusicBrainz Artist Id")
-			|| boost::iequals(it->first, "MUSICBRAINZ_ARTISTID"))
-		{
-			items.insert( std::make_pair(MetaData::Type::MusicBrainzArtistID, stringTrim( stringToUTF8(it->second)) ));
-		}
-		else if (boost::iequals(it->first, "MusicBrainz Album Id")
-			|| boost::iequals(it->first, "MUSICBRAINZ_ALBUMID"))
-		{
-			items.insert( std::make_pair(MetaData::Type::MusicBrainzAlbumID, stringTrim( stringToUTF8(it->second)) ));
-		}
-		else if (boost::iequals(it->first, "MusicBrainz Release Track Id")
-			|| boost::iequals(it->first, "MUSICBRAINZ_RELEASETRACKID")
-			|| boost::iequals(it->first, "MUSICBRAINZ_TRACKID"))
-		{
-			items.insert( std::make_pair(MetaData::Type::MusicBrainzTrackID, stringTrim( stringToUTF8(it->second)) ));
-		}
+		const std::string& name = tag.first;
+		const std::string& value = tag.second;
+
+		if (boost::iequals(name, "artist"))
+			setString(items.artist, value);
+		else if (boost::iequals(name, "album"))
+			setString(items.album, value);
+		else if (boost::iequals(name, "title"))
+			setString(items.title, value);
+		else if (boost::iequals(name, "track"))
+			setNumberPair(items.trackNumber, items.totalTrack, value);
+		else if (boost::iequals(name, "disc"))
+			setNumberPair(items.discNumber, items.totalDisc, value);
+		else if (boost::iequals(name, "date")
+				|| boost::iequals(name, "year")
+				|| boost::iequals(name, "WM/Year"))
+			setDate(items.date, value);
+		else if (boost::iequals(name, "TDOR")	// Original release time (ID3v2 2.4)
+				|| boost::iequals(name, "TORY"))	// Original release year
+			setDate(items.originalDate, value);
+		else if (boost::iequals(name, "genre"))
+			setGenres(items.genres, value);
+		else if (boost::iequals(name, "MusicBrainz Artist Id")
+			|| boost::iequals(name, "MUSICBRAINZ_ARTISTID"))
+			setString(items.musicBrainzArtistID, value);
+		else if (boost::iequals(name, "MusicBrainz Album Id")
+			|| boost::iequals(name, "MUSICBRAINZ_ALBUMID"))
+			setString(items.musicBrainzAlbumID, value);
+		else if (boost::iequals(name, "MusicBrainz Release Track Id")
+			|| boost::iequals(name, "MUSICBRAINZ_RELEASETRACKID")
+			|| boost::iequals(name, "MUSICBRAINZ_TRACKID"))
+			setString(items.musicBrainzTrackID, value);
 	}
-
-	return true;
 }
 
 } // namespace MetaData
-
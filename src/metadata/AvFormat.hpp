@@ -20,6 +20,9 @@
 #ifndef METADATA_AVFORMAT_HPP
 #define METADATA_AVFORMAT_HPP
 
+#include <map>
+#include <string>
+
 #include "MetaData.hpp"
 
 namespace MetaData
@@ -30,10 +33,20 @@ class AvFormat : public Parser
 {
 	public:
 
+		// If headerParsing is set, supported audio files are parsed straight from their headers
+		// and libav is only used as a fallback (opt-in, see test/CheckHeaderParser.cpp)
+		AvFormat(bool headerParsing = false) : _headerParsing(headerParsing) {}
+
 		bool parse(const boost::filesystem::path& p, Items& items);
 
 	private:
 
+		bool parseFromHeaders(const boost::filesystem::path& p, Items& items);
+		bool parseAv(const boost::filesystem::path& p, Items& items);
+
+		static void parseTags(const std::map<std::string, std::string>& tags, Items& items);
+
+		bool _headerParsing;
 };
 
 
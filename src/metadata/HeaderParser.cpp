@@ -0,0 +1,1156 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "HeaderParser.hpp"
+
+namespace MetaData
+{
+
+namespace
+{
+
+typedef std::vector<unsigned char> Buffer;
+
+// Truncated or inconsistent data
+class HeaderError : public std::runtime_error
+{
+	public:
+		HeaderError(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+// Text frames larger than this are not tags
+static const std::size_t maxTagSize = 1024 * 1024;
+static const std::size_t maxCoverSize = 16 * 1024 * 1024;
+
+// Only the genres that libav knows under the same name
+static const std::vector<std::string> id3v1Genres =
+{
+	"Blues", "Classic Rock", "Country", "Dance", "Disco", "Funk", "Grunge", "Hip-Hop",
+	"Jazz", "Metal", "New Age", "Oldies", "Other", "Pop", "R&B", "Rap",
+	"Reggae", "Rock", "Techno", "Industrial", "Alternative", "Ska", "Death Metal", "Pranks",
+	"Soundtrack", "Euro-Techno", "Ambient", "Trip-Hop", "Vocal", "Jazz+Funk", "Fusion", "Trance",
+	"Classical", "Instrumental", "Acid", "House", "Game", "Sound Clip", "Gospel", "Noise",
+	"Alt. Rock", "Bass", "Soul", "Punk", "Space", "Meditative", "Instrumental Pop", "Instrumental Rock",
+	"Ethnic", "Gothic", "Darkwave", "Techno-Industrial", "Electronic", "Pop-Folk", "Eurodance", "Dream",
+	"Southern Rock", "Comedy", "Cult", "Gangsta", "Top 40", "Christian Rap", "Pop/Funk", "Jungle",
+	"Native American", "Cabaret", "New Wave", "Psychedelic", "Rave", "Showtunes", "Trailer", "Lo-Fi",
+	"Tribal", "Acid Punk", "Acid Jazz", "Polka", "Retro", "Musical", "Rock & Roll", "Hard Rock",
+};
+
+class FileReader
+{
+	public:
+		FileReader(const boost::filesystem::path& p)
+		: _ifs(p.string(), std::ios::binary)
+		{
+			if (!_ifs)
+				throw HeaderError("cannot open file");
+
+			_ifs.seekg(0, std::ios::end);
+			_size = _ifs.tellg();
+			_ifs.seekg(0, std::ios::beg);
+		}
+
+		uint64_t size() const	{ return _size; }
+		uint64_t tell()		{ return _ifs.tellg(); }
+
+		void seek(uint64_t offset)
+		{
+			if (offset > _size)
+				throw HeaderError("seek past end of file");
+
+			_ifs.seekg(offset, std::ios::beg);
+		}
+
+		void skip(uint64_t size)	{ seek(tell() + size); }
+
+		Buffer read(uint64_t size)
+		{
+			if (size > _size - tell())
+				throw HeaderError("unexpected end of file");
+
+			Buffer res(size);
+			_ifs.read(reinterpret_cast<char*>(res.data()), size);
+			if (!_ifs)
+				throw HeaderError("read error");
+
+			return res;
+		}
+
+		Buffer readAt(uint64_t offset, uint64_t size)
+		{
+			seek(offset);
+			return read(size);
+		}
+
+	private:
+		std::ifstream	_ifs;
+		uint64_t	_size;
+};
+
+uint64_t readBE(const unsigned char* data, std::size_t nbBytes)
+{
+	uint64_t res = 0;
+	for (std::size_t i = 0; i < nbBytes; ++i)
+		res = (res << 8) | data[i];
+	return res;
+}
+
+uint32_t readLE32(const unsigned char* data)
+{
+	return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+uint32_t readSyncSafe(const unsigned char* data)
+{
+	return (data[0] << 21) | (data[1] << 14) | (data[2] << 7) | data[3];
+}
+
+void appendUTF8(std::string& str, uint32_t codePoint)
+{
+	if (codePoint < 0x80)
+		str.push_back(codePoint);
+	else if (codePoint < 0x800)
+	{
+		str.push_back(0xC0 | (codePoint >> 6));
+		str.push_back(0x80 | (codePoint & 0x3F));
+	}
+	else if (codePoint < 0x10000)
+	{
+		str.push_back(0xE0 | (codePoint >> 12));
+		str.push_back(0x80 | ((codePoint >> 6) & 0x3F));
+		str.push_back(0x80 | (codePoint & 0x3F));
+	}
+	else
+	{
+		str.push_back(0xF0 | (codePoint >> 18));
+		str.push_back(0x80 | ((codePoint >> 12) & 0x3F));
+		str.push_back(0x80 | ((codePoint >> 6) & 0x3F));
+		str.push_back(0x80 | (codePoint & 0x3F));
+	}
+}
+
+std::string latin1ToUTF8(const unsigned char* data, std::size_t size)
+{
+	std::string res;
+	for (std::size_t i = 0; i < size; ++i)
+		appendUTF8(res, data[i]);
+	return res;
+}
+
+std::string utf16ToUTF8(const unsigned char* data, std::size_t size, bool bigEndian)
+{
+	// The BOM overrides the default byte order
+	if (size >= 2 && ((data[0] == 0xFF && data[1] == 0xFE) || (data[0] == 0xFE && data[1] == 0xFF)))
+	{
+		bigEndian = (data[0] == 0xFE);
+		data += 2;
+		size -= 2;
+	}
+
+	std::string res;
+	for (std::size_t i = 0; i + 1 < size; i += 2)
+	{
+		uint32_t codeUnit = bigEndian ? ((data[i] << 8) | data[i + 1]) : (data[i] | (data[i + 1] << 8));
+
+		if (codeUnit >= 0xD800 && codeUnit < 0xDC00 && i + 3 < size)
+		{
+			uint32_t lowSurrogate = bigEndian ? ((data[i + 2] << 8) | data[i + 3]) : (data[i + 2] | (data[i + 3] << 8));
+			if (lowSurrogate >= 0xDC00 && lowSurrogate < 0xE000)
+			{
+				codeUnit = 0x10000 + ((codeUnit - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+				i += 2;
+			}
+		}
+
+		appendUTF8(res, codeUnit);
+	}
+
+	return res;
+}
+
+std::string trimTrailing(std::string str, const char* chars)
+{
+	str.erase(str.find_last_not_of(chars) + 1);
+	return str;
+}
+
+/*
+ * ID3
+ */
+
+enum class Id3Encoding
+{
+	Latin1		= 0,
+	UTF16		= 1,
+	UTF16BE		= 2,
+	UTF8		= 3,
+};
+
+// Returns the position of the first string terminator at or after offset, or size if there is none
+std::size_t findId3Terminator(Id3Encoding encoding, const unsigned char* data, std::size_t size, std::size_t offset)
+{
+	if (encoding == Id3Encoding::UTF16 || encoding == Id3Encoding::UTF16BE)
+	{
+		for (std::size_t i = offset; i + 1 < size; i += 2)
+		{
+			if (data[i] == 0 && data[i + 1] == 0)
+				return i;
+		}
+		return size;
+	}
+
+	for (std::size_t i = offset; i < size; ++i)
+	{
+		if (data[i] == 0)
+			return i;
+	}
+	return size;
+}
+
+std::size_t getId3TerminatorSize(Id3Encoding encoding)
+{
+	return (encoding == Id3Encoding::UTF16 || encoding == Id3Encoding::UTF16BE) ? 2 : 1;
+}
+
+std::string decodeId3String(Id3Encoding encoding, const unsigned char* data, std::size_t size)
+{
+	switch (encoding)
+	{
+		case Id3Encoding::Latin1:	return latin1ToUTF8(data, size);
+		case Id3Encoding::UTF16:	return utf16ToUTF8(data, size, false);
+		case Id3Encoding::UTF16BE:	return utf16ToUTF8(data, size, true);
+		case Id3Encoding::UTF8:		return std::string(data, data + size);
+	}
+
+	throw HeaderError("bad text encoding");
+}
+
+// Genre references, as "(17)", "17" or "(17)Rock", are replaced by the genre name as libav does
+bool convertId3Genre(std::string& genre)
+{
+	std::size_t index;
+	std::istringstream iss(genre);
+	if (genre.size() > 0 && genre[0] == '(')
+		iss.ignore(1);
+
+	if (!(iss >> index))
+		return true;
+
+	if (index >= id3v1Genres.size())
+		return false;
+
+	genre = id3v1Genres[index];
+	return true;
+}
+
+// libav names for the ID3v2 text frames, the other ones keep their frame ID
+const std::map<std::string, std::string> id3v2FrameNames =
+{
+	// ID3v2.3 and 2.4
+	{"TALB", "album"}, {"TCOM", "composer"}, {"TCON", "genre"}, {"TCOP", "copyright"},
+	{"TENC", "encoded_by"}, {"TIT2", "title"}, {"TLAN", "language"}, {"TPE1", "artist"},
+	{"TPE2", "album_artist"}, {"TPE3", "performer"}, {"TPOS", "disc"}, {"TPUB", "publisher"},
+	{"TRCK", "track"}, {"TSSE", "encoder"}, {"TDRC", "date"}, {"TYER", "date"},
+
+	// ID3v2.2
+	{"TAL", "album"}, {"TCM", "composer"}, {"TCO", "genre"}, {"TT2", "title"},
+	{"TEN", "encoded_by"}, {"TLA", "language"}, {"TP1", "artist"}, {"TP2", "album_artist"},
+	{"TP3", "performer"}, {"TPA", "disc"}, {"TPB", "publisher"}, {"TRK", "track"},
+	{"TYE", "date"},
+};
+
+void parseId3v2TextFrame(const std::string& frameId, const Buffer& content, std::map<std::string, std::string>& tags)
+{
+	if (content.empty() || content[0] > 3)
+		return;
+
+	const Id3Encoding encoding = static_cast<Id3Encoding>(content[0]);
+	const unsigned char* data = content.data() + 1;
+	const std::size_t size = content.size() - 1;
+
+	std::string key;
+	std::size_t valueStart = 0;
+
+	if (frameId == "TXXX" || frameId == "TXX")
+	{
+		std::size_t descEnd = findId3Terminator(encoding, data, size, 0);
+		if (descEnd == size)
+			return;
+
+		key = decodeId3String(encoding, data, descEnd);
+		valueStart = descEnd + getId3TerminatorSize(encoding);
+	}
+	else
+	{
+		auto itName = id3v2FrameNames.find(frameId);
+		key = (itName != id3v2FrameNames.end()) ? itName->second : frameId;
+	}
+
+	// First value only
+	const std::size_t valueEnd = findId3Terminator(encoding, data, size, valueStart);
+	std::string value = decodeId3String(encoding, data + valueStart, valueEnd - valueStart);
+
+	if (key.empty() || value.empty())
+		return;
+
+	if (key == "genre" && !convertId3Genre(value))
+		throw HeaderError("unknown genre reference");
+
+	tags[key] = value;
+}
+
+Buffer readId3v2FrameContent(FileReader& reader, uint64_t offset, uint64_t frameSize, unsigned version, unsigned frameFlags)
+{
+	const bool compressed = (version == 3) ? (frameFlags & 0xC0) : (frameFlags & 0x0C);
+	if (compressed)
+		throw HeaderError("compressed or encrypted ID3v2 frame");
+
+	Buffer content = reader.readAt(offset, frameSize);
+
+	// Fields added before the frame data: grouping identity, then data length indicator (ID3v2.4)
+	std::size_t extraSize = 0;
+	if ((version == 3 && (frameFlags & 0x20)) || (version == 4 && (frameFlags & 0x40)))
+		extraSize += 1;
+	if (version == 4 && (frameFlags & 0x01))
+		extraSize += 4;
+
+	if (content.size() < extraSize)
+		throw HeaderError("bad ID3v2 frame");
+	content.erase(content.begin(), content.begin() + extraSize);
+
+	if (version == 4 && (frameFlags & 0x02))
+	{
+		// Frame unsynchronisation: 0xFF 0x00 stands for 0xFF
+		Buffer decoded;
+		for (std::size_t i = 0; i < content.size(); ++i)
+		{
+			decoded.push_back(content[i]);
+			if (content[i] == 0xFF && i + 1 < content.size() && content[i + 1] == 0x00)
+				++i;
+		}
+		content.swap(decoded);
+	}
+
+	return content;
+}
+
+// Keeps the first picture, unless a front cover shows up later
+// Returns true if the picture is a front cover
+bool parseId3v2PictureFrame(const std::string& frameId, const Buffer& content, Buffer& cover)
+{
+	if (content.empty() || content[0] > 3)
+		return false;
+
+	const Id3Encoding encoding = static_cast<Id3Encoding>(content[0]);
+	std::size_t offset = 1;
+
+	// Mime type (APIC) or image format (PIC)
+	if (frameId == "APIC")
+		offset = findId3Terminator(Id3Encoding::Latin1, content.data(), content.size(), offset) + 1;
+	else
+		offset += 3;
+
+	if (offset >= content.size())
+		return false;
+
+	const bool frontCover = (content[offset] == 0x03);
+	offset += 1;
+
+	// Description
+	offset = findId3Terminator(encoding, content.data(), content.size(), offset) + getId3TerminatorSize(encoding);
+
+	if (offset >= content.size())
+		return false;
+
+	if (cover.empty() || frontCover)
+		cover.assign(content.begin() + offset, content.end());
+
+	return frontCover;
+}
+
+// Returns the end of the tag, 0 if there is no tag
+uint64_t parseId3v2(FileReader& reader, HeaderInfo& info)
+{
+	if (reader.size() < 10)
+		return 0;
+
+	const Buffer header = reader.readAt(0, 10);
+	if (std::memcmp(header.data(), "ID3", 3) != 0)
+		return 0;
+
+	const unsigned version = header[3];
+	const unsigned flags = header[5];
+	const uint64_t tagEnd = 10 + readSyncSafe(&header[6]) + ((version == 4 && (flags & 0x10)) ? 10 : 0);
+
+	if (version < 2 || version > 4)
+		throw HeaderError("unsupported ID3v2 version");
+
+	// Whole tag unsynchronisation is rare, let libav handle it
+	if (version < 4 && (flags & 0x80))
+		throw HeaderError("unsynchronised ID3v2 tag");
+
+	uint64_t offset = 10;
+
+	// Extended header
+	if (flags & 0x40 && version >= 3)
+	{
+		const Buffer extHeader = reader.readAt(offset, 4);
+		offset += (version == 3) ? 4 + readBE(extHeader.data(), 4) : readSyncSafe(extHeader.data());
+	}
+
+	const std::size_t frameIdSize = (version == 2) ? 3 : 4;
+	const std::size_t frameHeaderSize = (version == 2) ? 6 : 10;
+	const uint64_t framesEnd = 10 + readSyncSafe(&header[6]);
+
+	std::string date;
+	std::string dayMonth;
+	bool hasFrontCover = false;
+
+	while (offset + frameHeaderSize <= framesEnd)
+	{
+		const Buffer frameHeader = reader.readAt(offset, frameHeaderSize);
+
+		// Padding
+		if (frameHeader[0] == 0)
+			break;
+
+		const std::string frameId(frameHeader.begin(), frameHeader.begin() + frameIdSize);
+
+		uint64_t frameSize;
+		unsigned frameFlags = 0;
+		switch (version)
+		{
+			case 2: frameSize = readBE(&frameHeader[3], 3); break;
+			case 3: frameSize = readBE(&frameHeader[4], 4); frameFlags = frameHeader[9]; break;
+			default: frameSize = readSyncSafe(&frameHeader[4]); frameFlags = frameHeader[9]; break;
+		}
+
+		offset += frameHeaderSize;
+		if (offset + frameSize > framesEnd)
+			throw HeaderError("truncated ID3v2 frame");
+
+		if (frameId == "APIC" || frameId == "PIC")
+		{
+			info.hasCover = true;
+
+			if (!hasFrontCover && frameSize <= maxCoverSize)
+				hasFrontCover = parseId3v2PictureFrame(frameId, readId3v2FrameContent(reader, offset, frameSize, version, frameFlags), info.cover);
+		}
+		else if (frameId[0] == 'T' && frameSize <= maxTagSize)
+		{
+			const Buffer content = readId3v2FrameContent(reader, offset, frameSize, version, frameFlags);
+
+			// ID3v2.3 dates are split over two frames
+			if (frameId == "TDAT")
+			{
+				std::map<std::string, std::string> tags;
+				parseId3v2TextFrame(frameId, content, tags);
+				dayMonth = tags["TDAT"];
+			}
+			else if (frameId == "TDRL")
+			{
+				std::map<std::string, std::string> tags;
+				parseId3v2TextFrame(frameId, content, tags);
+				if (info.tags.find("date") == info.tags.end())
+					date = tags["TDRL"];
+			}
+			else
+				parseId3v2TextFrame(frameId, content, info.tags);
+		}
+
+		offset += frameSize;
+	}
+
+	if (!date.empty() && info.tags.find("date") == info.tags.end())
+		info.tags["date"] = date;
+
+	auto itDate = info.tags.find("date");
+	if (itDate != info.tags.end() && itDate->second.size() == 4 && dayMonth.size() == 4)
+		itDate->second += "-" + dayMonth.substr(2, 2) + "-" + dayMonth.substr(0, 2);
+
+	return tagEnd;
+}
+
+// Returns true if there is a tag
+bool parseId3v1(FileReader& reader, HeaderInfo& info, bool useTags)
+{
+	if (reader.size() < 128)
+		return false;
+
+	const Buffer tag = reader.readAt(reader.size() - 128, 128);
+	if (std::memcmp(tag.data(), "TAG", 3) != 0)
+		return false;
+
+	if (!useTags)
+		return true;
+
+	auto getString = [&](std::size_t offset, std::size_t size)
+	{
+		std::size_t end = offset;
+		while (end < offset + size && tag[end] != 0)
+			++end;
+
+		return trimTrailing(latin1ToUTF8(&tag[offset], end - offset), " ");
+	};
+
+	auto setTag = [&](const std::string& key, const std::string& value)
+	{
+		if (!value.empty())
+			info.tags[key] = value;
+	};
+
+	setTag("title", getString(3, 30));
+	setTag("artist", getString(33, 30));
+	setTag("album", getString(63, 30));
+	setTag("date", getString(93, 4));
+	setTag("comment", getString(97, tag[125] == 0 ? 28 : 30));
+
+	if (tag[125] == 0 && tag[126] != 0)
+		setTag("track", std::to_string(tag[126]));
+
+	if (tag[127] != 0xFF)
+	{
+		if (tag[127] >= id3v1Genres.size())
+			throw HeaderError("unknown ID3v1 genre");
+
+		setTag("genre", id3v1Genres[tag[127]]);
+	}
+
+	return true;
+}
+
+/*
+ * MPEG audio
+ */
+
+struct MpegFrame
+{
+	unsigned	version;	// 1, 2 or 25 (2.5)
+	unsigned	layer;
+	unsigned	bitrate;	// bits per second
+	unsigned	sampleRate;
+	unsigned	nbChannels;
+	unsigned	samplesPerFrame;
+	unsigned	frameSize;
+};
+
+bool parseMpegFrameHeader(const unsigned char* header, MpegFrame& frame)
+{
+	static const unsigned bitrates[5][15] =
+	{
+		{0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},	// V1 L1
+		{0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},	// V1 L2
+		{0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},	// V1 L3
+		{0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},	// V2 L1
+		{0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},		// V2 L2 & L3
+	};
+
+	static const unsigned sampleRates[3][3] =
+	{
+		{44100, 48000, 32000},	// V1
+		{22050, 24000, 16000},	// V2
+		{11025, 12000, 8000},	// V2.5
+	};
+
+	if (header[0] != 0xFF || (header[1] & 0xE0) != 0xE0)
+		return false;
+
+	const unsigned versionBits = (header[1] >> 3) & 0x03;
+	const unsigned layerBits = (header[1] >> 1) & 0x03;
+	const unsigned bitrateIndex = header[2] >> 4;
+	const unsigned sampleRateIndex = (header[2] >> 2) & 0x03;
+	const unsigned padding = (header[2] >> 1) & 0x01;
+
+	// Reserved values, free format
+	if (versionBits == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || sampleRateIndex == 3)
+		return false;
+
+	frame.version = (versionBits == 3) ? 1 : (versionBits == 2 ? 2 : 25);
+	frame.layer = 4 - layerBits;
+	frame.nbChannels = ((header[3] >> 6) == 3) ? 1 : 2;
+	frame.sampleRate = sampleRates[frame.version == 1 ? 0 : (frame.version == 2 ? 1 : 2)][sampleRateIndex];
+
+	const std::size_t bitrateTable = (frame.version == 1) ? frame.layer - 1 : (frame.layer == 1 ? 3 : 4);
+	frame.bitrate = bitrates[bitrateTable][bitrateIndex] * 1000;
+
+	if (frame.layer == 1)
+	{
+		frame.samplesPerFrame = 384;
+		frame.frameSize = (12 * frame.bitrate / frame.sampleRate + padding) * 4;
+	}
+	else
+	{
+		frame.samplesPerFrame = (frame.layer == 3 && frame.version != 1) ? 576 : 1152;
+		frame.frameSize = frame.samplesPerFrame / 8 * frame.bitrate / frame.sampleRate + padding;
+	}
+
+	return true;
+}
+
+bool parseMpeg(FileReader& reader, uint64_t audioStart, HeaderInfo& info)
+{
+	uint64_t audioEnd = reader.size();
+
+	const bool hasId3v1 = parseId3v1(reader, info, info.tags.empty());
+	if (hasId3v1)
+		audioEnd -= 128;
+
+	// libav would also read the APE tags
+	if (audioEnd >= 32 && std::memcmp(reader.readAt(audioEnd - 32, 8).data(), "APETAGEX", 8) == 0)
+		return false;
+
+	// Skip the padding that may follow the ID3v2 tag
+	static const std::size_t maxPaddingSize = 4096;
+	const Buffer start = reader.readAt(audioStart, std::min<uint64_t>(maxPaddingSize + 4, audioEnd - audioStart));
+
+	std::size_t frameOffset = 0;
+	while (frameOffset < start.size() && start[frameOffset] == 0)
+		++frameOffset;
+
+	MpegFrame frame;
+	if (frameOffset + 4 > start.size() || !parseMpegFrameHeader(&start[frameOffset], frame))
+		return false;
+
+	const uint64_t firstFrameStart = audioStart + frameOffset;
+
+	// Make sure this is not a false sync: the next frame must follow
+	if (firstFrameStart + frame.frameSize + 4 <= audioEnd)
+	{
+		const Buffer nextHeader = reader.readAt(firstFrameStart + frame.frameSize, 4);
+
+		MpegFrame nextFrame;
+		if (!parseMpegFrameHeader(nextHeader.data(), nextFrame)
+				|| nextFrame.version != frame.version
+				|| nextFrame.layer != frame.layer
+				|| nextFrame.sampleRate != frame.sampleRate)
+			return false;
+	}
+
+	// Xing/Info or VBRI header in the first frame, for VBR files
+	uint64_t nbFrames = 0;
+	{
+		const Buffer firstFrame = reader.readAt(firstFrameStart, std::min<uint64_t>(frame.frameSize, audioEnd - firstFrameStart));
+
+		const std::size_t sideInfoSize = (frame.version == 1) ? (frame.nbChannels == 1 ? 17 : 32) : (frame.nbChannels == 1 ? 9 : 17);
+		const std::size_t xingOffset = 4 + sideInfoSize;
+		const std::size_t vbriOffset = 4 + 32;
+
+		if (firstFrame.size() >= xingOffset + 12
+				&& (std::memcmp(&firstFrame[xingOffset], "Xing", 4) == 0 || std::memcmp(&firstFrame[xingOffset], "Info", 4) == 0))
+		{
+			if (readBE(&firstFrame[xingOffset + 4], 4) & 0x01)
+				nbFrames = readBE(&firstFrame[xingOffset + 8], 4);
+		}
+		else if (firstFrame.size() >= vbriOffset + 18 && std::memcmp(&firstFrame[vbriOffset], "VBRI", 4) == 0)
+		{
+			nbFrames = readBE(&firstFrame[vbriOffset + 14], 4);
+		}
+	}
+
+	double durationSeconds;
+	if (nbFrames > 0)
+	{
+		durationSeconds = static_cast<double>(nbFrames) * frame.samplesPerFrame / frame.sampleRate;
+		info.audioBitrate = durationSeconds > 0 ? static_cast<std::size_t>((audioEnd - firstFrameStart) * 8 / durationSeconds) : 0;
+	}
+	else
+	{
+		// Constant bitrate, estimated as libav does
+		durationSeconds = static_cast<double>(audioEnd - firstFrameStart) * 8 / frame.bitrate;
+		info.audioBitrate = frame.bitrate;
+	}
+
+	info.duration = boost::posix_time::seconds(static_cast<long>(durationSeconds));
+
+	std::ostringstream oss;
+	oss << "Audio: " << (frame.layer == 3 ? "mp3" : (frame.layer == 2 ? "mp2" : "mp1")) << ", " << frame.sampleRate << " Hz, "
+		<< (frame.nbChannels == 1 ? "mono" : "stereo") << ", " << info.audioBitrate / 1000 << " kb/s";
+	info.audioStreamDesc = oss.str();
+
+	return true;
+}
+
+/*
+ * FLAC
+ */
+
+// libav names for some Vorbis comments
+const std::map<std::string, std::string> vorbisCommentNames =
+{
+	{"ALBUMARTIST", "album_artist"},
+	{"TRACKNUMBER", "track"},
+	{"DISCNUMBER", "disc"},
+	{"DESCRIPTION", "comment"},
+};
+
+void parseVorbisComments(const Buffer& block, std::map<std::string, std::string>& tags)
+{
+	std::size_t offset = 0;
+
+	auto readSize = [&]()
+	{
+		if (offset + 4 > block.size())
+			throw HeaderError("truncated Vorbis comments");
+
+		uint32_t size = readLE32(&block[offset]);
+		offset += 4;
+
+		if (size > block.size() - offset)
+			throw HeaderError("truncated Vorbis comments");
+
+		return size;
+	};
+
+	// Vendor
+	offset += readSize();
+
+	if (offset + 4 > block.size())
+		throw HeaderError("truncated Vorbis comments");
+
+	const uint32_t nbComments = readLE32(&block[offset]);
+	offset += 4;
+
+	for (uint32_t i = 0; i < nbComments; ++i)
+	{
+		const uint32_t size = readSize();
+		const std::string comment(&block[offset], &block[offset] + size);
+		offset += size;
+
+		const std::size_t separator = comment.find('=');
+		if (separator == std::string::npos || separator == 0)
+			continue;
+
+		std::string key = comment.substr(0, separator);
+		const std::string value = comment.substr(separator + 1);
+
+		std::string upperKey = key;
+		for (char& c : upperKey)
+			c = std::toupper(static_cast<unsigned char>(c));
+
+		auto itName = vorbisCommentNames.find(upperKey);
+		if (itName != vorbisCommentNames.end())
+			key = itName->second;
+
+		// Multiple values are joined, as libav does
+		auto itTag = tags.find(key);
+		if (itTag != tags.end())
+			itTag->second += ";" + value;
+		else
+			tags[key] = value;
+	}
+}
+
+void parseFlacPicture(const Buffer& block, Buffer& cover)
+{
+	// Picture type, then length prefixed mime type and description
+	std::size_t offset = 4;
+	for (int i = 0; i < 2; ++i)
+	{
+		if (offset + 4 > block.size())
+			return;
+		offset += 4 + readBE(&block[offset], 4);
+	}
+
+	// Width, height, depth, number of colors and data length
+	offset += 16;
+	if (offset + 4 > block.size())
+		return;
+
+	const uint64_t dataSize = readBE(&block[offset], 4);
+	offset += 4;
+	if (dataSize == 0 || offset + dataSize > block.size())
+		return;
+
+	cover.assign(block.begin() + offset, block.begin() + offset + dataSize);
+}
+
+bool parseFlac(FileReader& reader, uint64_t offset, HeaderInfo& info)
+{
+	if (std::memcmp(reader.readAt(offset, 4).data(), "fLaC", 4) != 0)
+		return false;
+
+	offset += 4;
+
+	uint64_t totalSamples = 0;
+	unsigned sampleRate = 0;
+	unsigned nbChannels = 0;
+
+	bool lastBlock = false;
+	while (!lastBlock)
+	{
+		const Buffer blockHeader = reader.readAt(offset, 4);
+		lastBlock = blockHeader[0] & 0x80;
+
+		const unsigned blockType = blockHeader[0] & 0x7F;
+		const uint64_t blockSize = readBE(&blockHeader[1], 3);
+
+		offset += 4;
+
+		switch (blockType)
+		{
+			case 0:	// STREAMINFO
+			{
+				const Buffer streamInfo = reader.readAt(offset, 34);
+				sampleRate = (streamInfo[10] << 12) | (streamInfo[11] << 4) | (streamInfo[12] >> 4);
+				nbChannels = ((streamInfo[12] >> 1) & 0x07) + 1;
+				totalSamples = (static_cast<uint64_t>(streamInfo[13] & 0x0F) << 32) | readBE(&streamInfo[14], 4);
+				break;
+			}
+
+			case 4:	// VORBIS_COMMENT
+				if (blockSize > maxTagSize)
+					throw HeaderError("Vorbis comments too large");
+				parseVorbisComments(reader.readAt(offset, blockSize), info.tags);
+				break;
+
+			case 6:	// PICTURE
+				info.hasCover = true;
+				if (info.cover.empty() && blockSize <= maxCoverSize)
+					parseFlacPicture(reader.readAt(offset, blockSize), info.cover);
+				break;
+
+			default:
+				break;
+		}
+
+		offset += blockSize;
+	}
+
+	// Unknown length
+	if (sampleRate == 0 || totalSamples == 0)
+		return false;
+
+	const double durationSeconds = static_cast<double>(totalSamples) / sampleRate;
+
+	info.duration = boost::posix_time::seconds(static_cast<long>(durationSeconds));
+	info.audioBitrate = static_cast<std::size_t>((reader.size() - offset) * 8 / durationSeconds);
+
+	std::ostringstream oss;
+	oss << "Audio: flac, " << sampleRate << " Hz, " << (nbChannels == 1 ? "mono" : (nbChannels == 2 ? "stereo" : std::to_string(nbChannels) + " channels"))
+		<< ", " << info.audioBitrate / 1000 << " kb/s";
+	info.audioStreamDesc = oss.str();
+
+	return true;
+}
+
+/*
+ * MP4
+ */
+
+struct Mp4Context
+{
+	uint64_t	timeScale = 0;
+	uint64_t	duration = 0;
+	std::string	audioCodec;
+	unsigned	sampleRate = 0;
+	unsigned	nbChannels = 0;
+	bool		hasVideo = false;
+};
+
+// Calls the visitor for each atom in [start, end), with its type and the bounds of its content
+void visitMp4Atoms(FileReader& reader, uint64_t start, uint64_t end,
+		std::function<void(const std::string& type, uint64_t contentStart, uint64_t contentEnd)> visitor)
+{
+	uint64_t offset = start;
+	while (offset + 8 <= end)
+	{
+		const Buffer header = reader.readAt(offset, 8);
+		const std::string type(header.begin() + 4, header.end());
+
+		uint64_t size = readBE(header.data(), 4);
+		uint64_t headerSize = 8;
+
+		if (size == 1)
+		{
+			size = readBE(reader.readAt(offset + 8, 8).data(), 8);
+			headerSize = 16;
+		}
+		else if (size == 0)
+			size = end - offset;
+
+		if (size < headerSize || size > end - offset)
+			throw HeaderError("bad MP4 atom size");
+
+		visitor(type, offset + headerSize, offset + size);
+
+		offset += size;
+	}
+}
+
+// libav names for the iTunes metadata items
+const std::map<std::string, std::string> mp4ItemNames =
+{
+	{"\xA9nam", "title"},
+	{"\xA9" "ART", "artist"},
+	{"aART", "album_artist"},
+	{"\xA9" "alb", "album"},
+	{"\xA9gen", "genre"},
+	{"\xA9" "day", "date"},
+	{"\xA9wrt", "composer"},
+	{"\xA9too", "encoder"},
+	{"\xA9" "cmt", "comment"},
+};
+
+void parseMp4Item(FileReader& reader, const std::string& type, uint64_t start, uint64_t end, HeaderInfo& info)
+{
+	if (type == "covr")
+	{
+		info.hasCover = true;
+
+		// First picture only
+		if (end - start <= maxCoverSize)
+		{
+			visitMp4Atoms(reader, start, end, [&](const std::string& childType, uint64_t childStart, uint64_t childEnd)
+			{
+				if (childType == "data" && info.cover.empty() && childEnd - childStart > 8)
+					info.cover = reader.readAt(childStart + 8, childEnd - childStart - 8);
+			});
+		}
+		return;
+	}
+
+	if (end - start > maxTagSize)
+		return;
+
+	std::string name;
+	Buffer value;
+	bool hasValue = false;
+
+	visitMp4Atoms(reader, start, end, [&](const std::string& childType, uint64_t childStart, uint64_t childEnd)
+	{
+		if (childType == "name" && childEnd - childStart >= 4)
+		{
+			const Buffer content = reader.readAt(childStart + 4, childEnd - childStart - 4);
+			name.assign(content.begin(), content.end());
+		}
+		else if (childType == "data" && !hasValue && childEnd - childStart >= 8)
+		{
+			value = reader.readAt(childStart + 8, childEnd - childStart - 8);
+			hasValue = true;
+		}
+	});
+
+	if (!hasValue)
+		return;
+
+	auto setNumberPair = [&](const std::string& key)
+	{
+		if (value.size() < 6)
+			return;
+
+		const unsigned number = readBE(&value[2], 2);
+		const unsigned total = readBE(&value[4], 2);
+		if (number > 0)
+			info.tags[key] = std::to_string(number) + (total > 0 ? "/" + std::to_string(total) : "");
+	};
+
+	if (type == "trkn")
+		setNumberPair("track");
+	else if (type == "disk")
+		setNumberPair("disc");
+	else if (type == "gnre")
+	{
+		if (value.size() < 2)
+			return;
+
+		const uint64_t genre = readBE(value.data(), 2);
+		if (genre == 0 || genre > id3v1Genres.size())
+			throw HeaderError("unknown MP4 genre");
+
+		info.tags["genre"] = id3v1Genres[genre - 1];
+	}
+	else if (type == "----")
+	{
+		if (!name.empty())
+			info.tags[name] = std::string(value.begin(), value.end());
+	}
+	else
+	{
+		auto itName = mp4ItemNames.find(type);
+		if (itName != mp4ItemNames.end())
+			info.tags[itName->second] = std::string(value.begin(), value.end());
+	}
+}
+
+void parseMp4Meta(FileReader& reader, uint64_t start, uint64_t end, HeaderInfo& info)
+{
+	// Full atom, except in some QuickTime files
+	if (end - start >= 8 && std::memcmp(reader.readAt(start + 4, 4).data(), "hdlr", 4) != 0)
+		start += 4;
+
+	visitMp4Atoms(reader, start, end, [&](const std::string& type, uint64_t childStart, uint64_t childEnd)
+	{
+		if (type == "ilst")
+		{
+			visitMp4Atoms(reader, childStart, childEnd, [&](const std::string& itemType, uint64_t itemStart, uint64_t itemEnd)
+			{
+				parseMp4Item(reader, itemType, itemStart, itemEnd, info);
+			});
+		}
+	});
+}
+
+void parseMp4Track(FileReader& reader, uint64_t start, uint64_t end, Mp4Context& context)
+{
+	std::string handlerType;
+	std::string format;
+	unsigned nbChannels = 0;
+	unsigned sampleRate = 0;
+
+	std::function<void(const std::string&, uint64_t, uint64_t)> visitor = [&](const std::string& type, uint64_t childStart, uint64_t childEnd)
+	{
+		if (type == "mdia" || type == "minf" || type == "stbl")
+			visitMp4Atoms(reader, childStart, childEnd, visitor);
+		else if (type == "hdlr" && childEnd - childStart >= 12)
+		{
+			const Buffer content = reader.readAt(childStart + 8, 4);
+			handlerType.assign(content.begin(), content.end());
+		}
+		else if (type == "stsd" && childEnd - childStart >= 8 + 8 + 28)
+		{
+			// First sample entry
+			const Buffer entry = reader.readAt(childStart + 8, 8 + 28);
+			format.assign(entry.begin() + 4, entry.begin() + 8);
+			nbChannels = readBE(&entry[24], 2);
+			sampleRate = readBE(&entry[32], 2);
+		}
+	};
+
+	visitMp4Atoms(reader, start, end, visitor);
+
+	if (handlerType == "vide")
+		context.hasVideo = true;
+	else if (handlerType == "soun" && context.audioCodec.empty())
+	{
+		if (format == "mp4a")
+			context.audioCodec = "aac";
+		else if (format == "alac")
+			context.audioCodec = "alac";
+		else
+			context.audioCodec = format;
+
+		context.nbChannels = nbChannels;
+		context.sampleRate = sampleRate;
+	}
+}
+
+bool parseMp4(FileReader& reader, HeaderInfo& info)
+{
+	Mp4Context context;
+	bool hasMovie = false;
+
+	visitMp4Atoms(reader, 0, reader.size(), [&](const std::string& type, uint64_t start, uint64_t end)
+	{
+		if (type != "moov")
+			return;
+
+		hasMovie = true;
+
+		visitMp4Atoms(reader, start, end, [&](const std::string& childType, uint64_t childStart, uint64_t childEnd)
+		{
+			if (childType == "mvhd" && childEnd - childStart >= 32)
+			{
+				const Buffer content = reader.readAt(childStart, 32);
+				if (content[0] == 1)
+				{
+					context.timeScale = readBE(&content[20], 4);
+					context.duration = readBE(&content[24], 8);
+				}
+				else
+				{
+					context.timeScale = readBE(&content[12], 4);
+					context.duration = readBE(&content[16], 4);
+				}
+			}
+			else if (childType == "trak")
+				parseMp4Track(reader, childStart, childEnd, context);
+			else if (childType == "meta")
+				parseMp4Meta(reader, childStart, childEnd, info);
+			else if (childType == "udta")
+			{
+				visitMp4Atoms(reader, childStart, childEnd, [&](const std::string& udtaType, uint64_t udtaStart, uint64_t udtaEnd)
+				{
+					if (udtaType == "meta")
+						parseMp4Meta(reader, udtaStart, udtaEnd, info);
+				});
+			}
+		});
+	});
+
+	// Video files need the full probe, fragmented files have no global duration
+	if (!hasMovie || context.hasVideo || context.audioCodec.empty() || context.timeScale == 0 || context.duration == 0)
+		return false;
+
+	const double durationSeconds = static_cast<double>(context.duration) / context.timeScale;
+
+	info.duration = boost::posix_time::seconds(static_cast<long>(durationSeconds));
+	info.audioBitrate = static_cast<std::size_t>(reader.size() * 8 / durationSeconds);
+
+	std::ostringstream oss;
+	oss << "Audio: " << context.audioCodec << ", " << context.sampleRate << " Hz, "
+		<< (context.nbChannels == 1 ? "mono" : (context.nbChannels == 2 ? "stereo" : std::to_string(context.nbChannels) + " channels"))
+		<< ", " << info.audioBitrate / 1000 << " kb/s";
+	info.audioStreamDesc = oss.str();
+
+	return true;
+}
+
+} // namespace
+
+bool
+parseHeaders(const boost::filesystem::path& p, HeaderInfo& info)
+{
+	try
+	{
+		FileReader reader(p);
+
+		if (reader.size() >= 8 && std::memcmp(reader.readAt(4, 4).data(), "ftyp", 4) == 0)
+			return parseMp4(reader, info);
+
+		const uint64_t audioStart = parseId3v2(reader, info);
+
+		if (reader.size() - audioStart >= 4 && std::memcmp(reader.readAt(audioStart, 4).data(), "fLaC", 4) == 0)
+		{
+			// libav would merge both tags
+			if (audioStart > 0)
+				return false;
+
+			return parseFlac(reader, audioStart, info);
+		}
+
+		return parseMpeg(reader, audioStart, info);
+	}
+	catch (HeaderError& e)
+	{
+		return false;
+	}
+}
+
+} // namespace MetaData
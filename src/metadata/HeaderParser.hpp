@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef METADATA_HEADER_PARSER_HPP
+#define METADATA_HEADER_PARSER_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/filesystem/path.hpp>
+
+namespace MetaData
+{
+
+// Audio file info read straight from the file headers
+// Tags are named as libav does, so that they can be handled the same way
+struct HeaderInfo
+{
+	std::map<std::string, std::string>	tags;
+	boost::posix_time::time_duration	duration;
+	std::string				audioStreamDesc;
+	std::size_t				audioBitrate = 0;
+	bool					hasCover = false;
+	std::vector<unsigned char>		cover;	// embedded picture, front cover preferred
+};
+
+// Much cheaper than a libav probe: no frame is demuxed or decoded
+// Supports MP3 (ID3v2, ID3v1, Xing/VBRI or CBR duration), FLAC (STREAMINFO, Vorbis comments)
+// and MP4 audio files (iTunes atoms)
+// Returns false if the format is not supported or if the header data is not complete enough
+bool parseHeaders(const boost::filesystem::path& p, HeaderInfo& info);
+
+} // namespace MetaData
+
+#endif
@@ -20,36 +20,18 @@
 #ifndef METADATA_HPP
 #define METADATA_HPP
 
-#include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
-#include <boost/any.hpp>
+#include <boost/container/small_vector.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
 
 namespace MetaData
 {
 
-	enum class Type
-	{
-		Artist,			// string
-		Title,			// string
-		Album,			// string
-		Genres,			// list<string>
-		Duration,		// boost::posix_time::time_duration
-		TrackNumber,		// size_t
-		DiscNumber,		// size_t
-		TotalTrack,		// size_t
-		TotalDisc,		// size_t
-		Date,			// boost::posix_time::ptime
-		OriginalDate,		// boost::posix_time::ptime
-		HasCover,		// bool
-		AudioStreams,		// vector<AudioStream>
-		VideoStreams,		// vector<VideoStream>
-		SubtitleStreams,	// vector<SubtitleStream>
-		MusicBrainzArtistID,	// string
-		MusicBrainzAlbumID,	// string
-		MusicBrainzTrackID,	// string
-	};
-
 	// Used by Streams
 	struct AudioStream
 	{
@@ -68,9 +50,38 @@ namespace MetaData
 		std::string desc;
 	};
 
-	// Type and associated data
-	// See enum Type's comments
-	typedef std::map<Type, boost::any>  Items;
+	// Most files have a single stream and a couple of genres: keep them inline
+	typedef boost::container::small_vector<AudioStream, 1>		AudioStreams;
+	typedef boost::container::small_vector<VideoStream, 1>		VideoStreams;
+	typedef boost::container::small_vector<SubtitleStream, 1>	SubtitleStreams;
+	typedef boost::container::small_vector<std::string, 2>		Genres;
+
+	// Parsed file metadata, filled in place by the parser
+	// Empty strings and unset optionals stand for missing tags
+	struct Items
+	{
+		std::string			artist;
+		std::string			title;
+		std::string			album;
+		Genres				genres;
+		boost::posix_time::time_duration	duration;
+		boost::optional<std::size_t>	trackNumber;
+		boost::optional<std::size_t>	discNumber;
+		boost::optional<std::size_t>	totalTrack;
+		boost::optional<std::size_t>	totalDisc;
+		boost::optional<boost::posix_time::ptime>	date;
+		boost::optional<boost::posix_time::ptime>	originalDate;
+		bool				hasCover = false;
+		std::vector<unsigned char>	cover;	// embedded picture data, may be empty even if hasCover
+		AudioStreams			audioStreams;
+		VideoStreams			videoStreams;
+		SubtitleStreams			subtitleStreams;
+		std::string			musicBrainzArtistID;
+		std::string			musicBrainzAlbumID;
+		std::string			musicBrainzTrackID;
+
+		void clear()	{ *this = Items(); }
+	};
 
 	class Parser
 	{
@@ -78,6 +89,8 @@ namespace MetaData
 
 			typedef std::shared_ptr<Parser> pointer;
 
+			virtual ~Parser() {}
+
 			virtual bool parse(const boost::filesystem::path& p, Items& items) = 0;
 
 	};
@@ -23,9 +23,8 @@
 
 namespace Service {
 
-DatabaseUpdateService::DatabaseUpdateService(Wt::Dbo::SqlConnectionPool &connectionPool)
-: _metadataParser(),
- _databaseUpdater( connectionPool, _metadataParser)
+DatabaseUpdateService::DatabaseUpdateService(Wt::Dbo::SqlConnectionPool &connectionPool, bool headerParsing)
+: _databaseUpdater( connectionPool, [headerParsing] { return std::make_shared<MetaData::AvFormat>(headerParsing); })
 {
 }
 
@@ -48,5 +47,28 @@ DatabaseUpdateService::restart(void)
 	start();
 }
 
-} // namespace Service
+void
+DatabaseUpdateService::updatePaths(const std::vector<boost::filesystem::path>& paths)
+{
+	_databaseUpdater.updatePaths(paths);
+}
 
+DatabaseUpdater::ScanProgress
+DatabaseUpdateService::getProgress() const
+{
+	return _databaseUpdater.getProgress();
+}
+
+std::size_t
+DatabaseUpdateService::addProgressListener(DatabaseUpdater::Updater::ProgressListener listener)
+{
+	return _databaseUpdater.addProgressListener(listener);
+}
+
+void
+DatabaseUpdateService::removeProgressListener(std::size_t id)
+{
+	_databaseUpdater.removeProgressListener(id);
+}
+
+} // namespace Service
@@ -36,16 +36,24 @@ class DatabaseUpdateService : public Service
 
 		typedef std::shared_ptr<DatabaseUpdateService>	pointer;
 
-		DatabaseUpdateService(Wt::Dbo::SqlConnectionPool &connectionPool);
+		// headerParsing: see MetaData::AvFormat
+		DatabaseUpdateService(Wt::Dbo::SqlConnectionPool &connectionPool, bool headerParsing);
 
 		// Service interface
 		void start(void);
 		void stop(void);
 		void restart(void);
 
+		// Incremental update of changed files or directories
+		void updatePaths(const std::vector<boost::filesystem::path>& paths);
+
+		// Scan progress
+		DatabaseUpdater::ScanProgress getProgress() const;
+		std::size_t addProgressListener(DatabaseUpdater::Updater::ProgressListener listener);
+		void removeProgressListener(std::size_t id);
+
 	private:
 
-		MetaData::AvFormat			_metadataParser;
 		DatabaseUpdater::Updater		_databaseUpdater;	// Todo use handler
 };
 
@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "logger/Logger.hpp"
+#include "utils/Utils.hpp"
+#include "database/MediaDirectory.hpp"
+
+#include "MediaDirectoryWatchService.hpp"
+
+namespace Service {
+
+// Events are flushed once nothing happened for quietDelay, or at most maxDelay after the first one
+static const std::chrono::seconds quietDelay(2);
+static const std::chrono::seconds maxDelay(10);
+static const int pollTimeoutMs = 500;
+
+static const uint32_t watchMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+MediaDirectoryWatchService::MediaDirectoryWatchService(Wt::Dbo::SqlConnectionPool& connectionPool, DatabaseUpdateService::pointer updateService)
+: _updateService(updateService),
+ _db(connectionPool),
+ _running(false),
+ _fd(-1)
+{
+}
+
+MediaDirectoryWatchService::~MediaDirectoryWatchService()
+{
+	stop();
+}
+
+void
+MediaDirectoryWatchService::start(void)
+{
+	if (_running)
+		return;
+
+	_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_fd < 0)
+	{
+		LMS_LOG(SERVICE, ERROR) << "Cannot init inotify: " << strerror(errno);
+		return;
+	}
+
+	_rootDirectories.clear();
+	{
+		Wt::Dbo::Transaction transaction(_db.getSession());
+
+		for (Database::MediaDirectory::pointer directory : Database::MediaDirectory::getAll(_db.getSession()))
+			_rootDirectories.push_back(directory->getPath());
+	}
+
+	for (const boost::filesystem::path& rootDirectory : _rootDirectories)
+		addWatches(rootDirectory);
+
+	LMS_LOG(SERVICE, INFO) << "Watching " << _watches.size() << " directories";
+
+	_running = true;
+	_thread = boost::thread(boost::bind(&MediaDirectoryWatchService::run, this));
+}
+
+void
+MediaDirectoryWatchService::stop(void)
+{
+	if (!_running)
+		return;
+
+	_running = false;
+	_thread.join();
+
+	// Pending changes are lost, the next scan will catch them
+	_pendingPaths.clear();
+	_watches.clear();
+
+	::close(_fd);
+	_fd = -1;
+}
+
+void
+MediaDirectoryWatchService::restart(void)
+{
+	stop();
+	start();
+}
+
+void
+MediaDirectoryWatchService::addWatches(const boost::filesystem::path& directory)
+{
+	boost::system::error_code ec;
+
+	if (!boost::filesystem::is_directory(directory, ec))
+		return;
+
+	addWatch(directory);
+
+	boost::filesystem::recursive_directory_iterator itPath(directory, ec);
+	boost::filesystem::recursive_directory_iterator itEnd;
+	while (!ec && itPath != itEnd)
+	{
+		boost::filesystem::path path = *itPath;
+		itPath.increment(ec);
+
+		boost::system::error_code statusEc;
+		if (boost::filesystem::is_directory(path, statusEc))
+			addWatch(path);
+	}
+}
+
+void
+MediaDirectoryWatchService::addWatch(const boost::filesystem::path& directory)
+{
+	int wd = inotify_add_watch(_fd, directory.string().c_str(), watchMask);
+	if (wd < 0)
+	{
+		// ENOSPC: fs.inotify.max_user_watches is too low
+		LMS_LOG(SERVICE, ERROR) << "Cannot watch '" << directory << "': " << strerror(errno);
+		return;
+	}
+
+	_watches[wd] = directory;
+}
+
+void
+MediaDirectoryWatchService::removeWatches(const boost::filesystem::path& directory)
+{
+	for (auto it = _watches.begin(); it != _watches.end(); )
+	{
+		if (it->second == directory || isPathInParentPath(it->second, directory))
+		{
+			inotify_rm_watch(_fd, it->first);
+			it = _watches.erase(it);
+		}
+		else
+			++it;
+	}
+}
+
+void
+MediaDirectoryWatchService::run(void)
+{
+	while (_running)
+	{
+		struct pollfd pfd;
+		pfd.fd = _fd;
+		pfd.events = POLLIN;
+
+		int res = ::poll(&pfd, 1, pollTimeoutMs);
+		if (res < 0 && errno != EINTR)
+		{
+			LMS_LOG(SERVICE, ERROR) << "poll failed: " << strerror(errno);
+			break;
+		}
+
+		if (res > 0)
+			readEvents();
+
+		if (_pendingPaths.empty())
+			continue;
+
+		auto now = std::chrono::steady_clock::now();
+		if (now - _lastPendingEvent >= quietDelay || now - _firstPendingEvent >= maxDelay)
+			flushPendingPaths();
+	}
+}
+
+void
+MediaDirectoryWatchService::readEvents(void)
+{
+	alignas(struct inotify_event) char buffer[16384];
+
+	while (true)
+	{
+		ssize_t len = ::read(_fd, buffer, sizeof(buffer));
+		if (len <= 0)
+			break;
+
+		for (char* ptr = buffer; ptr < buffer + len; )
+		{
+			const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			const bool hadPendingPaths = !_pendingPaths.empty();
+			boost::filesystem::path changedPath;
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				LMS_LOG(SERVICE, WARNING) << "inotify queue overflow, updating all the media directories";
+				for (const boost::filesystem::path& rootDirectory : _rootDirectories)
+				{
+					_pendingPaths.insert(rootDirectory);
+					changedPath = rootDirectory;
+				}
+			}
+			else
+			{
+				auto itWatch = _watches.find(event->wd);
+				if (itWatch == _watches.end())
+					continue;
+
+				if (event->mask & IN_IGNORED)
+				{
+					_watches.erase(itWatch);
+					continue;
+				}
+
+				if (event->mask & IN_DELETE_SELF)
+					changedPath = itWatch->second;
+				else if (event->len > 0)
+					changedPath = itWatch->second / event->name;
+				else
+					continue;
+
+				if (event->mask & IN_ISDIR)
+				{
+					if (event->mask & (IN_CREATE | IN_MOVED_TO))
+						addWatches(changedPath);
+					else if (event->mask & IN_MOVED_FROM)
+						removeWatches(changedPath);
+				}
+				else if (event->mask & IN_CREATE)
+				{
+					// Wait for the file to be written
+					continue;
+				}
+
+				LMS_LOG(SERVICE, DEBUG) << "Change detected on '" << changedPath << "'";
+				_pendingPaths.insert(changedPath);
+			}
+
+			if (!changedPath.empty())
+			{
+				auto now = std::chrono::steady_clock::now();
+				if (!hadPendingPaths)
+					_firstPendingEvent = now;
+				_lastPendingEvent = now;
+			}
+		}
+	}
+}
+
+void
+MediaDirectoryWatchService::flushPendingPaths(void)
+{
+	// Sorted set: children come just after their parent directory, no need to update them twice
+	std::vector<boost::filesystem::path> paths;
+	for (const boost::filesystem::path& path : _pendingPaths)
+	{
+		if (!paths.empty() && isPathInParentPath(path, paths.back()))
+			continue;
+
+		paths.push_back(path);
+	}
+	_pendingPaths.clear();
+
+	LMS_LOG(SERVICE, INFO) << "Requesting update of " << paths.size() << " changed path(s)";
+	_updateService->updatePaths(paths);
+}
+
+} // namespace Service
+
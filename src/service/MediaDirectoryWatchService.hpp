@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEDIA_DIRECTORY_WATCH_SERVICE_HPP
+#define MEDIA_DIRECTORY_WATCH_SERVICE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <set>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+#include "database/DatabaseHandler.hpp"
+
+#include "DatabaseUpdateService.hpp"
+#include "Service.hpp"
+
+namespace Service {
+
+// Watches the media directories using inotify
+// Bursts of events are coalesced and the changed paths are handed to the database updater
+class MediaDirectoryWatchService : public Service
+{
+	public:
+
+		typedef std::shared_ptr<MediaDirectoryWatchService>	pointer;
+
+		MediaDirectoryWatchService(Wt::Dbo::SqlConnectionPool& connectionPool, DatabaseUpdateService::pointer updateService);
+		~MediaDirectoryWatchService();
+
+		// Service interface
+		void start(void);
+		void stop(void);
+		void restart(void);
+
+	private:
+
+		void run(void);
+
+		void addWatches(const boost::filesystem::path& directory);	// recursive
+		void addWatch(const boost::filesystem::path& directory);
+		void removeWatches(const boost::filesystem::path& directory);	// recursive
+
+		void readEvents(void);
+		void flushPendingPaths(void);
+
+		DatabaseUpdateService::pointer		_updateService;
+		Database::Handler			_db;
+
+		std::atomic<bool>			_running;
+		boost::thread				_thread;
+		int					_fd;
+
+		std::vector<boost::filesystem::path>	_rootDirectories;
+		std::map<int, boost::filesystem::path>	_watches;	// watch descriptor -> directory
+
+		std::set<boost::filesystem::path>	_pendingPaths;
+		std::chrono::steady_clock::time_point	_firstPendingEvent;
+		std::chrono::steady_clock::time_point	_lastPendingEvent;
+};
+
+} // namespace Service
+
+#endif
+
@@ -64,13 +64,13 @@ bool agentIsMobile()
 namespace UserInterface {
 
 Wt::WApplication*
-LmsApplication::create(const Wt::WEnvironment& env, Wt::Dbo::SqlConnectionPool& connectionPool)
+LmsApplication::create(const Wt::WEnvironment& env, Wt::Dbo::SqlConnectionPool& connectionPool, Wt::Dbo::SqlConnectionPool* readConnectionPool)
 {
 	/*
 	 * You could read information from the environment to decide whether
 	 * the user has permission to start a new application
 	 */
-	return new LmsApplication(env, connectionPool);
+	return new LmsApplication(env, connectionPool, readConnectionPool);
 }
 
 LmsApplication*
@@ -85,9 +85,9 @@ LmsApplication::instance()
  * constructor so it is typically also an argument for your custom
  * application constructor.
 */
-LmsApplication::LmsApplication(const Wt::WEnvironment& env, Wt::Dbo::SqlConnectionPool& connectionPool)
+LmsApplication::LmsApplication(const Wt::WEnvironment& env, Wt::Dbo::SqlConnectionPool& connectionPool, Wt::Dbo::SqlConnectionPool* readConnectionPool)
 : Wt::WApplication(env),
-  _db(connectionPool),
+  _db(connectionPool, readConnectionPool),
   _imageResource(nullptr),
   _transcodeResource(nullptr)
 {
@@ -128,6 +128,10 @@ Wt::Dbo::Session& DboSession()
 {
 	return DbHandler().getSession();
 }
+Wt::Dbo::Session& DboReadSession()
+{
+	return DbHandler().getReadSession();
+}
 
 const Wt::Auth::User& CurrentAuthUser()
 {
@@ -34,10 +34,10 @@ namespace UserInterface {
 class LmsApplication : public Wt::WApplication
 {
 	public:
-		static Wt::WApplication *create(const Wt::WEnvironment& env, Wt::Dbo::SqlConnectionPool& connectionPool);
+		static Wt::WApplication *create(const Wt::WEnvironment& env, Wt::Dbo::SqlConnectionPool& connectionPool, Wt::Dbo::SqlConnectionPool* readConnectionPool);
 		static LmsApplication* instance();
 
-		LmsApplication(const Wt::WEnvironment& env, Wt::Dbo::SqlConnectionPool& connectionPool);
+		LmsApplication(const Wt::WEnvironment& env, Wt::Dbo::SqlConnectionPool& connectionPool, Wt::Dbo::SqlConnectionPool* readConnectionPool);
 
 		// Session application data
 		ImageResource* getImageResource() { return _imageResource; }
@@ -60,6 +60,7 @@ class LmsApplication : public Wt::WApplication
 
 Database::Handler& DbHandler();
 Wt::Dbo::Session& DboSession();
+Wt::Dbo::Session& DboReadSession();	// browsing only, loaded objects must not be modified
 
 const Wt::Auth::User& CurrentAuthUser();
 Database::User::pointer CurrentUser();
@@ -37,7 +37,7 @@ TableFilterGenre::TableFilterGenre(Wt::WContainerWidget* parent)
 
 	SearchFilter filter;
 
-	Genre::updateUIQueryModel(DboSession(), _queryModel, filter, columnNames);
+	Genre::updateUIQueryModel(DboReadSession(), _queryModel, filter, columnNames);
 
 	this->setSelectionMode(Wt::ExtendedSelection);
 	this->setSortingEnabled(true);
@@ -87,7 +87,7 @@ TableFilterGenre::refresh(SearchFilter& filter)
 {
 	this->clearSelection();
 
-	Genre::updateUIQueryModel(DboSession(), _queryModel, filter);
+	Genre::updateUIQueryModel(DboReadSession(), _queryModel, filter);
 }
 
 // Get constraint created by this filter
@@ -115,7 +115,7 @@ TableFilterArtist::TableFilterArtist(Wt::WContainerWidget* parent)
 
 	SearchFilter filter;
 
-	Artist::updateUIQueryModel(DboSession(), _queryModel, filter, columnNames);
+	Artist::updateUIQueryModel(DboReadSession(), _queryModel, filter, columnNames);
 
 	this->setSelectionMode(Wt::ExtendedSelection);
 	this->setSortingEnabled(true);
@@ -165,7 +165,7 @@ void
 TableFilterArtist::refresh(SearchFilter& filter)
 {
 	this->clearSelection();
-	Artist::updateUIQueryModel(DboSession(), _queryModel, filter);
+	Artist::updateUIQueryModel(DboReadSession(), _queryModel, filter);
 }
 
 // Get constraint created by this filter
@@ -192,7 +192,7 @@ TableFilterRelease::TableFilterRelease(Wt::WContainerWidget* parent)
 
 	SearchFilter filter;
 
-	Release::updateUIQueryModel(DboSession(), _queryModel, filter, columnNames);
+	Release::updateUIQueryModel(DboReadSession(), _queryModel, filter, columnNames);
 
 	this->setSelectionMode(Wt::ExtendedSelection);
 	this->setSortingEnabled(true);
@@ -249,7 +249,7 @@ void
 TableFilterRelease::refresh(SearchFilter& filter)
 {
 	this->clearSelection();
-	Release::updateUIQueryModel(DboSession(), _queryModel, filter);
+	Release::updateUIQueryModel(DboReadSession(), _queryModel, filter);
 }
 
 // Get constraint created by this filter
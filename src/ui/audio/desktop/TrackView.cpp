@@ -68,7 +68,7 @@ TrackView::TrackView(Wt::WContainerWidget* parent)
 
 	SearchFilter filter;
 
-	Track::updateUIQueryModel(DboSession(), _queryModel, filter, columnNames);
+	Track::updateUIQueryModel(DboReadSession(), _queryModel, filter, columnNames);
 
 	_queryModel.setBatchSize(500);
 
@@ -129,10 +129,10 @@ TrackView::TrackView(Wt::WContainerWidget* parent)
 void
 TrackView::emitStats(const SearchFilter& filter)
 {
-	Wt::Dbo::Transaction transaction (DboSession());
+	Wt::Dbo::Transaction transaction (DboReadSession());
 
 	// Update stats on the view
-	Track::StatsQueryResult stats = Track::getStats(DboSession(), filter);
+	Track::StatsQueryResult stats = Track::getStats(DboReadSession(), filter);
 
 	transaction.commit();
 
@@ -161,7 +161,7 @@ void
 TrackView::refresh(SearchFilter& filter)
 {
 	this->clearSelection();
-	Track::updateUIQueryModel(DboSession(), _queryModel, filter);
+	Track::updateUIQueryModel(DboReadSession(), _queryModel, filter);
 
 	emitStats(filter);
 }
@@ -213,7 +213,7 @@ TrackView::getTracks(std::vector<Track::id_type>& trackIds)
 {
 	LMS_LOG(UI, DEBUG) << "Getting all tracks...";
 
-	Wt::Dbo::Transaction transaction(DboSession());
+	Wt::Dbo::Transaction transaction(DboReadSession());
 	Wt::Dbo::Query<Track::UIQueryResult> query = _queryModel.query();
 	Wt::Dbo::collection<Track::UIQueryResult> results = query.limit(-1).offset(-1);
 
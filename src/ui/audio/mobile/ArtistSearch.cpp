@@ -58,6 +58,7 @@ ArtistSearch::clear()
 {
 	_contents->clear();
 	_showMore->hide();
+	_cursor = Database::SearchCursor();
 }
 
 void
@@ -74,10 +75,10 @@ ArtistSearch::addResults(std::size_t nb)
 {
 	using namespace Database;
 
-	Wt::Dbo::Transaction transaction(DboSession());
+	Wt::Dbo::Transaction transaction(DboReadSession());
 
 	bool moreResults;
-	std::vector<Artist::pointer> artists = Artist::getByFilter(DboSession(), _filter, _contents->count(), nb, moreResults);
+	std::vector<Artist::pointer> artists = Artist::getByFilter(DboReadSession(), _filter, _cursor, nb, moreResults);
 
 	for (Artist::pointer artist : artists)
 	{
@@ -49,6 +49,7 @@ class ArtistSearch : public Wt::WContainerWidget
 		Wt::WTemplate*	_showMore;
 
 		Database::SearchFilter	_filter;
+		Database::SearchCursor	_cursor;	// last displayed result
 		Wt::WContainerWidget*	_contents;
 		std::size_t		_count;
 };
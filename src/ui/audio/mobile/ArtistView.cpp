@@ -46,9 +46,9 @@ ArtistView::ArtistView(Wt::WContainerWidget *parent)
 		Artist::id_type id;
 		if (readAs(strId, id))
 		{
-			Wt::Dbo::Transaction transaction(DboSession());
+			Wt::Dbo::Transaction transaction(DboReadSession());
 
-			auto artist = Artist::getById(DboSession(), id);
+			auto artist = Artist::getById(DboReadSession(), id);
 			releases->search(SearchFilter::ById(SearchFilter::Field::Artist, id), 20, artist ? Wt::WString::fromUTF8(artist->getName()) : "Unknown artist");
 		}
 
@@ -67,6 +67,7 @@ ReleaseSearch::clear()
 {
 	_contents->clear();
 	_showMore->hide();
+	_cursor = Database::SearchCursor();
 }
 
 void
@@ -84,10 +85,10 @@ ReleaseSearch::addResults(size_t nb)
 {
 	using namespace Database;
 
-	Wt::Dbo::Transaction transaction(DboSession());
+	Wt::Dbo::Transaction transaction(DboReadSession());
 
 	bool moreResults;
-	std::vector<Release::pointer> releases = Release::getByFilter(DboSession(), _filter, _contents->count(), nb, moreResults);
+	std::vector<Release::pointer> releases = Release::getByFilter(DboReadSession(), _filter, _cursor, nb, moreResults);
 
 	for (Release::pointer release : releases)
 	{
@@ -105,7 +106,7 @@ ReleaseSearch::addResults(size_t nb)
 		res->bindString("release_name", Wt::WString::fromUTF8(release->getName()), Wt::PlainText);
 
 		bool variousArtists;
-		auto artists = Artist::getByFilter(DboSession(),
+		auto artists = Artist::getByFilter(DboReadSession(),
 			SearchFilter::ById(SearchFilter::Field::Release, release.id()), 0, 1, variousArtists);
 		if (!artists.empty())
 		{
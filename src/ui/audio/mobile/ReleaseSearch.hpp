@@ -48,6 +48,7 @@ class ReleaseSearch : public Wt::WContainerWidget
 
 		Wt::WTemplate*		_showMore;
 		Database::SearchFilter	_filter;
+		Database::SearchCursor	_cursor;	// last displayed result
 		Wt::WContainerWidget*	_contents;
 		Wt::WText*		_title;
 		std::size_t		_count;
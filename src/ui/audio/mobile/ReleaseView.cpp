@@ -85,7 +85,7 @@ ReleaseView::clear()
 
 	// Flush the current context
 	_currentTrackContainer = nullptr;
-	_nbTracks = 0;
+	_cursor = SearchCursor();
 	_showMore->hide();
 }
 
@@ -101,7 +101,7 @@ ReleaseView::search(SearchFilter filter, size_t nb)
 static Wt::WString
 getArtistNameFromRelease(Release::pointer release)
 {
-	auto artists = Artist::getByFilter(DboSession(),
+	auto artists = Artist::getByFilter(DboReadSession(),
 			SearchFilter::ById(SearchFilter::Field::Release, release.id()), -1, 2);
 
 	if (artists.size() > 1)
@@ -115,10 +115,10 @@ getArtistNameFromRelease(Release::pointer release)
 void
 ReleaseView::addResults(size_t nb)
 {
-	Wt::Dbo::Transaction transaction(DboSession());
+	Wt::Dbo::Transaction transaction(DboReadSession());
 
 	bool moreResults;
-	std::vector<Track::pointer> tracks = Track::getByFilter(DboSession(), _filter, _nbTracks, nb, moreResults);
+	std::vector<Track::pointer> tracks = Track::getByFilter(DboReadSession(), _filter, _cursor, nb, moreResults);
 
 	for (Track::pointer track : tracks)
 	{
@@ -190,11 +190,6 @@ ReleaseView::addResults(size_t nb)
 		addBtn->clicked().connect(std::bind([=] {
 			_events.trackAdd.emit(track.id());
 		}));
-
-
-
-
-		_nbTracks++;
 	}
 
 	if (moreResults)
@@ -51,7 +51,7 @@ class ReleaseView : public Wt::WContainerWidget
 		Wt::WTemplate*	_showMore;
 
 		Database::SearchFilter _filter;
-		std::size_t	_nbTracks;
+		Database::SearchCursor	_cursor;
 
 		// Main container that holds the releases
 		Wt::WContainerWidget* _releaseContainer;
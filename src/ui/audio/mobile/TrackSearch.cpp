@@ -64,6 +64,7 @@ TrackSearch::clear()
 {
 	_contents->clear();
 	_showMore->hide();
+	_cursor = Database::SearchCursor();
 }
 
 void
@@ -78,10 +79,10 @@ TrackSearch::search(SearchFilter filter, size_t nb)
 void
 TrackSearch::addResults(size_t nb)
 {
-	Wt::Dbo::Transaction transaction(DboSession());
+	Wt::Dbo::Transaction transaction(DboReadSession());
 
 	bool moreResults;
-	std::vector<Track::pointer > tracks = Track::getByFilter(DboSession(), _filter, _contents->count(), nb, moreResults);
+	std::vector<Track::pointer > tracks = Track::getByFilter(DboReadSession(), _filter, _cursor, nb, moreResults);
 
 	for (Track::pointer track : tracks)
 	{
@@ -51,6 +51,7 @@ class TrackSearch : public Wt::WContainerWidget
 		PlayQueueEvents&	_events;
 		Wt::WTemplate*		_showMore;
 		Database::SearchFilter	_filter;
+		Database::SearchCursor	_cursor;	// last displayed result
 		Wt::WContainerWidget*	_contents;
 };
 
@@ -164,35 +164,27 @@ ImageResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Respons
 			return;
 
 		boost::filesystem::path path;
-		Database::Track::CoverType coverType = Database::Track::CoverType::None;
+		std::string coverHash;
 		{
 			// transactions are not thread safe
 			Wt::WApplication::UpdateLock lock(LmsApplication::instance());
 
-			Wt::Dbo::Transaction transaction(_db.getSession());
+			Wt::Dbo::Transaction transaction(_db.getReadSession());
 
-			Database::Track::pointer track = Database::Track::getById(_db.getSession(), trackId);
+			Database::Track::pointer track = Database::Track::getById(_db.getReadSession(), trackId);
 			if (track)
 			{
-				coverType = track->getCoverType();
+				coverHash = track->getCoverHash();
 				path = track->getPath();
 			}
 		}
 
 		if (!path.empty())
 		{
-			std::vector<Image::Image> covers;
-
-			switch (coverType)
-			{
-				case Database::Track::CoverType::Embedded:
-					covers = CoverArt::Grabber::instance().getFromTrack(path);
-					break;
-
-				case Database::Track::CoverType::None:
-					covers = CoverArt::Grabber::instance().getFromDirectory(path.parent_path());
-					break;
-			}
+			// Embedded covers are served from the cover store, the media file is never opened
+			std::vector<Image::Image> covers = CoverArt::Grabber::instance().getFromStore(coverHash);
+			if (covers.empty())
+				covers = CoverArt::Grabber::instance().getFromDirectory(path.parent_path());
 
 			putCover(response, covers, size);
 			return;
@@ -212,7 +204,7 @@ ImageResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Respons
 		// transactions are not thread safe
 		{
 			Wt::WApplication::UpdateLock lock(LmsApplication::instance());
-			covers = CoverArt::Grabber::instance().getFromRelease(_db.getSession(), releaseId);
+			covers = CoverArt::Grabber::instance().getFromRelease(_db.getReadSession(), releaseId);
 		}
 
 		putCover(response, covers, size);
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/asio/ip/address.hpp>
+
+#include <Wt/Http/Request>
+#include <Wt/Http/Response>
+
+#include "logger/Logger.hpp"
+
+#include "ScanMetricsResource.hpp"
+
+namespace UserInterface {
+
+namespace {
+
+bool
+isLoopbackAddress(const std::string& str)
+{
+	boost::system::error_code ec;
+	boost::asio::ip::address address = boost::asio::ip::address::from_string(str, ec);
+	if (ec)
+		return false;
+
+	if (address.is_v6() && address.to_v6().is_v4_mapped())
+		return address.to_v6().to_v4().is_loopback();
+
+	return address.is_loopback();
+}
+
+} // namespace
+
+ScanMetricsResource::ScanMetricsResource(Service::DatabaseUpdateService::pointer service, bool remoteAccess, Wt::WObject *parent)
+: Wt::WResource(parent),
+_service(service),
+_remoteAccess(remoteAccess)
+{
+}
+
+ScanMetricsResource::~ScanMetricsResource()
+{
+	beingDeleted();
+}
+
+void
+ScanMetricsResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
+{
+	using DatabaseUpdater::ScanProgress;
+
+	if (!_remoteAccess && !isLoopbackAddress(request.clientAddress()))
+	{
+		LMS_LOG(UI, DEBUG) << "Refusing scan metrics to remote client '" << request.clientAddress() << "'";
+		response.setStatus(403);
+		return;
+	}
+
+	const ScanProgress progress = _service->getProgress();
+
+	response.setMimeType("text/plain; version=0.0.4");
+
+	std::ostream& out = response.out();
+
+	out << "lms_scan_in_progress " << (progress.phase != ScanProgress::Phase::Idle ? 1 : 0) << "\n";
+
+	for (std::size_t i = 0; i < ScanProgress::nbPhases; ++i)
+	{
+		const std::string phase = ScanProgress::phaseToString(static_cast<ScanProgress::Phase>(i));
+
+		out << "lms_scan_phase{phase=\"" << phase << "\"} " << (static_cast<std::size_t>(progress.phase) == i ? 1 : 0) << "\n";
+		if (i != static_cast<std::size_t>(ScanProgress::Phase::Idle))
+			out << "lms_scan_phase_duration_seconds{phase=\"" << phase << "\"} " << progress.phaseDurations[i].total_milliseconds() / 1000. << "\n";
+	}
+
+	out << "lms_scan_files_expected " << progress.nbExpectedFiles << "\n";
+	out << "lms_scan_files_walked " << progress.nbWalked << "\n";
+	out << "lms_scan_files_skipped " << progress.nbSkipped << "\n";
+	out << "lms_scan_files_scanned " << progress.nbScanned << "\n";
+	out << "lms_scan_files_scan_errors " << progress.nbScanErrors << "\n";
+	out << "lms_scan_files_not_imported " << progress.nbNotImported << "\n";
+	out << "lms_scan_files_added " << progress.nbAdded << "\n";
+	out << "lms_scan_files_removed " << progress.nbRemoved << "\n";
+	out << "lms_scan_files_modified " << progress.nbModified << "\n";
+	out << "lms_scan_bytes_scanned " << progress.nbBytesScanned << "\n";
+	out << "lms_scan_files_per_second " << progress.filesPerSecond << "\n";
+	out << "lms_scan_bytes_per_second " << progress.bytesPerSecond << "\n";
+	out << "lms_scan_job_queue_size " << progress.jobQueueSize << "\n";
+	out << "lms_scan_result_queue_size " << progress.resultQueueSize << "\n";
+
+	if (!progress.eta.is_special())
+		out << "lms_scan_eta_seconds " << progress.eta.total_seconds() << "\n";
+}
+
+} // namespace UserInterface
+
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCAN_METRICS_RESOURCE_HPP_
+#define SCAN_METRICS_RESOURCE_HPP_
+
+#include <Wt/WResource>
+
+#include "service/DatabaseUpdateService.hpp"
+
+namespace UserInterface {
+
+// Exposes the database scan progress in the Prometheus text format
+// There is no authentication: unless remoteAccess is set, only local clients are served
+class ScanMetricsResource : public Wt::WResource
+{
+	public:
+		ScanMetricsResource(Service::DatabaseUpdateService::pointer service, bool remoteAccess, Wt::WObject *parent = 0);
+		~ScanMetricsResource();
+
+		void handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response);
+
+	private:
+
+		Service::DatabaseUpdateService::pointer	_service;
+		bool					_remoteAccess;
+};
+
+} // namespace UserInterface
+
+#endif
+
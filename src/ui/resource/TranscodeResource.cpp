@@ -98,20 +98,28 @@ TranscodeResource::handleRequest(const Wt::Http::Request& request,
 			{
 				Wt::WApplication::UpdateLock lock(LmsApplication::instance());
 
-				Wt::Dbo::Transaction transaction(_db.getSession());
+				// The user is loaded by the authentication, using the main session
+				std::size_t bitrate;
+				{
+					Wt::Dbo::Transaction transaction(_db.getSession());
 
-				Database::User::pointer user = _db.getCurrentUser();
-				Database::Track::pointer track = Database::Track::getById(_db.getSession(), trackId);
+					Database::User::pointer user = _db.getCurrentUser();
+					if (!user)
+					{
+						LMS_LOG(UI, ERROR) << "Missing user";
+						return;
+					}
 
-				if (!track)
-				{
-					LMS_LOG(UI, ERROR) << "Missing track";
-					return;
+					bitrate = user->getAudioBitrate();
 				}
 
-				if (!user)
+				Wt::Dbo::Transaction transaction(_db.getReadSession());
+
+				Database::Track::pointer track = Database::Track::getById(_db.getReadSession(), trackId);
+
+				if (!track)
 				{
-					LMS_LOG(UI, ERROR) << "Missing user";
+					LMS_LOG(UI, ERROR) << "Missing track";
 					return;
 				}
 
@@ -119,7 +127,7 @@ TranscodeResource::handleRequest(const Wt::Http::Request& request,
 
 				parameters.setOffset(boost::posix_time::seconds(std::stol(*offsetStr)));
 				parameters.setEncoding(Av::encoding_from_int(std::stol(*encodingStr)));
-				parameters.setBitrate(Av::Stream::Type::Audio, user->getAudioBitrate() );
+				parameters.setBitrate(Av::Stream::Type::Audio, bitrate);
 				for (std::string strStream: streams)
 				{
 					LMS_LOG(UI, DEBUG) << "Added stream " << std::stol(strStream);
@@ -32,6 +32,7 @@
 #include "logger/Logger.hpp"
 #include "service/ServiceManager.hpp"
 #include "service/DatabaseUpdateService.hpp"
+#include "service/MediaDirectoryWatchService.hpp"
 
 #include "LmsApplication.hpp"
 
@@ -101,6 +102,15 @@ Settings::handleDatabaseDirectoriesChanged()
 	}
 
 	restartDatabaseUpdateService();
+
+	// Watch the new set of directories
+	{
+		boost::lock_guard<boost::mutex> serviceLock (Service::ServiceManager::instance().mutex());
+
+		Service::MediaDirectoryWatchService::pointer service = Service::ServiceManager::instance().get<Service::MediaDirectoryWatchService>();
+		if (service)
+			service->restart();
+	}
 }
 
 void
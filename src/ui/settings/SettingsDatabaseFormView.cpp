@@ -17,6 +17,9 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <iomanip>
+#include <sstream>
+
 #include <Wt/WString>
 #include <Wt/WPushButton>
 #include <Wt/WCheckBox>
@@ -26,10 +29,13 @@
 #include <Wt/WRegExpValidator>
 
 #include <Wt/WFormModel>
+#include <Wt/WServer>
 #include <Wt/WStringListModel>
 
 #include "logger/Logger.hpp"
 #include "database/MediaDirectory.hpp"
+#include "service/ServiceManager.hpp"
+#include "service/DatabaseUpdateService.hpp"
 
 #include "common/DirectoryValidator.hpp"
 #include "LmsApplication.hpp"
@@ -293,7 +299,9 @@ const Wt::WFormModel::Field DatabaseFormModel::VideoFileExtensionsField		= "vide
 
 
 DatabaseFormView::DatabaseFormView(Wt::WContainerWidget *parent)
-: Wt::WTemplateFormView(parent)
+: Wt::WTemplateFormView(parent),
+_progressListenerId(0),
+_alive(std::make_shared<bool>(true))
 {
 	_model = new DatabaseFormModel(this);
 
@@ -346,10 +354,94 @@ DatabaseFormView::DatabaseFormView(Wt::WContainerWidget *parent)
 	bindWidget("immediate-scan-button", immediateScanButton);
 	immediateScanButton->clicked().connect(this, &DatabaseFormView::processImmediateScan);
 
+	_scanStatus = new Wt::WText();
+	bindWidget("scan-status", _scanStatus);
+
+	{
+		boost::lock_guard<boost::mutex> serviceLock (Service::ServiceManager::instance().mutex());
+
+		Service::DatabaseUpdateService::pointer service = Service::ServiceManager::instance().get<Service::DatabaseUpdateService>();
+		if (service)
+		{
+			updateScanStatus(service->getProgress());
+
+			Wt::WApplication::instance()->enableUpdates(true);
+
+			// Called from the updater thread: post the update to the session
+			// The view may have been deleted in the meantime
+			const std::string sessionId = Wt::WApplication::instance()->sessionId();
+			std::shared_ptr<bool> alive = _alive;
+
+			_progressListenerId = service->addProgressListener([=] (const DatabaseUpdater::ScanProgress& progress)
+			{
+				Wt::WServer::instance()->post(sessionId, [=]
+				{
+					if (!*alive)
+						return;
+
+					updateScanStatus(progress);
+					Wt::WApplication::instance()->triggerUpdate();
+				});
+			});
+		}
+	}
+
 	updateView(_model);
 
 }
 
+DatabaseFormView::~DatabaseFormView()
+{
+	*_alive = false;
+
+	boost::lock_guard<boost::mutex> serviceLock (Service::ServiceManager::instance().mutex());
+
+	Service::DatabaseUpdateService::pointer service = Service::ServiceManager::instance().get<Service::DatabaseUpdateService>();
+	if (service)
+		service->removeProgressListener(_progressListenerId);
+}
+
+void
+DatabaseFormView::updateScanStatus(const DatabaseUpdater::ScanProgress& progress)
+{
+	using DatabaseUpdater::ScanProgress;
+
+	std::ostringstream oss;
+	oss << std::fixed << std::setprecision(1);
+
+	if (progress.phase == ScanProgress::Phase::Idle)
+	{
+		if (progress.startTime.is_special())
+		{
+			_scanStatus->setText("No scan since startup");
+			return;
+		}
+
+		boost::posix_time::time_duration duration;
+		for (const boost::posix_time::time_duration& phaseDuration : progress.phaseDurations)
+			duration += phaseDuration;
+
+		oss << "Last scan started " << boost::posix_time::to_simple_string(progress.startTime)
+			<< ", took " << boost::posix_time::to_simple_string(duration)
+			<< ": " << progress.nbWalked << " files, " << progress.nbAdded << " added, "
+			<< progress.nbRemoved << " removed, " << progress.nbModified << " modified, "
+			<< progress.nbScanErrors << " errors";
+	}
+	else
+	{
+		oss << "In progress (" << ScanProgress::phaseToString(progress.phase) << "): "
+			<< progress.nbWalked << " / " << progress.nbExpectedFiles << " files, "
+			<< progress.filesPerSecond << " files/s, "
+			<< progress.bytesPerSecond / (1024 * 1024) << " MB/s, "
+			<< "queues " << progress.jobQueueSize << "/" << progress.resultQueueSize;
+
+		if (!progress.eta.is_special())
+			oss << ", ETA " << boost::posix_time::to_simple_string(progress.eta);
+	}
+
+	_scanStatus->setText(Wt::WString::fromUTF8(oss.str()));
+}
+
 void
 DatabaseFormView::processImmediateScan()
 {
@@ -20,11 +20,15 @@
 #ifndef UI_SETTINGS_DB_FORM_VIEW_HPP
 #define UI_SETTINGS_DB_FORM_VIEW_HPP
 
+#include <memory>
+
 #include <Wt/WContainerWidget>
 #include <Wt/WTemplateFormView>
 #include <Wt/WText>
 #include <Wt/WSignal>
 
+#include "database-updater/ScanProgress.hpp"
+
 namespace UserInterface {
 namespace Settings {
 
@@ -34,6 +38,7 @@ class DatabaseFormView : public Wt::WTemplateFormView
 {
 	public:
 		DatabaseFormView(Wt::WContainerWidget *parent = 0);
+		~DatabaseFormView();
 
 		Wt::Signal<void>& changed()	{ return _sigChanged; }
 
@@ -44,10 +49,16 @@ class DatabaseFormView : public Wt::WTemplateFormView
 		void processSave();
 		void processDiscard();
 		void processImmediateScan();
+		void updateScanStatus(const DatabaseUpdater::ScanProgress& progress);
 
 		Wt::WText		*_applyInfo;
+		Wt::WText		*_scanStatus;
 		DatabaseFormModel	*_model;
 
+		// Scan progress is pushed by the database updater
+		std::size_t		_progressListenerId;
+		std::shared_ptr<bool>	_alive;
+
 };
 
 
@@ -51,32 +51,6 @@ bool readAsPosixTime(const std::string& str, boost::posix_time::ptime& time)
 	return false;
 }
 
-bool readList(const std::string& str, const std::string& separators, std::list<std::string>& results)
-{
-	std::string curStr;
-
-	for (char c : str)
-	{
-		if (separators.find(c) != std::string::npos) {
-			if (!curStr.empty()) {
-				results.push_back(stringToUTF8(curStr));
-				curStr.clear();
-			}
-		}
-		else {
-			if (curStr.empty() && std::isspace(c))
-				continue;
-
-			curStr.push_back(c);
-		}
-	}
-
-	if (!curStr.empty())
-		results.push_back(stringToUTF8(curStr));
-
-	return !str.empty();
-}
-
 std::string
 durationToString(boost::posix_time::time_duration duration, std::string format)
 {
@@ -131,3 +105,18 @@ bufferToString(const std::vector<unsigned char>& data)
 	return oss.str();
 }
 
+bool
+isPathInParentPath(const boost::filesystem::path& path, const boost::filesystem::path& parentPath)
+{
+	boost::filesystem::path curPath = path;
+
+	while (curPath.has_parent_path())
+	{
+		curPath = curPath.parent_path();
+
+		if (curPath == parentPath)
+			return true;
+	}
+
+	return false;
+}
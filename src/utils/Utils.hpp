@@ -19,19 +19,18 @@
 
 #pragma once
 
+#include <cctype>
 #include <string>
 #include <vector>
 #include <list>
 
+#include <boost/filesystem.hpp>
 #include <boost/locale.hpp>
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 
 bool
 readAsPosixTime(const std::string& str, boost::posix_time::ptime& time);
 
-bool
-readList(const std::string& str, const std::string& separators, std::list<std::string>& results);
-
 std::string
 durationToString(boost::posix_time::time_duration duration, std::string format);
 
@@ -47,6 +46,10 @@ stringToUTF8(const std::string& str);
 std::string
 bufferToString(const std::vector<unsigned char>& data);
 
+// True if path is strictly below parentPath
+bool
+isPathInParentPath(const boost::filesystem::path& path, const boost::filesystem::path& parentPath);
+
 template<typename T>
 static inline bool readAs(const std::string& str, T& data)
 {
@@ -55,3 +58,31 @@ static inline bool readAs(const std::string& str, T& data)
 	return !iss.fail();
 }
 
+// Appends the UTF-8 converted items of a separated list to any container of strings
+// Leading spaces and empty items are skipped
+template<typename Container>
+static inline bool readList(const std::string& str, const std::string& separators, Container& results)
+{
+	std::string curStr;
+
+	for (char c : str)
+	{
+		if (separators.find(c) != std::string::npos) {
+			if (!curStr.empty()) {
+				results.push_back(stringToUTF8(curStr));
+				curStr.clear();
+			}
+		}
+		else {
+			if (curStr.empty() && std::isspace(c))
+				continue;
+
+			curStr.push_back(c);
+		}
+	}
+
+	if (!curStr.empty())
+		results.push_back(stringToUTF8(curStr));
+
+	return !str.empty();
+}
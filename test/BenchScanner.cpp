@@ -0,0 +1,668 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Scanner benchmark on a generated library
+// Usage: bench-scanner [nbArtists nbReleasesPerArtist nbTracksPerRelease]
+// Fails if the scan results are not the expected ones
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+
+#include <Wt/Dbo/FixedSqlConnectionPool>
+#include <Wt/Dbo/backend/Sqlite3>
+
+#include "av/AvInfo.hpp"
+#include "cover/CoverStore.hpp"
+#include "database/DatabaseHandler.hpp"
+#include "database-updater/DatabaseUpdater.hpp"
+#include "metadata/AvFormat.hpp"
+
+static const boost::filesystem::path workDirectory = "bench-scanner";
+
+static const std::vector<std::string> genres = { "Rock", "Jazz", "Electronic", "Classical", "Hip-Hop", "Folk", "Metal", "Ambient" };
+
+struct TrackInfo
+{
+	std::string	artist;
+	std::string	release;
+	std::string	title;
+	std::string	genre;
+	std::string	date;
+	std::string	releaseMBID;
+	std::size_t	trackNumber;
+	std::size_t	totalTracks;
+};
+
+/*
+ * File generation
+ * All the files are about 1.5 second long: shorter tracks are not imported
+ */
+
+typedef std::vector<unsigned char> Buffer;
+
+static void appendLE16(Buffer& buffer, uint16_t value)
+{
+	buffer.push_back(value & 0xFF);
+	buffer.push_back(value >> 8);
+}
+
+static void appendLE32(Buffer& buffer, uint32_t value)
+{
+	for (int i = 0; i < 4; ++i)
+		buffer.push_back((value >> (8 * i)) & 0xFF);
+}
+
+static void appendBE(Buffer& buffer, uint64_t value, std::size_t nbBytes)
+{
+	for (std::size_t i = nbBytes; i > 0; --i)
+		buffer.push_back((value >> (8 * (i - 1))) & 0xFF);
+}
+
+static void appendString(Buffer& buffer, const std::string& str)
+{
+	buffer.insert(buffer.end(), str.begin(), str.end());
+}
+
+// 1x1 grey baseline JPEG
+static Buffer createCover()
+{
+	Buffer res = { 0xFF, 0xD8 };
+
+	// Quantization table
+	appendBE(res, 0xFFDB, 2);
+	appendBE(res, 67, 2);
+	res.push_back(0x00);
+	res.insert(res.end(), 64, 0x01);
+
+	// Frame: 8 bits, 1x1, one component
+	for (unsigned char c : { 0xFF, 0xC0, 0x00, 0x0B, 0x08, 0x00, 0x01, 0x00, 0x01, 0x01, 0x01, 0x11, 0x00 })
+		res.push_back(c);
+
+	// DC and AC Huffman tables, with a single one bit code each
+	for (unsigned char tableClass : { 0x00, 0x10 })
+	{
+		appendBE(res, 0xFFC4, 2);
+		appendBE(res, 20, 2);
+		res.push_back(tableClass);
+		res.push_back(1);
+		res.insert(res.end(), 15, 0x00);
+		res.push_back(0x00);
+	}
+
+	// Scan: null DC difference, end of block
+	for (unsigned char c : { 0xFF, 0xDA, 0x00, 0x08, 0x01, 0x01, 0x00, 0x00, 0x3F, 0x00, 0x3F, 0xFF, 0xD9 })
+		res.push_back(c);
+
+	return res;
+}
+
+static void writeFile(const boost::filesystem::path& p, const Buffer& buffer)
+{
+	std::ofstream ofs(p.string(), std::ios::binary);
+	ofs.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+	if (!ofs)
+		throw std::runtime_error("Cannot write '" + p.string() + "'");
+}
+
+// 8 kHz, 8 bits mono PCM, with RIFF INFO tags
+static Buffer createWav(const TrackInfo& info)
+{
+	Buffer tags;
+	appendString(tags, "INFO");
+
+	auto appendTag = [&](const std::string& id, const std::string& value)
+	{
+		appendString(tags, id);
+		appendLE32(tags, value.size() + 1);
+		appendString(tags, value);
+		tags.push_back(0);
+		if ((value.size() + 1) % 2)
+			tags.push_back(0);
+	};
+
+	appendTag("INAM", info.title);
+	appendTag("IART", info.artist);
+	appendTag("IPRD", info.release);
+	appendTag("IGNR", info.genre);
+	appendTag("ICRD", info.date);
+	appendTag("ITRK", std::to_string(info.trackNumber));
+
+	const std::size_t nbSamples = 12000;
+
+	Buffer res;
+	appendString(res, "RIFF");
+	appendLE32(res, 4 + (8 + 16) + (8 + tags.size()) + (8 + nbSamples));
+	appendString(res, "WAVE");
+
+	appendString(res, "fmt ");
+	appendLE32(res, 16);
+	appendLE16(res, 1);	// PCM
+	appendLE16(res, 1);	// channels
+	appendLE32(res, 8000);	// sample rate
+	appendLE32(res, 8000);	// byte rate
+	appendLE16(res, 1);	// block align
+	appendLE16(res, 8);	// bits per sample
+
+	appendString(res, "LIST");
+	appendLE32(res, tags.size());
+	res.insert(res.end(), tags.begin(), tags.end());
+
+	appendString(res, "data");
+	appendLE32(res, nbSamples);
+	res.insert(res.end(), nbSamples, 0x80);
+
+	return res;
+}
+
+// ID3v2.3 tags with a front cover, followed by silent MPEG-1 layer III frames (32 kbps, 32 kHz, mono)
+static Buffer createMp3(const TrackInfo& info, const Buffer& cover)
+{
+	Buffer frames;
+
+	auto appendFrame = [&](const std::string& id, const Buffer& content)
+	{
+		appendString(frames, id);
+		appendBE(frames, content.size(), 4);
+		appendBE(frames, 0, 2);
+		frames.insert(frames.end(), content.begin(), content.end());
+	};
+
+	auto appendTextFrame = [&](const std::string& id, const std::string& value)
+	{
+		Buffer content = { 0x00 };	// ISO-8859-1
+		appendString(content, value);
+		appendFrame(id, content);
+	};
+
+	appendTextFrame("TIT2", info.title);
+	appendTextFrame("TPE1", info.artist);
+	appendTextFrame("TALB", info.release);
+	appendTextFrame("TCON", info.genre);
+	appendTextFrame("TYER", info.date);
+	appendTextFrame("TRCK", std::to_string(info.trackNumber) + "/" + std::to_string(info.totalTracks));
+	appendTextFrame("TXXX", std::string("MusicBrainz Album Id") + '\0' + info.releaseMBID);
+
+	Buffer picture = { 0x00 };
+	appendString(picture, "image/jpeg");
+	picture.push_back(0x00);
+	picture.push_back(0x03);	// front cover
+	picture.push_back(0x00);	// no description
+	picture.insert(picture.end(), cover.begin(), cover.end());
+	appendFrame("APIC", picture);
+
+	Buffer res;
+	appendString(res, "ID3");
+	res.push_back(0x03);
+	res.push_back(0x00);
+	res.push_back(0x00);
+
+	// Sync safe size
+	for (int i = 3; i >= 0; --i)
+		res.push_back((frames.size() >> (7 * i)) & 0x7F);
+
+	res.insert(res.end(), frames.begin(), frames.end());
+
+	// 144 bytes per frame, 36 ms each
+	for (std::size_t i = 0; i < 42; ++i)
+	{
+		for (unsigned char c : { 0xFF, 0xFB, 0x18, 0xC0 })
+			res.push_back(c);
+		res.insert(res.end(), 140, 0x00);
+	}
+
+	return res;
+}
+
+static uint8_t computeFlacCrc8(const unsigned char* data, std::size_t size)
+{
+	uint8_t crc = 0;
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		crc ^= data[i];
+		for (int bit = 0; bit < 8; ++bit)
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+	}
+	return crc;
+}
+
+static uint16_t computeFlacCrc16(const unsigned char* data, std::size_t size)
+{
+	uint16_t crc = 0;
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		crc ^= data[i] << 8;
+		for (int bit = 0; bit < 8; ++bit)
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : (crc << 1);
+	}
+	return crc;
+}
+
+// 8 kHz, 16 bits mono, Vorbis comments and a front cover
+// Silence is encoded using constant subframes
+static Buffer createFlac(const TrackInfo& info, const Buffer& cover)
+{
+	const std::size_t blockSize = 4000;
+	const std::size_t nbFrames = 3;
+
+	Buffer res;
+	appendString(res, "fLaC");
+
+	// STREAMINFO
+	res.push_back(0x00);
+	appendBE(res, 34, 3);
+	appendBE(res, blockSize, 2);
+	appendBE(res, blockSize, 2);
+	appendBE(res, 0, 3);	// min frame size: unknown
+	appendBE(res, 0, 3);	// max frame size: unknown
+	appendBE(res, (uint64_t(8000) << 44) | (uint64_t(0) << 41) | (uint64_t(15) << 36) | (blockSize * nbFrames), 8);
+	res.insert(res.end(), 16, 0x00);	// no MD5
+
+	// VORBIS_COMMENT
+	{
+		Buffer comments;
+		const std::string vendor = "bench-scanner";
+		appendLE32(comments, vendor.size());
+		appendString(comments, vendor);
+
+		const std::vector<std::string> fields =
+		{
+			"TITLE=" + info.title,
+			"ARTIST=" + info.artist,
+			"ALBUM=" + info.release,
+			"GENRE=" + info.genre,
+			"DATE=" + info.date,
+			"TRACKNUMBER=" + std::to_string(info.trackNumber),
+			"TRACKTOTAL=" + std::to_string(info.totalTracks),
+			"MUSICBRAINZ_ALBUMID=" + info.releaseMBID,
+		};
+
+		appendLE32(comments, fields.size());
+		for (const std::string& field : fields)
+		{
+			appendLE32(comments, field.size());
+			appendString(comments, field);
+		}
+
+		res.push_back(0x04);
+		appendBE(res, comments.size(), 3);
+		res.insert(res.end(), comments.begin(), comments.end());
+	}
+
+	// PICTURE, last metadata block
+	{
+		Buffer picture;
+		const std::string mimeType = "image/jpeg";
+		appendBE(picture, 3, 4);	// front cover
+		appendBE(picture, mimeType.size(), 4);
+		appendString(picture, mimeType);
+		appendBE(picture, 0, 4);	// no description
+		appendBE(picture, 1, 4);	// width
+		appendBE(picture, 1, 4);	// height
+		appendBE(picture, 8, 4);	// depth
+		appendBE(picture, 0, 4);	// not indexed
+		appendBE(picture, cover.size(), 4);
+		picture.insert(picture.end(), cover.begin(), cover.end());
+
+		res.push_back(0x80 | 0x06);
+		appendBE(res, picture.size(), 3);
+		res.insert(res.end(), picture.begin(), picture.end());
+	}
+
+	for (std::size_t i = 0; i < nbFrames; ++i)
+	{
+		Buffer frame = { 0xFF, 0xF8 };
+		frame.push_back(0x74);	// block size in 16 bits at end of header, 8 kHz
+		frame.push_back(0x08);	// mono, 16 bits
+		frame.push_back(i);	// frame number, UTF-8 coded
+		appendBE(frame, blockSize - 1, 2);
+		frame.push_back(computeFlacCrc8(frame.data(), frame.size()));
+
+		frame.push_back(0x00);	// constant subframe
+		appendBE(frame, 0, 2);	// sample value
+
+		appendBE(frame, computeFlacCrc16(frame.data(), frame.size()), 2);
+
+		res.insert(res.end(), frame.begin(), frame.end());
+	}
+
+	return res;
+}
+
+static std::string getReleaseMBID(std::size_t artistId, std::size_t releaseId)
+{
+	std::ostringstream oss;
+	oss << std::hex << std::setfill('0') << std::setw(8) << artistId << "-0000-4000-8000-" << std::setw(12) << releaseId;
+	return oss.str();
+}
+
+static boost::filesystem::path getTrackPath(const boost::filesystem::path& libraryPath, std::size_t artistId, std::size_t releaseId, std::size_t trackId)
+{
+	// Some releases have disc sub directories
+	boost::filesystem::path res = libraryPath / ("Artist " + std::to_string(artistId)) / (std::to_string(1970 + releaseId) + " - Release " + std::to_string(releaseId));
+	if (releaseId % 3 == 2)
+		res /= "CD" + std::to_string(1 + trackId % 2);
+
+	static const std::vector<std::string> extensions = { ".mp3", ".flac", ".wav" };
+	return res / ("Track " + std::to_string(trackId) + extensions[(artistId + releaseId + trackId) % extensions.size()]);
+}
+
+static void createTrack(const boost::filesystem::path& p, const TrackInfo& info, const Buffer& cover)
+{
+	if (p.extension() == ".mp3")
+		writeFile(p, createMp3(info, cover));
+	else if (p.extension() == ".flac")
+		writeFile(p, createFlac(info, cover));
+	else
+		writeFile(p, createWav(info));
+}
+
+static TrackInfo getTrackInfo(std::size_t artistId, std::size_t releaseId, std::size_t trackId, std::size_t nbTracks)
+{
+	TrackInfo info;
+	info.artist = "Artist " + std::to_string(artistId);
+	info.release = "Release " + std::to_string(artistId) + "." + std::to_string(releaseId);
+	info.title = "Track " + std::to_string(trackId);
+	info.genre = genres[(artistId + releaseId) % genres.size()];
+	info.date = std::to_string(1970 + releaseId);
+	info.releaseMBID = getReleaseMBID(artistId, releaseId);
+	info.trackNumber = trackId + 1;
+	info.totalTracks = nbTracks;
+
+	return info;
+}
+
+static std::size_t createLibrary(const boost::filesystem::path& libraryPath, std::size_t nbArtists, std::size_t nbReleases, std::size_t nbTracks)
+{
+	const Buffer cover = createCover();
+
+	std::size_t nbFiles = 0;
+	for (std::size_t artistId = 0; artistId < nbArtists; ++artistId)
+	{
+		for (std::size_t releaseId = 0; releaseId < nbReleases; ++releaseId)
+		{
+			for (std::size_t trackId = 0; trackId < nbTracks; ++trackId)
+			{
+				const boost::filesystem::path p = getTrackPath(libraryPath, artistId, releaseId, trackId);
+
+				boost::filesystem::create_directories(p.parent_path());
+				createTrack(p, getTrackInfo(artistId, releaseId, trackId, nbTracks), cover);
+				++nbFiles;
+			}
+
+			writeFile(getTrackPath(libraryPath, artistId, releaseId, 0).parent_path() / "cover.jpg", cover);
+		}
+	}
+
+	return nbFiles;
+}
+
+// Retag one track out of a hundred, in place
+static std::size_t modifyLibrary(const boost::filesystem::path& libraryPath, std::size_t nbArtists, std::size_t nbReleases, std::size_t nbTracks)
+{
+	const Buffer cover = createCover();
+
+	std::size_t nbModified = 0;
+	std::size_t index = 0;
+	for (std::size_t artistId = 0; artistId < nbArtists; ++artistId)
+	{
+		for (std::size_t releaseId = 0; releaseId < nbReleases; ++releaseId)
+		{
+			for (std::size_t trackId = 0; trackId < nbTracks; ++trackId)
+			{
+				if (index++ % 100)
+					continue;
+
+				const boost::filesystem::path p = getTrackPath(libraryPath, artistId, releaseId, trackId);
+
+				TrackInfo info = getTrackInfo(artistId, releaseId, trackId, nbTracks);
+				info.title += " (remastered)";
+
+				const std::time_t lastWriteTime = boost::filesystem::last_write_time(p);
+				createTrack(p, info, cover);
+
+				// Make sure the change is seen, even if made within the same second as the previous scan
+				boost::filesystem::last_write_time(p, lastWriteTime + 10);
+				++nbModified;
+			}
+		}
+	}
+
+	return nbModified;
+}
+
+// Copy of a track in its own directory, so that it is seen by the scans that skip the unchanged directories
+static void writeCopy(const boost::filesystem::path& copyPath, const Buffer& content)
+{
+	const bool exists = boost::filesystem::exists(copyPath);
+	const std::time_t lastWriteTime = exists ? boost::filesystem::last_write_time(copyPath) : 0;
+
+	boost::filesystem::create_directories(copyPath.parent_path());
+	writeFile(copyPath, content);
+
+	// Same as modifyLibrary, the directory is also changed as a tagger writing a new file would do
+	if (exists)
+	{
+		boost::filesystem::last_write_time(copyPath, lastWriteTime + 10);
+		boost::filesystem::last_write_time(copyPath.parent_path(), lastWriteTime + 10);
+	}
+}
+
+static Buffer readFile(const boost::filesystem::path& p)
+{
+	std::ifstream ifs(p.string(), std::ios::binary);
+	return Buffer(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+/*
+ * Measures
+ */
+
+static std::atomic<std::size_t> nbStatements {0};
+
+static int countStatement(unsigned, void*, void*, void*)
+{
+	nbStatements++;
+	return 0;
+}
+
+static long getPeakRSS()
+{
+	struct rusage usage;
+	::getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;	// KiB
+}
+
+static DatabaseUpdater::ScanProgress runScan(const std::string& name, DatabaseUpdater::Updater& updater, bool checkAllFiles, std::size_t nbFiles, bool dryRun = false)
+{
+	nbStatements = 0;
+
+	const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+	if (dryRun)
+	{
+		std::ostringstream report;
+		updater.dryRun(checkAllFiles, report);
+	}
+	else
+		updater.scanNow(checkAllFiles);
+	const double duration = (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1000000.;
+
+	const DatabaseUpdater::ScanProgress progress = updater.getProgress();
+
+	std::cout << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(10) << duration << " s"
+		<< std::setw(12) << nbFiles / duration << " files/s"
+		<< std::setw(10) << static_cast<double>(nbStatements) / nbFiles << " queries/file"
+		<< std::setw(10) << getPeakRSS() / 1024 << " MiB peak RSS"
+		<< "  (scanned " << progress.nbScanned << ", added " << progress.nbAdded << ", modified " << progress.nbModified << ", removed " << progress.nbRemoved << ")"
+		<< std::endl;
+
+	return progress;
+}
+
+static void check(bool condition, const std::string& message)
+{
+	if (!condition)
+		throw std::runtime_error(message);
+}
+
+// Paths of the duplicated tracks, grouped by key
+static std::vector<boost::filesystem::path> getDuplicatePaths(Wt::Dbo::SqlConnectionPool& connectionPool)
+{
+	Database::Handler db(connectionPool);
+	Wt::Dbo::Transaction transaction(db.getSession());
+
+	std::vector<boost::filesystem::path> res;
+	for (Database::TrackDuplicate::pointer duplicate : Database::TrackDuplicate::getAll(db.getSession()))
+		res.push_back(duplicate->getTrack()->getPath());
+
+	return res;
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		std::size_t nbArtists = 20;
+		std::size_t nbReleases = 5;
+		std::size_t nbTracks = 10;
+
+		if (argc == 4)
+		{
+			nbArtists = std::stoul(argv[1]);
+			nbReleases = std::stoul(argv[2]);
+			nbTracks = std::stoul(argv[3]);
+		}
+		else if (argc != 1)
+		{
+			std::cerr << "Usage: " << argv[0] << " [nbArtists nbReleasesPerArtist nbTracksPerRelease]" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		Av::AvInit();
+
+		const boost::filesystem::path libraryPath = workDirectory / "library";
+		const boost::filesystem::path dbPath = workDirectory / "bench.db";
+
+		boost::filesystem::remove_all(workDirectory);
+
+		CoverArt::Store::instance().setDirectory(workDirectory / "covers");
+
+		std::cout << "Generating library..." << std::endl;
+		const std::size_t nbFiles = createLibrary(libraryPath, nbArtists, nbReleases, nbTracks);
+		std::cout << nbFiles << " files in " << libraryPath << std::endl;
+
+		// Same as Handler::createConnectionPool, with statement counting
+		Wt::Dbo::backend::Sqlite3* connection = new Wt::Dbo::backend::Sqlite3(dbPath.string());
+		connection->executeSql("pragma journal_mode=WAL");
+		sqlite3_trace_v2(connection->connection(), SQLITE_TRACE_STMT, countStatement, nullptr);
+
+		std::unique_ptr<Wt::Dbo::SqlConnectionPool> connectionPool(new Wt::Dbo::FixedSqlConnectionPool(connection, 1));
+		Database::Handler::migrate(*connectionPool);
+
+		{
+			Database::Handler db(*connectionPool);
+
+			Wt::Dbo::Transaction transaction(db.getSession());
+			Database::MediaDirectory::create(db.getSession(), libraryPath, Database::MediaDirectory::Audio);
+		}
+
+		DatabaseUpdater::Updater updater(*connectionPool, [] { return std::make_shared<MetaData::AvFormat>(); });
+
+		DatabaseUpdater::ScanProgress progress;
+
+		progress = runScan("Dry run", updater, true, nbFiles, true);
+		check(progress.nbAdded == nbFiles, "Dry run: all the files must be reported as added");
+
+		progress = runScan("Cold scan", updater, true, nbFiles);
+		check(progress.nbAdded == nbFiles, "Cold scan: all the files must be added");
+
+		progress = runScan("No change, all files", updater, true, nbFiles);
+		check(progress.nbAdded + progress.nbModified + progress.nbRemoved == 0 && progress.nbScanned == 0, "No change scan: nothing must be scanned");
+
+		progress = runScan("No change, skip unchanged dirs", updater, false, nbFiles);
+		check(progress.nbAdded + progress.nbModified + progress.nbRemoved == 0 && progress.nbScanned == 0, "No change scan: nothing must be scanned");
+
+		const std::size_t nbModified = modifyLibrary(libraryPath, nbArtists, nbReleases, nbTracks);
+
+		progress = runScan("1% changed, all files", updater, true, nbFiles);
+		check(progress.nbModified == nbModified && progress.nbAdded == 0 && progress.nbRemoved == 0, "1% changed scan: only the changed files must be modified");
+		check(getDuplicatePaths(*connectionPool).empty(), "1% changed scan: no duplicate expected");
+
+		// Duplicates, checked by the scans that skip the unchanged directories
+		// The copied track is a FLAC file, not modified by modifyLibrary
+		const boost::filesystem::path trackPath = getTrackPath(libraryPath, 0, 0, 1);
+		const boost::filesystem::path copyPath = libraryPath / "Duplicates" / ("Copy" + trackPath.extension().string());
+		const std::vector<boost::filesystem::path> duplicatePaths = { trackPath, copyPath };
+
+		writeCopy(copyPath, readFile(trackPath));
+		progress = runScan("Duplicate added", updater, false, nbFiles);
+		check(progress.nbAdded == 1, "Duplicate added scan: the copy must be added");
+		check(getDuplicatePaths(*connectionPool) == duplicatePaths, "Duplicate added scan: the track and its copy must be duplicates");
+
+		// Duplicate check of an interrupted scan, the changed tracks being lost
+		{
+			Database::Handler db(*connectionPool);
+			Wt::Dbo::Transaction transaction(db.getSession());
+
+			Database::TrackDuplicate::removeAll(db.getSession());
+			Database::ScanCheckpoint::get(db.getSession()).modify()->setDuplicateCheckPending(true);
+		}
+		progress = runScan("Pending duplicate check", updater, false, nbFiles);
+		check(getDuplicatePaths(*connectionPool) == duplicatePaths, "Pending duplicate check scan: the duplicates must be checked again");
+
+		TrackInfo info = getTrackInfo(0, 0, 1, nbTracks);
+		info.title = "Copy";
+		writeCopy(copyPath, createFlac(info, createCover()));
+		progress = runScan("Duplicate changed", updater, false, nbFiles);
+		check(progress.nbModified == 1, "Duplicate changed scan: the copy must be modified");
+		check(getDuplicatePaths(*connectionPool).empty(), "Duplicate changed scan: the copy must no longer be a duplicate");
+
+		writeCopy(copyPath, readFile(trackPath));
+		progress = runScan("Duplicate restored", updater, false, nbFiles);
+		check(getDuplicatePaths(*connectionPool) == duplicatePaths, "Duplicate restored scan: the track and its copy must be duplicates");
+
+		boost::filesystem::remove(copyPath);
+		progress = runScan("Duplicate removed", updater, false, nbFiles);
+		check(progress.nbRemoved == 1, "Duplicate removed scan: the copy must be removed");
+		check(getDuplicatePaths(*connectionPool).empty(), "Duplicate removed scan: no duplicate expected");
+
+		return EXIT_SUCCESS;
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Caught exception: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+}
@@ -221,6 +221,28 @@ int main(void)
 			assert(res.front()->getName() == "genre01");
 		}
 
+		// Orphans
+		{
+			Wt::Dbo::Transaction transaction(db.getSession());
+
+			Artist::create(db.getSession(), "artist02");
+			Release::create(db.getSession(), "release02");
+			Genre::create(db.getSession(), "genre02");
+		}
+
+		{
+			Wt::Dbo::Transaction transaction(db.getSession());
+
+			assert(Genre::removeDanglingTrackLinks(db.getSession()) == 0);
+			assert(Genre::removeOrphans(db.getSession()) == 1);
+			assert(Artist::removeOrphans(db.getSession()) == 1);
+			assert(Release::removeOrphans(db.getSession()) == 1);
+
+			assert(Genre::getByName(db.getSession(), "genre01"));
+			assert(!Genre::getByName(db.getSession(), "genre02"));
+			assert(Artist::getByName(db.getSession(), "artist01").size() == 1);
+			assert(Artist::getByName(db.getSession(), "artist02").empty());
+		}
 	}
 	catch(std::exception& e)
 	{
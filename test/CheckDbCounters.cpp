@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Artist and release counters, as the tracks are added, modified and removed
+
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "DatabaseFixture.hpp"
+
+using namespace Database;
+
+static Artist::id_type artistId;
+static Release::id_type releaseId;
+
+// Changed artist only, all the releases
+static void
+checkCounters(Wt::Dbo::Session& session, int artistTrackCount, int artistReleaseCount, int artistSeconds, int releaseTrackCount)
+{
+	Wt::Dbo::Transaction transaction(session);
+
+	Artist::updateCounters(session, {artistId});
+	Release::updateAllCounters(session);
+
+	Artist::pointer artist = Artist::getById(session, artistId);
+	artist.reread();
+	assert(artist->getTrackCount() == artistTrackCount);
+	assert(artist->getReleaseCount() == artistReleaseCount);
+	assert(artist->getDuration() == boost::posix_time::seconds(artistSeconds));
+
+	Release::pointer release = Release::getById(session, releaseId);
+	release.reread();
+	assert(release->getTrackCount() == releaseTrackCount);
+}
+
+int main(void)
+{
+	try
+	{
+		std::unique_ptr<Wt::Dbo::SqlConnectionPool> connectionPool(DatabaseFixture::createConnectionPool("test_counters.db"));
+		Handler db(*connectionPool);
+		Wt::Dbo::Session& session = db.getSession();
+
+		std::vector<Track::id_type> trackIds;
+		{
+			Wt::Dbo::Transaction transaction(session);
+
+			Artist::pointer artist = Artist::create(session, "counted artist");
+			Release::pointer release = Release::create(session, "counted release");
+			for (const std::string& name : {"counted1", "counted2", "counted3"})
+			{
+				Track::pointer track = DatabaseFixture::createTrack(session, name, artist, release);
+				track.modify()->setDuration(boost::posix_time::seconds(60));
+
+				trackIds.push_back(track.id());
+			}
+			artistId = artist.id();
+			releaseId = release.id();
+		}
+		checkCounters(session, 3, 1, 180, 3);
+
+		{
+			Wt::Dbo::Transaction transaction(session);
+
+			Track::getById(session, trackIds[0]).modify()->setDuration(boost::posix_time::seconds(120));
+			Track::getById(session, trackIds[2]).modify()->setRelease(Release::create(session, "counted release 2"));
+		}
+		checkCounters(session, 3, 2, 240, 2);
+
+		{
+			Wt::Dbo::Transaction transaction(session);
+
+			Track::getById(session, trackIds[1]).remove();
+		}
+		checkCounters(session, 2, 2, 180, 1);
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "Caught exception " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Keyword searches, through the full text index if SQLite has FTS5 and its trigram tokenizer
+
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "DatabaseFixture.hpp"
+
+using namespace Database;
+
+static std::vector<std::string>
+searchArtists(Wt::Dbo::Session& session, const std::string& keyword)
+{
+	Wt::Dbo::Transaction transaction(session);
+
+	std::vector<std::string> names;
+	for (Artist::pointer artist : Artist::getByFilter(session, SearchFilter::ByNameAnd(SearchFilter::Field::Artist, {keyword}), -1, -1))
+		names.push_back(artist->getName());
+
+	return names;
+}
+
+static std::vector<std::string>
+searchTracks(Wt::Dbo::Session& session, const std::string& keyword)
+{
+	Wt::Dbo::Transaction transaction(session);
+
+	std::vector<std::string> names;
+	for (Track::pointer track : Track::getByFilter(session, SearchFilter::ByNameAnd(SearchFilter::Field::Track, {keyword}), -1, -1))
+		names.push_back(track->getName());
+
+	return names;
+}
+
+static void
+checkArtistNames(Wt::Dbo::Session& session)
+{
+	bool fullText;
+	{
+		Wt::Dbo::Transaction transaction(session);
+
+		fullText = DatabaseFixture::hasFullTextIndex(session);
+
+		// Artists are only found through their tracks
+		Release::pointer release = Release::create(session, "release01");
+		for (const std::string& name : {"azure blue sky lake", "blue blue", "AC-DC"})
+			DatabaseFixture::createTrack(session, name, Artist::create(session, name), release);
+	}
+
+	// Any part of the names, as with LIKE
+	assert(searchArtists(session, "sky") == std::vector<std::string>({"azure blue sky lake"}));
+	assert(searchArtists(session, "zure") == std::vector<std::string>({"azure blue sky lake"}));
+	assert(searchArtists(session, "C-D") == std::vector<std::string>({"AC-DC"}));
+
+	// Best matches first
+	if (fullText)
+		assert(searchArtists(session, "blue") == std::vector<std::string>({"blue blue", "azure blue sky lake"}));
+	else
+		assert(searchArtists(session, "blue") == std::vector<std::string>({"azure blue sky lake", "blue blue"}));
+
+	// Keywords are not taken as FTS5 syntax
+	assert(searchArtists(session, "\"blue").empty());
+	assert(searchArtists(session, "blue AND").empty());
+	assert(searchArtists(session, "NEAR(").empty());
+
+	// Keywords shorter than a trigram are matched by LIKE
+	assert(searchArtists(session, "-") == std::vector<std::string>({"AC-DC"}));
+	assert(searchArtists(session, "ac") == std::vector<std::string>({"AC-DC"}));
+}
+
+// The index follows the name changes, and only them
+static void
+checkRetaggedTracks(Wt::Dbo::Session& session)
+{
+	Track::id_type trackId;
+	{
+		Wt::Dbo::Transaction transaction(session);
+
+		trackId = DatabaseFixture::createTrack(session, "blue note", Artist::create(session, "retagged artist"), Release::create(session, "retagged release")).id();
+	}
+	{
+		Wt::Dbo::Transaction transaction(session);
+
+		Track::getById(session, trackId).modify()->setTrackNumber(2);
+	}
+	assert(searchTracks(session, "note") == std::vector<std::string>({"blue note"}));
+
+	{
+		Wt::Dbo::Transaction transaction(session);
+
+		Track::getById(session, trackId).modify()->setName("green note");
+	}
+	assert(searchTracks(session, "note") == std::vector<std::string>({"green note"}));
+	assert(searchTracks(session, "blue note").empty());
+}
+
+int main(void)
+{
+	try
+	{
+		std::unique_ptr<Wt::Dbo::SqlConnectionPool> connectionPool(DatabaseFixture::createConnectionPool("test_search.db"));
+		Handler db(*connectionPool);
+
+		checkArtistNames(db.getSession());
+		checkRetaggedTracks(db.getSession());
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "Caught exception " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
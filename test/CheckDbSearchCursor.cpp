@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Pages fetched from a search cursor, while the rows change between them
+
+#include <cassert>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "DatabaseFixture.hpp"
+
+using namespace Database;
+
+// Pages of the artists of a release
+static void
+checkArtistPages(Wt::Dbo::Session& session)
+{
+	Release::id_type releaseId;
+	std::map<std::string, Artist::id_type> artistIds;
+	{
+		Wt::Dbo::Transaction transaction(session);
+
+		Release::pointer release = Release::create(session, "paged release");
+		for (const std::string& name : {"page1", "page2", "page3", "page4", "page5"})
+		{
+			Artist::pointer artist = Artist::create(session, name);
+			DatabaseFixture::createTrack(session, name, artist, release);
+
+			artistIds[name] = artist.id();
+		}
+		releaseId = release.id();
+	}
+
+	SearchCursor cursor;
+	auto getNextPage = [&](bool& moreResults)
+	{
+		Wt::Dbo::Transaction transaction(session);
+
+		std::vector<Artist::id_type> ids;
+		for (Artist::pointer artist : Artist::getByFilter(session, SearchFilter::ById(SearchFilter::Field::Release, releaseId), cursor, 2, moreResults))
+			ids.push_back(artist.id());
+
+		return ids;
+	};
+
+	bool moreResults;
+	assert(getNextPage(moreResults) == std::vector<Artist::id_type>({artistIds["page1"], artistIds["page2"]}));
+	assert(moreResults);
+
+	// The last row of the page is renamed
+	{
+		Wt::Dbo::Transaction transaction(session);
+
+		session.execute("UPDATE artist SET name = 'page9' WHERE name = 'page2'");
+	}
+	assert(getNextPage(moreResults) == std::vector<Artist::id_type>({artistIds["page3"], artistIds["page4"]}));
+	assert(moreResults);
+
+	// The last row of the page is removed
+	{
+		Wt::Dbo::Transaction transaction(session);
+
+		Artist::pointer artist = Artist::getById(session, artistIds["page4"]);
+		for (Track::pointer track : Track::getByFilter(session, SearchFilter::ById(SearchFilter::Field::Artist, artist.id()), -1, -1))
+			track.remove();
+		artist.remove();
+	}
+	assert(getNextPage(moreResults) == std::vector<Artist::id_type>({artistIds["page5"], artistIds["page2"]}));
+	assert(!moreResults);
+}
+
+// Pages of ranked names, same order as a single query
+static void
+checkRankedPages(Wt::Dbo::Session& session)
+{
+	{
+		Wt::Dbo::Transaction transaction(session);
+
+		Release::pointer release = Release::create(session, "ranked release");
+		Artist::pointer artist = Artist::create(session, "ranked artist");
+		for (const std::string& name : {"ranked", "ranked ranked", "ranked cursor page", "other ranked"})
+			DatabaseFixture::createTrack(session, name, artist, release);
+	}
+
+	Wt::Dbo::Transaction transaction(session);
+
+	const SearchFilter filter = SearchFilter::ByNameAnd(SearchFilter::Field::Track, {"ranked"});
+
+	std::vector<Track::id_type> ids;
+	for (Track::pointer track : Track::getByFilter(session, filter, -1, -1))
+		ids.push_back(track.id());
+	assert(ids.size() == 4);
+
+	SearchCursor cursor;
+	std::vector<Track::id_type> pagedIds;
+	bool morePages = true;
+	while (morePages)
+	{
+		for (Track::pointer track : Track::getByFilter(session, filter, cursor, 1, morePages))
+			pagedIds.push_back(track.id());
+	}
+	assert(pagedIds == ids);
+}
+
+int main(void)
+{
+	try
+	{
+		std::unique_ptr<Wt::Dbo::SqlConnectionPool> connectionPool(DatabaseFixture::createConnectionPool("test_search_cursor.db"));
+		Handler db(*connectionPool);
+
+		checkArtistPages(db.getSession());
+		checkRankedPages(db.getSession());
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "Caught exception " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Search filters on several genres and on several fields
+
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "DatabaseFixture.hpp"
+
+using namespace Database;
+
+static Track::id_type multiGenreTrackId;
+static Genre::id_type rockId, jazzId;
+
+// One track with two genres, one with a single genre, both in the same release
+static void
+createTracks(Wt::Dbo::Session& session)
+{
+	Wt::Dbo::Transaction transaction(session);
+
+	Genre::pointer rock = Genre::create(session, "multi rock");
+	Genre::pointer jazz = Genre::create(session, "multi jazz");
+	Release::pointer release = Release::create(session, "mixed release");
+
+	Track::pointer track = DatabaseFixture::createTrack(session, "multi genre", Artist::create(session, "mixed artist"), release);
+	track.modify()->setGenres(std::vector<Genre::pointer>({rock, jazz}));
+
+	Track::pointer otherTrack = DatabaseFixture::createTrack(session, "single genre", Artist::create(session, "single artist"), release);
+	otherTrack.modify()->setGenres(std::vector<Genre::pointer>({rock}));
+
+	multiGenreTrackId = track.id();
+	rockId = rock.id();
+	jazzId = jazz.id();
+}
+
+static void
+checkMultiGenres(Wt::Dbo::Session& session)
+{
+	Wt::Dbo::Transaction transaction(session);
+
+	// Each track once, whatever the number of matching genres
+	std::vector<Track::pointer> tracks = Track::getByFilter(session, SearchFilter::IdMatch({{SearchFilter::Field::Genre, {rockId, jazzId}}}), -1, -1);
+	assert(tracks.size() == 2);
+
+	tracks = Track::getByFilter(session, SearchFilter::ByNameOr(SearchFilter::Field::Genre, {"multi"}), -1, -1);
+	assert(tracks.size() == 2);
+
+	// Both genres
+	tracks = Track::getByFilter(session, SearchFilter::ByNameAnd(SearchFilter::Field::Genre, {"rock", "jazz"}), -1, -1);
+	assert(tracks.size() == 1);
+	assert(tracks.front().id() == multiGenreTrackId);
+
+	std::vector<Genre::pointer> genres = Genre::getByFilter(session, SearchFilter::ById(SearchFilter::Field::Track, multiGenreTrackId), -1, -1);
+	assert(genres.size() == 2);
+
+	std::vector<Release::pointer> releases = Release::getByFilter(session, SearchFilter::ByNameOr(SearchFilter::Field::Genre, {"multi"}), -1, -1);
+	assert(releases.size() == 1);
+	assert(releases.front()->getName() == "mixed release");
+}
+
+// Terms on several fields
+static void
+checkMultiFieldTerms(Wt::Dbo::Session& session)
+{
+	Wt::Dbo::Transaction transaction(session);
+
+	SearchFilter filter;
+	filter.nameLikeMatch.push_back({{SearchFilter::Field::Artist, {"mixed"}}, {SearchFilter::Field::Genre, {"rock"}}});
+	filter.nameLikeMatch.push_back({{SearchFilter::Field::Track, {"single"}}});
+
+	std::vector<Track::pointer> tracks = Track::getByFilter(session, filter, -1, -1);
+	assert(tracks.size() == 1);
+	assert(tracks.front()->getName() == "single genre");
+
+	std::vector<Artist::pointer> artists = Artist::getByFilter(session, filter, -1, -1);
+	assert(artists.size() == 1);
+	assert(artists.front()->getName() == "single artist");
+
+	filter.nameLikeMatch.front() = {{SearchFilter::Field::Artist, {"mixed"}}, {SearchFilter::Field::Genre, {"jazz"}}};
+	assert(Track::getByFilter(session, filter, -1, -1).empty());
+	assert(Artist::getByFilter(session, filter, -1, -1).empty());
+
+	filter.nameLikeMatch.back() = {{SearchFilter::Field::Track, {"genre"}}, {SearchFilter::Field::Release, {"nothing"}}};
+	assert(Track::getByFilter(session, filter, -1, -1).size() == 1);
+	assert(Release::getByFilter(session, filter, -1, -1).size() == 1);
+}
+
+int main(void)
+{
+	try
+	{
+		std::unique_ptr<Wt::Dbo::SqlConnectionPool> connectionPool(DatabaseFixture::createConnectionPool("test_search_filter.db"));
+		Handler db(*connectionPool);
+
+		createTracks(db.getSession());
+		checkMultiGenres(db.getSession());
+		checkMultiFieldTerms(db.getSession());
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "Caught exception " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,415 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Header parsing of small crafted files, checked against expected values
+// and against the libav results on the same files
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "av/AvInfo.hpp"
+#include "metadata/AvFormat.hpp"
+#include "metadata/HeaderParser.hpp"
+
+typedef std::vector<unsigned char> Buffer;
+
+static void
+check(bool condition, const std::string& testCase, const std::string& msg)
+{
+	if (!condition)
+		throw std::runtime_error(testCase + ": " + msg);
+}
+
+/*
+ * Builders
+ */
+
+static Buffer
+concat(std::initializer_list<Buffer> buffers)
+{
+	Buffer res;
+	for (const Buffer& buffer : buffers)
+		res.insert(res.end(), buffer.begin(), buffer.end());
+	return res;
+}
+
+static Buffer
+bytes(const std::string& str)
+{
+	return Buffer(str.begin(), str.end());
+}
+
+static Buffer
+zeros(std::size_t size)
+{
+	return Buffer(size, 0);
+}
+
+static Buffer
+bigEndian(uint64_t value, std::size_t size)
+{
+	Buffer res(size);
+	for (std::size_t i = 0; i < size; ++i)
+		res[size - 1 - i] = (value >> (8 * i)) & 0xFF;
+	return res;
+}
+
+static Buffer
+littleEndian32(uint32_t value)
+{
+	return Buffer { static_cast<unsigned char>(value), static_cast<unsigned char>(value >> 8), static_cast<unsigned char>(value >> 16), static_cast<unsigned char>(value >> 24) };
+}
+
+static Buffer
+syncSafe(uint32_t value)
+{
+	return Buffer { static_cast<unsigned char>((value >> 21) & 0x7F), static_cast<unsigned char>((value >> 14) & 0x7F), static_cast<unsigned char>((value >> 7) & 0x7F), static_cast<unsigned char>(value & 0x7F) };
+}
+
+// MPEG-1 layer III, 128 kb/s, 44100 Hz, stereo: 417 bytes per frame, 1152 samples
+static Buffer
+mpegFrames(std::size_t nbFrames)
+{
+	const Buffer frame = concat({ Buffer {0xFF, 0xFB, 0x90, 0x00}, zeros(417 - 4) });
+
+	Buffer res;
+	for (std::size_t i = 0; i < nbFrames; ++i)
+		res.insert(res.end(), frame.begin(), frame.end());
+	return res;
+}
+
+static Buffer
+id3v2Frame(unsigned version, const std::string& id, const Buffer& content, unsigned char flags = 0)
+{
+	return concat({ bytes(id), (version == 4) ? syncSafe(content.size()) : bigEndian(content.size(), 4), Buffer {0x00, flags}, content });
+}
+
+// Latin-1 text
+static Buffer
+id3v2Text(const std::string& text)
+{
+	return concat({ Buffer {0x00}, bytes(text) });
+}
+
+static Buffer
+id3v2Tag(unsigned version, const Buffer& frames, std::size_t paddingSize = 0)
+{
+	return concat({ bytes("ID3"), Buffer {static_cast<unsigned char>(version), 0x00, 0x00}, syncSafe(frames.size() + paddingSize), frames, zeros(paddingSize) });
+}
+
+static Buffer
+id3v1Tag(const std::string& title, const std::string& artist, const std::string& album, const std::string& year, unsigned char track, unsigned char genre)
+{
+	auto field = [](const std::string& str, std::size_t size)
+	{
+		Buffer res = bytes(str);
+		res.resize(size, 0);
+		return res;
+	};
+
+	return concat({ bytes("TAG"), field(title, 30), field(artist, 30), field(album, 30), field(year, 4), zeros(28), Buffer {0x00, track, genre} });
+}
+
+static Buffer
+flacBlock(unsigned char type, bool last, const Buffer& content)
+{
+	return concat({ Buffer {static_cast<unsigned char>(type | (last ? 0x80 : 0x00))}, bigEndian(content.size(), 3), content });
+}
+
+static Buffer
+flacStreamInfo(unsigned sampleRate, unsigned nbChannels, uint64_t nbSamples)
+{
+	const uint64_t packed = (static_cast<uint64_t>(sampleRate) << 44) | (static_cast<uint64_t>(nbChannels - 1) << 41) | (static_cast<uint64_t>(16 - 1) << 36) | nbSamples;
+
+	return concat({ bigEndian(4096, 2), bigEndian(4096, 2), zeros(3), zeros(3), bigEndian(packed, 8), zeros(16) });
+}
+
+static Buffer
+vorbisComments(const std::vector<std::string>& comments)
+{
+	Buffer res = concat({ littleEndian32(3), bytes("lms"), littleEndian32(comments.size()) });
+	for (const std::string& comment : comments)
+		res = concat({ res, littleEndian32(comment.size()), bytes(comment) });
+	return res;
+}
+
+static Buffer
+mp4Atom(const std::string& type, const Buffer& content)
+{
+	return concat({ bigEndian(8 + content.size(), 4), bytes(type), content });
+}
+
+// Version and flags
+static Buffer
+mp4FullAtom(const std::string& type, uint32_t flags, const Buffer& content)
+{
+	return mp4Atom(type, concat({ bigEndian(flags, 4), content }));
+}
+
+static Buffer
+mp4Item(const std::string& type, uint32_t dataType, const Buffer& value)
+{
+	return mp4Atom(type, mp4Atom("data", concat({ bigEndian(dataType, 4), zeros(4), value })));
+}
+
+// AAC LC, 44100 Hz, stereo, no sample
+static Buffer
+mp4AudioFile(uint32_t durationMs, const Buffer& items)
+{
+	const Buffer identityMatrix = concat({ bigEndian(0x00010000, 4), zeros(12), bigEndian(0x00010000, 4), zeros(12), bigEndian(0x40000000, 4) });
+
+	const Buffer esds = mp4FullAtom("esds", 0, Buffer {
+			0x03, 25, 0x00, 0x01, 0x00,					// ES descriptor
+			0x04, 17, 0x40, 0x15, 0x00, 0x00, 0x00, 0x00, 0x01, 0xF4, 0x00, 0x00, 0x01, 0xF4, 0x00,	// Decoder config
+			0x05, 2, 0x12, 0x10,						// Audio specific config
+			0x06, 1, 0x02 });						// SL config
+
+	const Buffer mp4a = mp4Atom("mp4a", concat({ zeros(6), bigEndian(1, 2), zeros(8), bigEndian(2, 2), bigEndian(16, 2), zeros(4), bigEndian(44100u << 16, 4), esds }));
+
+	const Buffer stbl = mp4Atom("stbl", concat({
+			mp4FullAtom("stsd", 0, concat({ bigEndian(1, 4), mp4a })),
+			mp4FullAtom("stts", 0, bigEndian(0, 4)),
+			mp4FullAtom("stsc", 0, bigEndian(0, 4)),
+			mp4FullAtom("stsz", 0, concat({ bigEndian(0, 4), bigEndian(0, 4) })),
+			mp4FullAtom("stco", 0, bigEndian(0, 4)) }));
+
+	const Buffer minf = mp4Atom("minf", concat({
+			mp4FullAtom("smhd", 0, zeros(4)),
+			mp4Atom("dinf", mp4FullAtom("dref", 0, concat({ bigEndian(1, 4), mp4FullAtom("url ", 1, Buffer()) }))),
+			stbl }));
+
+	const Buffer mdia = mp4Atom("mdia", concat({
+			mp4FullAtom("mdhd", 0, concat({ zeros(8), bigEndian(44100, 4), bigEndian(44100ULL * durationMs / 1000, 4), bigEndian(0x55C4, 2), zeros(2) })),
+			mp4FullAtom("hdlr", 0, concat({ zeros(4), bytes("soun"), zeros(12), Buffer {0x00} })),
+			minf }));
+
+	const Buffer trak = mp4Atom("trak", concat({
+			mp4FullAtom("tkhd", 7, concat({ zeros(8), bigEndian(1, 4), zeros(4), bigEndian(durationMs, 4), zeros(8), zeros(4), bigEndian(0x0100, 2), zeros(2), identityMatrix, zeros(8) })),
+			mdia }));
+
+	const Buffer mvhd = mp4FullAtom("mvhd", 0, concat({ zeros(8), bigEndian(1000, 4), bigEndian(durationMs, 4), bigEndian(0x00010000, 4), bigEndian(0x0100, 2), zeros(10), identityMatrix, zeros(24), bigEndian(2, 4) }));
+
+	const Buffer udta = mp4Atom("udta", mp4FullAtom("meta", 0, concat({
+			mp4FullAtom("hdlr", 0, concat({ zeros(4), bytes("mdir"), bytes("appl"), zeros(8), Buffer {0x00} })),
+			mp4Atom("ilst", items) })));
+
+	return concat({
+			mp4Atom("ftyp", concat({ bytes("M4A "), bigEndian(0x200, 4), bytes("M4A mp42isom") })),
+			mp4Atom("moov", concat({ mvhd, trak, udta })),
+			mp4Atom("mdat", Buffer()) });
+}
+
+/*
+ * Test cases
+ */
+
+struct TestCase
+{
+	std::string				name;
+	std::string				extension;
+	Buffer					data;
+	bool					parsed;		// expected parseHeaders result
+	std::map<std::string, std::string>	tags;		// expected tags (subset)
+	long					durationSeconds;
+	bool					hasCover;
+	std::size_t				coverSize;
+	bool					compareWithLibav;
+};
+
+static std::vector<TestCase>
+getTestCases()
+{
+	const Buffer cover = concat({ Buffer {0xFF, 0xD8, 0xFF, 0xE0}, zeros(60) });
+
+	// 200 frames of 417 bytes at 128 kb/s
+	const long mpegDuration = 200 * 417 * 8 / 128000;
+
+	return
+	{
+		{ "id3v2.3", "mp3",
+			concat({ id3v2Tag(3, concat({
+				id3v2Frame(3, "TIT2", id3v2Text("Title")),
+				id3v2Frame(3, "TPE1", id3v2Text("Artist")),
+				id3v2Frame(3, "TALB", id3v2Text("Album")),
+				id3v2Frame(3, "TCON", id3v2Text("(17)")),
+				id3v2Frame(3, "TRCK", id3v2Text("3/12")),
+				id3v2Frame(3, "TYER", id3v2Text("2011")),
+				id3v2Frame(3, "TDAT", id3v2Text("2402")) }), 64), mpegFrames(200) }),
+			true, {{"title", "Title"}, {"artist", "Artist"}, {"album", "Album"}, {"genre", "Rock"}, {"track", "3/12"}, {"date", "2011-02-24"}},
+			mpegDuration, false, 0, true },
+
+		{ "id3v2.4 with cover", "mp3",
+			concat({ id3v2Tag(4, concat({
+				id3v2Frame(4, "TIT2", concat({ Buffer {0x03}, bytes("Tïtle") })),
+				id3v2Frame(4, "TPE1", id3v2Text("Artist")),
+				id3v2Frame(4, "TDRC", id3v2Text("2011")),
+				id3v2Frame(4, "APIC", concat({ Buffer {0x00}, bytes("image/jpeg"), Buffer {0x00, 0x03, 0x00}, cover })) })), mpegFrames(200) }),
+			true, {{"title", "Tïtle"}, {"artist", "Artist"}, {"date", "2011"}},
+			mpegDuration, true, cover.size(), true },
+
+		// The group byte comes before the text encoding
+		{ "id3v2.3 grouping identity", "mp3",
+			concat({ id3v2Tag(3, id3v2Frame(3, "TIT2", concat({ Buffer {0x01}, id3v2Text("Title") }), 0x20)), mpegFrames(200) }),
+			true, {{"title", "Title"}},
+			mpegDuration, false, 0, false },
+
+		{ "id3v2.4 grouping identity and data length", "mp3",
+			concat({ id3v2Tag(4, id3v2Frame(4, "TIT2", concat({ Buffer {0x01}, syncSafe(6), id3v2Text("Title") }), 0x41)), mpegFrames(200) }),
+			true, {{"title", "Title"}},
+			mpegDuration, false, 0, false },
+
+		{ "id3v2.4 unsynchronised frame", "mp3",
+			concat({ id3v2Tag(4, id3v2Frame(4, "TIT2", concat({ Buffer {0x00}, bytes("A"), Buffer {0xFF, 0x00}, bytes("B") }), 0x02)), mpegFrames(200) }),
+			true, {{"title", "A\xC3\xBF" "B"}},
+			mpegDuration, false, 0, true },
+
+		{ "id3v1", "mp3",
+			concat({ mpegFrames(200), id3v1Tag("Title", "Artist", "Album", "2003", 5, 17) }),
+			true, {{"title", "Title"}, {"artist", "Artist"}, {"album", "Album"}, {"date", "2003"}, {"track", "5"}, {"genre", "Rock"}},
+			mpegDuration, false, 0, true },
+
+		// Vorbis comment names are kept, as libav does
+		{ "flac", "flac",
+			concat({ bytes("fLaC"),
+				flacBlock(0, false, flacStreamInfo(44100, 2, 44100 * 5)),
+				flacBlock(4, false, vorbisComments({"TITLE=Title", "ARTIST=Artist", "ALBUM=Album", "GENRE=Jazz", "TRACKNUMBER=3", "DISCNUMBER=1", "DATE=2011"})),
+				flacBlock(6, true, concat({ bigEndian(3, 4), bigEndian(10, 4), bytes("image/jpeg"), bigEndian(0, 4), zeros(16), bigEndian(cover.size(), 4), cover })) }),
+			true, {{"TITLE", "Title"}, {"ARTIST", "Artist"}, {"ALBUM", "Album"}, {"GENRE", "Jazz"}, {"track", "3"}, {"disc", "1"}, {"DATE", "2011"}},
+			5, true, cover.size(), true },
+
+		{ "mp4", "m4a",
+			mp4AudioFile(5000, concat({
+				mp4Item("\xA9nam", 1, bytes("Title")),
+				mp4Item("\xA9" "ART", 1, bytes("Artist")),
+				mp4Item("\xA9" "alb", 1, bytes("Album")),
+				mp4Item("\xA9gen", 1, bytes("Jazz")),
+				mp4Item("\xA9" "day", 1, bytes("2011")),
+				mp4Item("trkn", 0, Buffer {0x00, 0x00, 0x00, 0x03, 0x00, 0x0C, 0x00, 0x00}),
+				mp4Item("covr", 13, cover) })),
+			true, {{"title", "Title"}, {"artist", "Artist"}, {"album", "Album"}, {"genre", "Jazz"}, {"date", "2011"}, {"track", "3/12"}},
+			5, true, cover.size(), true },
+
+		// Left to libav
+		{ "APE tag", "mp3",
+			concat({ mpegFrames(200), bytes("APETAGEX"), zeros(24) }),
+			false, {}, 0, false, 0, true },
+
+		{ "compressed ID3v2.3 frame", "mp3",
+			concat({ id3v2Tag(3, id3v2Frame(3, "TIT2", concat({ bigEndian(6, 4), zeros(8) }), 0x80)), mpegFrames(200) }),
+			false, {}, 0, false, 0, false },
+
+		{ "truncated ID3v2 frame", "mp3",
+			concat({ id3v2Tag(3, Buffer {'T', 'I', 'T', '2', 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00}), mpegFrames(200) }),
+			false, {}, 0, false, 0, false },
+
+		{ "FLAC with ID3v2 tag", "flac",
+			concat({ id3v2Tag(3, id3v2Frame(3, "TIT2", id3v2Text("Title"))), bytes("fLaC"), flacBlock(0, true, flacStreamInfo(44100, 2, 44100 * 5)) }),
+			false, {}, 0, false, 0, false },
+
+		{ "no MPEG sync", "mp3",
+			zeros(8192),
+			false, {}, 0, false, 0, false },
+	};
+}
+
+static void
+checkHeaders(const TestCase& testCase, const boost::filesystem::path& file)
+{
+	MetaData::HeaderInfo info;
+	const bool parsed = MetaData::parseHeaders(file, info);
+
+	check(parsed == testCase.parsed, testCase.name, parsed ? "unexpectedly parsed" : "not parsed");
+	if (!parsed)
+		return;
+
+	for (const auto& tag : testCase.tags)
+	{
+		auto it = info.tags.find(tag.first);
+		check(it != info.tags.end(), testCase.name, "missing tag '" + tag.first + "'");
+		check(it->second == tag.second, testCase.name, "tag '" + tag.first + "' is '" + it->second + "', expected '" + tag.second + "'");
+	}
+
+	check(info.duration.total_seconds() == testCase.durationSeconds, testCase.name, "bad duration " + std::to_string(info.duration.total_seconds()));
+	check(info.hasCover == testCase.hasCover, testCase.name, "bad cover flag");
+	check(info.cover.size() == testCase.coverSize, testCase.name, "bad cover size " + std::to_string(info.cover.size()));
+	check(!info.audioStreamDesc.empty(), testCase.name, "missing audio stream description");
+}
+
+// Same file parsed with and without header parsing
+static void
+checkLibav(const TestCase& testCase, const boost::filesystem::path& file)
+{
+	MetaData::Items avItems;
+	check(MetaData::AvFormat(false).parse(file, avItems), testCase.name, "not parsed by libav");
+
+	MetaData::Items items;
+	check(MetaData::AvFormat(true).parse(file, items), testCase.name, "not parsed");
+
+	check(items.title == avItems.title, testCase.name, "title differs from libav: '" + items.title + "' / '" + avItems.title + "'");
+	check(items.artist == avItems.artist, testCase.name, "artist differs from libav: '" + items.artist + "' / '" + avItems.artist + "'");
+	check(items.album == avItems.album, testCase.name, "album differs from libav: '" + items.album + "' / '" + avItems.album + "'");
+	check(items.genres == avItems.genres, testCase.name, "genres differ from libav");
+	check(items.trackNumber == avItems.trackNumber && items.totalTrack == avItems.totalTrack, testCase.name, "track number differs from libav");
+	check(items.discNumber == avItems.discNumber && items.totalDisc == avItems.totalDisc, testCase.name, "disc number differs from libav");
+	check(items.date == avItems.date, testCase.name, "date differs from libav");
+	check(std::abs(items.duration.total_seconds() - avItems.duration.total_seconds()) <= 1, testCase.name,
+			"duration differs from libav: " + std::to_string(items.duration.total_seconds()) + " / " + std::to_string(avItems.duration.total_seconds()));
+	check(items.hasCover == avItems.hasCover, testCase.name, "cover flag differs from libav");
+	check(items.cover == avItems.cover, testCase.name, "cover differs from libav");
+}
+
+int main(void)
+{
+	try
+	{
+		Av::AvInit();
+
+		for (const TestCase& testCase : getTestCases())
+		{
+			const boost::filesystem::path file = "header-parser-test." + testCase.extension;
+
+			{
+				std::ofstream ofs(file.string(), std::ios::binary);
+				ofs.write(reinterpret_cast<const char*>(testCase.data.data()), testCase.data.size());
+			}
+
+			std::cout << "Checking '" << testCase.name << "'" << std::endl;
+
+			checkHeaders(testCase, file);
+			if (testCase.compareWithLibav)
+				checkLibav(testCase, file);
+
+			boost::filesystem::remove(file);
+		}
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Caught exception: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
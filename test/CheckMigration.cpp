@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Migration of a database created before the schema versioning
+
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Wt/Dbo/backend/Sqlite3>
+
+#include "database/DatabaseHandler.hpp"
+#include "database/Migration.hpp"
+
+static const std::string dbPath = "test_migration.db";
+
+// Tables as created by Wt::Dbo before the versioning, with some content
+// The authentication tables are left out, the migration does not check them
+static const std::vector<std::string> baselineDatabase =
+{
+	"create table \"artist\" (\"id\" integer primary key autoincrement, \"version\" integer not null, "
+		"\"name\" text not null, \"mbid\" text not null)",
+	"create table \"genre\" (\"id\" integer primary key autoincrement, \"version\" integer not null, "
+		"\"name\" text not null)",
+	"create table \"release\" (\"id\" integer primary key autoincrement, \"version\" integer not null, "
+		"\"name\" text not null, \"mbid\" text not null)",
+	"create table \"track\" (\"id\" integer primary key autoincrement, \"version\" integer not null, "
+		"\"track_number\" integer not null, \"total_track_number\" integer not null, \"disc_number\" integer not null, \"total_disc_number\" integer not null, "
+		"\"name\" text not null, \"duration\" integer, \"date\" text, \"original_date\" text, \"genre_list\" text not null, "
+		"\"file_path\" text not null, \"file_last_write\" text, \"file_added\" text, \"checksum\" blob not null, \"cover_type\" integer not null, \"mbid\" text not null, "
+		"\"release_id\" bigint, \"artist_id\" bigint, "
+		"constraint \"fk_track_release\" foreign key (\"release_id\") references \"release\" (\"id\") on delete cascade deferrable initially deferred, "
+		"constraint \"fk_track_artist\" foreign key (\"artist_id\") references \"artist\" (\"id\") on delete cascade deferrable initially deferred)",
+	"create table \"track_genre\" (\"track_id\" bigint not null, \"genre_id\" bigint not null, primary key (\"track_id\", \"genre_id\"), "
+		"constraint \"fk_track_genre_key1\" foreign key (\"track_id\") references \"track\" (\"id\") on delete cascade deferrable initially deferred, "
+		"constraint \"fk_track_genre_key2\" foreign key (\"genre_id\") references \"genre\" (\"id\") on delete cascade deferrable initially deferred)",
+	"create table \"video\" (\"id\" integer primary key autoincrement, \"version\" integer not null, "
+		"\"name\" text not null, \"duration\" integer, \"last_write\" text, \"path\" text not null)",
+	"create table \"media_directory_settings\" (\"id\" integer primary key autoincrement, \"version\" integer not null, "
+		"\"manual_scan_requested\" boolean not null, \"update_period\" integer not null, \"update_start_time\" integer, "
+		"\"audio_file_extensions\" text not null, \"video_file_extensions\" text not null, \"last_update\" text, \"last_scan\" text)",
+		"create table \"media_directory\" (\"id\" integer primary key autoincrement, \"version\" integer not null, "
+			"\"type\" integer not null, \"path\" text not null, \"media_directory_settings_id\" bigint, "
+			"constraint \"fk_media_directory_media_directory_settings\" foreign key (\"media_directory_settings_id\") references \"media_directory_settings\" (\"id\") on delete cascade deferrable initially deferred)",
+		"create table \"user\" (\"id\" integer primary key autoincrement, \"version\" integer not null, "
+			"\"max_audio_bitrate\" integer not null, \"max_video_bitrate\" integer not null, \"admin\" boolean not null, "
+			"\"audio_bitrate\" integer not null, \"audio_encoding\" integer not null, \"video_bitrate\" integer not null, \"video_encoding\" integer not null, "
+			"\"cur_playing_track_pos\" integer not null)",
+		"create table \"playlist\" (\"id\" integer primary key autoincrement, \"version\" integer not null, "
+			"\"name\" text not null, \"public\" boolean not null, \"user_id\" bigint, "
+			"constraint \"fk_playlist_user\" foreign key (\"user_id\") references \"user\" (\"id\") on delete cascade deferrable initially deferred)",
+		"create table \"playlist_entry\" (\"id\" integer primary key autoincrement, \"version\" integer not null, "
+			"\"pos\" integer not null, \"track_id\" bigint, \"playlist_id\" bigint, "
+			"constraint \"fk_playlist_entry_track\" foreign key (\"track_id\") references \"track\" (\"id\") on delete cascade deferrable initially deferred, "
+			"constraint \"fk_playlist_entry_playlist\" foreign key (\"playlist_id\") references \"playlist\" (\"id\") on delete cascade deferrable initially deferred)",
+
+	"CREATE INDEX artist_name_idx ON artist(name)",
+	"CREATE INDEX genre_name_idx ON genre(name)",
+	"CREATE INDEX release_name_idx ON release(name)",
+	"CREATE INDEX track_name_idx ON track(name)",
+
+	"INSERT INTO artist(version, name, mbid) VALUES (0, 'artist01', '')",
+	"INSERT INTO release(version, name, mbid) VALUES (0, 'release01', '')",
+	"INSERT INTO genre(version, name) VALUES (0, 'genre01')",
+	"INSERT INTO track(version, track_number, total_track_number, disc_number, total_disc_number, name, duration, genre_list, file_path, checksum, cover_type, mbid, release_id, artist_id) "
+		"VALUES (0, 1, 2, 1, 1, 'track01', 60000, 'genre01', '/music/track01.mp3', x'00', 0, '', 1, 1)",
+	"INSERT INTO track(version, track_number, total_track_number, disc_number, total_disc_number, name, duration, genre_list, file_path, file_last_write, checksum, cover_type, mbid, release_id, artist_id) "
+		"VALUES (0, 2, 2, 1, 1, 'track02', 30000, 'genre01', '/music/track02.mp3', '2016-01-01T00:00:00', x'01', 1, '', 1, 1)",
+	"INSERT INTO track_genre(track_id, genre_id) VALUES (1, 1), (2, 1)",
+	"INSERT INTO media_directory_settings(version, manual_scan_requested, update_period, update_start_time, audio_file_extensions, video_file_extensions) "
+		"VALUES (0, 0, 1, 0, '.mp3', '.mp4')",
+};
+
+static int
+count(Wt::Dbo::Session& session, const std::string& query, const std::string& arg)
+{
+	return session.query<int>(query).bind(arg);
+}
+
+static bool
+hasColumn(Wt::Dbo::Session& session, const std::string& table, const std::string& column)
+{
+	return count(session, "SELECT COUNT(*) FROM pragma_table_info('" + table + "') WHERE name = ?", column) == 1;
+}
+
+static bool
+hasIndex(Wt::Dbo::Session& session, const std::string& index)
+{
+	return count(session, "SELECT COUNT(*) FROM sqlite_master WHERE type = 'index' AND name = ?", index) == 1;
+}
+
+static bool
+hasTable(Wt::Dbo::Session& session, const std::string& table)
+{
+	return count(session, "SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' AND name = ?", table) == 1;
+}
+
+int main(void)
+{
+	try
+	{
+		using namespace Database;
+
+		boost::filesystem::remove(dbPath);
+
+		{
+			Wt::Dbo::backend::Sqlite3 connection(dbPath);
+			for (const std::string& statement : baselineDatabase)
+				connection.executeSql(statement);
+		}
+
+		// Migrated once, when creating the pool
+		std::unique_ptr<Wt::Dbo::SqlConnectionPool> connectionPool(Handler::createConnectionPool(dbPath));
+
+		// Schema
+		{
+			Handler db(*connectionPool);
+			Wt::Dbo::Session& session = db.getSession();
+			Wt::Dbo::Transaction transaction(session);
+
+			int version = session.query<int>("SELECT user_version FROM pragma_user_version");
+			assert(version == schemaVersion);
+
+			// Some columns of each step
+			assert(hasColumn(session, "media_directory_settings", "scan_worker_count"));
+			assert(hasColumn(session, "media_directory_settings", "scan_max_mbytes_per_second"));
+			assert(hasColumn(session, "track", "file_size"));
+			assert(hasColumn(session, "track", "checksum_type"));
+			assert(hasColumn(session, "video", "file_size"));
+			assert(hasColumn(session, "track", "cover_hash"));
+			assert(hasColumn(session, "release", "cover_hash"));
+			assert(hasColumn(session, "artist", "release_count"));
+			assert(hasColumn(session, "release", "date"));
+			assert(hasColumn(session, "genre", "duration"));
+			assert(hasColumn(session, "scan_checkpoint", "duplicate_check_pending"));
+			assert(hasColumn(session, "scan_checkpoint", "counters_update_pending"));
+
+			assert(hasTable(session, "scan_checkpoint"));
+			assert(hasTable(session, "scanned_directory"));
+			assert(hasTable(session, "track_duplicate"));
+
+			for (const std::string& index : { "artist_name_idx", "artist_mbid_idx", "track_path_idx", "track_checksum_idx",
+					"track_artist_idx", "track_release_idx", "track_genre_genre_idx", "track_duplicate_key_idx", "video_path_idx" })
+				assert(hasIndex(session, index));
+
+			// Indexed names, when SQLite has FTS5 and its trigram tokenizer (3.34)
+			const std::string version = session.query<std::string>("SELECT sqlite_version()");
+			int major = 0;
+			int minor = 0;
+			std::sscanf(version.c_str(), "%d.%d", &major, &minor);
+
+			int fullText = session.query<int>("SELECT sqlite_compileoption_used('ENABLE_FTS5')");
+			if (fullText && (major > 3 || (major == 3 && minor >= 34)))
+			{
+				for (const std::string& table : { "artist_fts", "release_fts", "genre_fts", "track_fts" })
+					assert(hasTable(session, table));
+
+				// Any part of the names
+				assert(count(session, "SELECT COUNT(*) FROM track_fts WHERE track_fts MATCH ?", "rack01") == 1);
+			}
+		}
+
+		// The migrated content is readable by the classes
+		{
+			Handler db(*connectionPool);
+			Wt::Dbo::Transaction transaction(db.getSession());
+
+			Track::pointer track = Track::getById(db.getSession(), 1);
+			assert(track);
+			assert(track->getName() == "track01");
+			assert(track->getCoverHash().empty());
+
+			// Tracks with an embedded cover are parsed again, by a full scan
+			assert(track->getLastWriteTime().is_special());
+			assert(count(db.getSession(), "SELECT COUNT(*) FROM track WHERE file_last_write IS NOT NULL AND name = ?", "track02") == 1);
+			assert(MediaDirectorySettings::get(db.getSession())->getLastFullScan().is_special());
+
+			// Counters computed by the migration
+			Artist::pointer artist = Artist::getById(db.getSession(), 1);
+			assert(artist->getTrackCount() == 2);
+			assert(artist->getReleaseCount() == 1);
+			assert(artist->getDuration() == boost::posix_time::seconds(90));
+
+			Release::pointer release = Release::getById(db.getSession(), 1);
+			assert(release->getTrackCount() == 2);
+
+			Genre::pointer genre = Genre::getByName(db.getSession(), "genre01");
+			assert(genre->getTrackCount() == 2);
+			assert(genre->getReleaseCount() == 1);
+
+			assert(MediaDirectorySettings::get(db.getSession())->getScanBatchSize() == 200);
+		}
+
+		// Nothing left to migrate
+		connectionPool.reset(Handler::createConnectionPool(dbPath));
+		{
+			Handler db(*connectionPool);
+			Wt::Dbo::Transaction transaction(db.getSession());
+
+			int version = db.getSession().query<int>("SELECT user_version FROM pragma_user_version");
+			assert(version == schemaVersion);
+		}
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "Caught exception " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
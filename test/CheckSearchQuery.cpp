@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+#include <cassert>
+
+#include "database/SearchFilter.hpp"
+
+using namespace Database;
+
+int main(void)
+{
+	try {
+		// Names of the table itself, artists still need a track
+		{
+			SearchQuery query(SearchFilter::Field::Artist, SearchFilter::ByNameAnd(SearchFilter::Field::Artist, {"blue"}));
+
+			std::cout << "Query = '" << query.get("a.id") << "'" << std::endl;
+
+			assert(query.get("a.id") == "SELECT a.id FROM artist a WHERE ((a.name LIKE ?)) AND (EXISTS (SELECT 1 FROM track t WHERE t.artist_id = a.id))");
+			assert(query.getBindArgs() == std::list<std::string>({"%%blue%%"}));
+			assert(query.rankByName().empty());
+		}
+
+		// Ids are checked on the track columns, without any join
+		{
+			SearchQuery query(SearchFilter::Field::Track, SearchFilter::ById(SearchFilter::Field::Release, 5));
+
+			assert(query.get("t.id") == "SELECT t.id FROM track t WHERE ((t.release_id IN (5)))");
+			assert(query.getBindArgs().empty());
+		}
+
+		// Other tables match through their tracks
+		{
+			SearchQuery query(SearchFilter::Field::Artist, SearchFilter::ById(SearchFilter::Field::Release, 5));
+
+			assert(query.get("a.id") == "SELECT a.id FROM artist a WHERE (EXISTS (SELECT 1 FROM track t WHERE t.artist_id = a.id AND ((t.release_id IN (5)))))");
+		}
+
+		// Genres through an EXISTS subquery, so that the tracks are not multiplied
+		{
+			SearchQuery query(SearchFilter::Field::Track, SearchFilter::ByNameOr(SearchFilter::Field::Genre, {"rock"}));
+
+			assert(query.get("t.id") == "SELECT t.id FROM track t WHERE ((EXISTS (SELECT 1 FROM track_genre t_g INNER JOIN genre g ON g.id = t_g.genre_id WHERE t_g.track_id = t.id AND g.name LIKE ?)))");
+			assert(query.getBindArgs() == std::list<std::string>({"%%rock%%"}));
+		}
+
+		// Extra joins and conditions
+		{
+			SearchQuery query(SearchFilter::Field::Track, SearchFilter::ById(SearchFilter::Field::Artist, 3));
+			query.join(SearchFilter::Field::Release).where("r.name <> ''");
+
+			assert(query.get("t.id") == "SELECT t.id FROM track t INNER JOIN release r ON r.id = t.release_id WHERE ((t.artist_id IN (3))) AND (r.name <> '')");
+		}
+
+		// Full text index: keywords of at least 3 characters, quoted
+		enableFullTextSearch(true);
+		{
+			SearchQuery query(SearchFilter::Field::Artist, SearchFilter::ByNameAnd(SearchFilter::Field::Artist, {"bl\"ue", "ac"}));
+
+			assert(query.rankByName() == "COALESCE(fts.rank, 0)");
+
+			std::cout << "Query = '" << query.get("a.id") << "'" << std::endl;
+
+			assert(query.get("a.id") == "SELECT a.id FROM artist a"
+					" LEFT JOIN (SELECT rowid AS id, rank FROM artist_fts WHERE artist_fts MATCH ?) fts ON fts.id = a.id"
+					" WHERE ((a.id IN (SELECT rowid FROM artist_fts WHERE artist_fts MATCH ?))) AND ((a.name LIKE ?))"
+					" AND (EXISTS (SELECT 1 FROM track t WHERE t.artist_id = a.id))");
+
+			// The rank query comes first
+			assert(query.getBindArgs() == std::list<std::string>({"(\"bl\"\"ue\")", "\"bl\"\"ue\"", "%%ac%%"}));
+		}
+
+		// Names of other tables are not ranked
+		{
+			SearchQuery query(SearchFilter::Field::Release, SearchFilter::ByNameAnd(SearchFilter::Field::Artist, {"blue"}));
+
+			assert(query.rankByName().empty());
+			assert(query.get("r.id") == "SELECT r.id FROM release r WHERE (EXISTS (SELECT 1 FROM track t WHERE t.release_id = r.id AND ((t.artist_id IN (SELECT rowid FROM artist_fts WHERE artist_fts MATCH ?)))))");
+		}
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "Caught exception " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -22,22 +22,22 @@
 #include <stdexcept>
 #include <cstdlib>
 #include <cassert>
+#include <set>
+#include <vector>
 
 #include "database/SqlQuery.hpp"
 
 int main(void)
 {
 	try {
-		SqlQuery query;
+		WhereClause where;
 
 
-		query.select("artist.name").And("track.name");
-		query.from().And( FromClause("artist") ).And( FromClause("track"));
-		query.where().And( WhereClause("artist.id = track.artist_id") );
+		where.And( WhereClause("artist.id = track.artist_id") );
 
-		std::cout << "Query = '" << query.get() << "'" << std::endl;
+		std::cout << "Where = '" << where.get() << "'" << std::endl;
 
-		assert(query.get() == "SELECT artist.name,track.name FROM artist,track WHERE (artist.id = track.artist_id)");
+		assert(where.get() == "WHERE (artist.id = track.artist_id)");
 
 		{
 			WhereClause clause;
@@ -46,14 +46,34 @@ int main(void)
 			clause.Or(WhereClause("artist.name = ?").bind("Sepultura2"));
 			clause.Or(WhereClause("artist.name = ?")).bind("Sepultura3");
 
-			query.where().And(clause);
+			where.And(clause);
 
-			assert(query.get() == "SELECT artist.name,track.name FROM artist,track WHERE (artist.id = track.artist_id) AND ((artist.name = ?) OR (artist.name = ?) OR (artist.name = ?))");
+			assert(where.get() == "WHERE (artist.id = track.artist_id) AND ((artist.name = ?) OR (artist.name = ?) OR (artist.name = ?))");
 
-			assert(query.where().getBindArgs().size() == 3);
-			std::cout << "Query = '" << query.get() << "'" << std::endl;
+			assert(where.getBindArgs().size() == 3);
+			assert(where.getBindArgs().back() == "Sepultura3");
+			std::cout << "Where = '" << where.get() << "'" << std::endl;
 		}
 
+		// Empty clauses are ignored
+		assert(WhereClause().get().empty());
+		assert(WhereClause().And(WhereClause()).Or(WhereClause("track.id = 1")).get() == "WHERE (track.id = 1)");
+
+		// More bind args than '?'
+		bool thrown = false;
+		try
+		{
+			WhereClause("track.id = ?").bind("1").bind("2");
+		}
+		catch (std::runtime_error&)
+		{
+			thrown = true;
+		}
+		assert(thrown);
+
+		assert(generateIdList(std::vector<long long>({1, 22, 333})) == "1,22,333");
+		assert(generateIdList(std::set<long long>()).empty());
+
 	}
 	catch(std::exception& e)
 	{
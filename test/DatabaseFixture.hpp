@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2026 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEST_DATABASE_FIXTURE_HPP
+#define TEST_DATABASE_FIXTURE_HPP
+
+#include <memory>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "database/DatabaseHandler.hpp"
+
+// Shared setup of the database tests
+namespace DatabaseFixture {
+
+// Empty database file, migrated when the pool is created
+inline Wt::Dbo::SqlConnectionPool*
+createConnectionPool(const std::string& path)
+{
+	boost::filesystem::remove(path);
+
+	return Database::Handler::createConnectionPool(path);
+}
+
+// The track queries join the artist and the release, a track needs both to be found
+inline Database::Track::pointer
+createTrack(Wt::Dbo::Session& session, const std::string& name, Database::Artist::pointer artist, Database::Release::pointer release)
+{
+	Database::Track::pointer track = Database::Track::create(session, name + ".mp3");
+	track.modify()->setName(name);
+	track.modify()->setArtist(artist);
+	track.modify()->setRelease(release);
+
+	// Ids are only set once written
+	session.flush();
+
+	return track;
+}
+
+// Otherwise, names are matched by LIKE and sorted by name only
+inline bool
+hasFullTextIndex(Wt::Dbo::Session& session)
+{
+	return session.query<int>("SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' AND name = 'artist_fts'") > 0;
+}
+
+} // namespace DatabaseFixture
+
+#endif
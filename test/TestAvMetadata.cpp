@@ -27,29 +27,17 @@ int main(int argc, char *argv[])
 			return EXIT_FAILURE;
 		}
 
-		for (auto item : items)
-		{
-			switch (item.first)
-			{
-				case MetaData::Type::TrackNumber:
-					std::cout << "Track: " << boost::any_cast<std::size_t>(item.second) << std::endl;
-					break;
-
-				case MetaData::Type::TotalTrack:
-					std::cout << "TotalTrack: " << boost::any_cast<std::size_t>(item.second) << std::endl;
-					break;
-
-				case MetaData::Type::DiscNumber:
-					std::cout << "Disc: " << boost::any_cast<std::size_t>(item.second) << std::endl;
-					break;
-
-				case MetaData::Type::TotalDisc:
-					std::cout << "TotalDisc: " << boost::any_cast<std::size_t>(item.second) << std::endl;
-
-				default:
-					break;
-			}
-		}
+		if (items.trackNumber)
+			std::cout << "Track: " << *items.trackNumber << std::endl;
+
+		if (items.totalTrack)
+			std::cout << "TotalTrack: " << *items.totalTrack << std::endl;
+
+		if (items.discNumber)
+			std::cout << "Disc: " << *items.discNumber << std::endl;
+
+		if (items.totalDisc)
+			std::cout << "TotalDisc: " << *items.totalDisc << std::endl;
 
 		return EXIT_SUCCESS;
 	}